@@ -1,7 +1,8 @@
 #include "triangle_mesh.h"
 
-TriangleMesh::TriangleMesh(vk::Device logicalDevice, vk::PhysicalDevice physicalDevice) {
+TriangleMesh::TriangleMesh(vk::Device logicalDevice, vk::PhysicalDevice physicalDevice, vkUtils::MemoryAllocator* allocator) {
 	this->logicalDevice = logicalDevice;
+	this->allocator = allocator;
 
 	std::vector<float> vertices = { {
 	 0.0f, -0.05f, 0.0f, 1.0f, 0.0f,
@@ -14,15 +15,14 @@ TriangleMesh::TriangleMesh(vk::Device logicalDevice, vk::PhysicalDevice physical
 	inputChunk.physicalDevice = physicalDevice;
 	inputChunk.size = sizeof(float) * vertices.size();
 	inputChunk.usage = vk::BufferUsageFlagBits::eVertexBuffer;
+	inputChunk.memoryProperties = vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent;
+	inputChunk.allocator = allocator;
 
 	vertexBuffer = vkUtils::createBuffer(inputChunk);
 
-	void* memoryLocation = logicalDevice.mapMemory(vertexBuffer.bufferMemory, 0, inputChunk.size);
-	memcpy(memoryLocation, vertices.data(), inputChunk.size);
-	logicalDevice.unmapMemory(vertexBuffer.bufferMemory);
+	memcpy(vertexBuffer.allocation.mappedPointer, vertices.data(), inputChunk.size);
 }
 
 TriangleMesh::~TriangleMesh() {
-	logicalDevice.destroyBuffer(vertexBuffer.buffer);
-	logicalDevice.freeMemory(vertexBuffer.bufferMemory);
+	vkUtils::destroyBuffer(logicalDevice, allocator, vertexBuffer);
 }
\ No newline at end of file
@@ -0,0 +1,252 @@
+#include "allocator.h"
+#include "memory.h"
+
+namespace {
+	//smallest range handed out, and the size of a new block
+	constexpr vk::DeviceSize minimumRange = 256;
+	constexpr vk::DeviceSize defaultBlockSize = 64ull * 1024 * 1024;
+
+	vk::DeviceSize round_up_pow2(vk::DeviceSize value) {
+		vk::DeviceSize result = 1;
+		while (result < value) {
+			result <<= 1;
+		}
+		return result;
+	}
+
+	vk::DeviceSize round_down_pow2(vk::DeviceSize value) {
+		vk::DeviceSize result = 1;
+		while ((result << 1) <= value) {
+			result <<= 1;
+		}
+		return result;
+	}
+
+	uint32_t log2(vk::DeviceSize value) {
+		uint32_t result = 0;
+		while (value >>= 1) {
+			++result;
+		}
+		return result;
+	}
+}
+
+vkUtils::MemoryAllocator::MemoryAllocator(vk::Device logicalDevice, vk::PhysicalDevice physicalDevice, bool debug) {
+	this->logicalDevice = logicalDevice;
+	this->physicalDevice = physicalDevice;
+	this->debug = debug;
+
+	memoryProperties = physicalDevice.getMemoryProperties();
+
+	vk::PhysicalDeviceLimits limits = physicalDevice.getProperties().limits;
+	separateTilings = limits.bufferImageGranularity > minimumRange;
+	maxAllocationCount = limits.maxMemoryAllocationCount;
+
+	pools.resize(memoryProperties.memoryTypeCount * 2);
+	for (uint32_t i = 0; i < pools.size(); ++i) {
+		pools[i].memoryType = i / 2;
+	}
+
+	if (debug) {
+		std::cout << "Memory allocator: buffer/image granularity " << limits.bufferImageGranularity
+			<< (separateTilings ? ", linear and optimal resources in separate blocks" : "") << std::endl;
+	}
+}
+
+vkUtils::MemoryAllocator::~MemoryAllocator() {
+	for (Pool& pool : pools) {
+		for (uint32_t i = 0; i < pool.blocks.size(); ++i) {
+			if (pool.blocks[i]) {
+				release_block(pool, i);
+			}
+		}
+	}
+}
+
+vkUtils::MemoryAllocator::Block* vkUtils::MemoryAllocator::make_block(Pool& pool, vk::DeviceSize size, uint32_t& blockIndex) {
+	if (liveBlocks >= maxAllocationCount) {
+		if (debug) {
+			std::cout << "Memory allocator is out of device memory allocations" << std::endl;
+		}
+		return nullptr;
+	}
+
+	/*
+		* // Provided by VK_VERSION_1_0
+		typedef struct VkMemoryAllocateInfo {
+			VkStructureType    sType;
+			const void*        pNext;
+			VkDeviceSize       allocationSize;
+			uint32_t           memoryTypeIndex;
+		} VkMemoryAllocateInfo;
+	*/
+	vk::MemoryAllocateInfo allocInfo;
+	allocInfo.allocationSize = size;
+	allocInfo.memoryTypeIndex = pool.memoryType;
+
+	std::unique_ptr<Block> block = std::make_unique<Block>();
+	try {
+		block->memory = logicalDevice.allocateMemory(allocInfo);
+	}
+	catch (vk::SystemError err) {
+		if (debug) {
+			std::cout << "Failed to allocate a " << size << " byte memory block" << std::endl;
+		}
+		return nullptr;
+	}
+	block->size = size;
+	block->used = 0;
+	block->mappedPointer = nullptr;
+	if (memoryProperties.memoryTypes[pool.memoryType].propertyFlags & vk::MemoryPropertyFlagBits::eHostVisible) {
+		block->mappedPointer = logicalDevice.mapMemory(block->memory, 0, VK_WHOLE_SIZE);
+	}
+
+	uint32_t levelCount = log2(size / minimumRange) + 1;
+	block->freeLists.resize(levelCount);
+	block->freeLists[0].insert(0);
+
+	++liveBlocks;
+	if (debug) {
+		std::cout << "Allocated a " << (size >> 10) << " KiB block of memory type " << pool.memoryType
+			<< ", " << liveBlocks << " blocks live" << std::endl;
+	}
+
+	//reuse a released slot so block indices held by allocations stay valid
+	for (blockIndex = 0; blockIndex < pool.blocks.size(); ++blockIndex) {
+		if (!pool.blocks[blockIndex]) {
+			pool.blocks[blockIndex] = std::move(block);
+			return pool.blocks[blockIndex].get();
+		}
+	}
+	pool.blocks.push_back(std::move(block));
+	return pool.blocks.back().get();
+}
+
+void vkUtils::MemoryAllocator::release_block(Pool& pool, uint32_t blockIndex) {
+	Block& block = *pool.blocks[blockIndex];
+	if (block.mappedPointer) {
+		logicalDevice.unmapMemory(block.memory);
+	}
+	logicalDevice.freeMemory(block.memory);
+	pool.blocks[blockIndex].reset();
+	--liveBlocks;
+}
+
+bool vkUtils::MemoryAllocator::take_range(Block& block, uint32_t level, vk::DeviceSize& offset) {
+	//find the smallest free range which fits
+	int found = static_cast<int>(level);
+	while (found >= 0 && block.freeLists[found].empty()) {
+		--found;
+	}
+	if (found < 0) {
+		return false;
+	}
+
+	offset = *block.freeLists[found].begin();
+	block.freeLists[found].erase(block.freeLists[found].begin());
+
+	//split it down, keeping the lower half each time and freeing the upper
+	for (uint32_t split = static_cast<uint32_t>(found) + 1; split <= level; ++split) {
+		block.freeLists[split].insert(offset + (block.size >> split));
+	}
+	return true;
+}
+
+Allocation vkUtils::MemoryAllocator::allocate(vk::MemoryRequirements requirements, vk::MemoryPropertyFlags requestedProperties, bool linear) {
+	Allocation allocation;
+
+	uint32_t memoryType = findMemoryTypeIndex(physicalDevice, requirements.memoryTypeBits, requestedProperties);
+	uint32_t poolIndex = memoryType * 2 + ((separateTilings && linear) ? 1 : 0);
+
+	//ranges are aligned to their own size, so rounding up covers the alignment too
+	vk::DeviceSize rangeSize = round_up_pow2(std::max({ requirements.size, requirements.alignment, minimumRange }));
+
+	std::lock_guard<std::mutex> guard(lock);
+	Pool& pool = pools[poolIndex];
+
+	Block* block = nullptr;
+	uint32_t blockIndex = 0;
+	vk::DeviceSize offset = 0;
+	for (uint32_t i = 0; i < pool.blocks.size(); ++i) {
+		Block* candidate = pool.blocks[i].get();
+		if (candidate && rangeSize <= candidate->size
+			&& take_range(*candidate, log2(candidate->size / rangeSize), offset)) {
+			block = candidate;
+			blockIndex = i;
+			break;
+		}
+	}
+
+	if (!block) {
+		//small heaps get smaller blocks, big resources get a block to themselves
+		vk::DeviceSize heapSize = memoryProperties.memoryHeaps[memoryProperties.memoryTypes[memoryType].heapIndex].size;
+		vk::DeviceSize blockSize = std::max(std::min(defaultBlockSize, round_down_pow2(heapSize / 8)), rangeSize);
+		block = make_block(pool, blockSize, blockIndex);
+		if (!block || !take_range(*block, log2(block->size / rangeSize), offset)) {
+			return allocation;
+		}
+	}
+
+	uint32_t level = log2(block->size / rangeSize);
+	block->used += rangeSize;
+	usedBytes += rangeSize;
+
+	allocation.memory = block->memory;
+	allocation.offset = offset;
+	allocation.size = requirements.size;
+	allocation.mappedPointer = block->mappedPointer ? static_cast<char*>(block->mappedPointer) + offset : nullptr;
+	allocation.pool = poolIndex;
+	allocation.block = blockIndex;
+	allocation.level = level;
+	return allocation;
+}
+
+void vkUtils::MemoryAllocator::free(Allocation& allocation) {
+	if (!allocation.memory) {
+		return;
+	}
+
+	std::lock_guard<std::mutex> guard(lock);
+	Pool& pool = pools[allocation.pool];
+	Block& block = *pool.blocks[allocation.block];
+
+	uint32_t level = allocation.level;
+	vk::DeviceSize offset = allocation.offset;
+	vk::DeviceSize rangeSize = block.size >> level;
+	block.used -= rangeSize;
+	usedBytes -= rangeSize;
+
+	//merge with free buddies for as long as there are any
+	while (level > 0) {
+		vk::DeviceSize buddy = offset ^ (block.size >> level);
+		auto it = block.freeLists[level].find(buddy);
+		if (it == block.freeLists[level].end()) {
+			break;
+		}
+		block.freeLists[level].erase(it);
+		offset = std::min(offset, buddy);
+		--level;
+	}
+	block.freeLists[level].insert(offset);
+
+	//give empty blocks back, but keep one per pool around to avoid churn
+	if (block.used == 0) {
+		size_t pooledBlocks = std::count_if(pool.blocks.begin(), pool.blocks.end(),
+			[](const std::unique_ptr<Block>& b) { return b != nullptr; });
+		if (pooledBlocks > 1) {
+			release_block(pool, allocation.block);
+		}
+	}
+
+	allocation = Allocation();
+}
+
+uint32_t vkUtils::MemoryAllocator::block_count() const {
+	std::lock_guard<std::mutex> guard(lock);
+	return liveBlocks;
+}
+
+vk::DeviceSize vkUtils::MemoryAllocator::bytes_in_use() const {
+	std::lock_guard<std::mutex> guard(lock);
+	return usedBytes;
+}
\ No newline at end of file
@@ -0,0 +1,92 @@
+#pragma once
+#include "config.h"
+#include <set>
+#include <memory>
+#include <mutex>
+
+namespace vkUtils {
+
+	/**
+		Sub-allocates buffers and images from large device memory blocks.
+		Every block is a power of two in size and is carved up by buddy placement, so each
+		range is aligned to its own size and freeing merges neighbours back in O(log n).
+		Host visible blocks are mapped once for their whole lifetime.
+	*/
+	class MemoryAllocator {
+	public:
+		/*
+			\param logicalDevice the logical device
+			\param physicalDevice the physical device, for memory types and limits
+			\param debug whether the system is running in debug mode
+		*/
+		MemoryAllocator(vk::Device logicalDevice, vk::PhysicalDevice physicalDevice, bool debug);
+
+		/*
+			Free every remaining block, all allocations must be out of use.
+		*/
+		~MemoryAllocator();
+
+		/*
+			Find room for a resource.
+			\param requirements as reported by the device for the resource
+			\param requestedProperties properties the memory type must satisfy
+			\param linear whether the resource is a buffer or linearly tiled image
+			\returns the allocation, with a null memory handle on failure
+		*/
+		Allocation allocate(vk::MemoryRequirements requirements, vk::MemoryPropertyFlags requestedProperties, bool linear);
+
+		/*
+			Return an allocation's range to its block, and clear the allocation.
+		*/
+		void free(Allocation& allocation);
+
+		/*
+			\returns the number of device memory objects currently allocated
+		*/
+		uint32_t block_count() const;
+
+		/*
+			\returns the bytes currently handed out, including alignment padding
+		*/
+		vk::DeviceSize bytes_in_use() const;
+
+	private:
+		struct Block {
+			vk::DeviceMemory memory;
+			vk::DeviceSize size;
+			void* mappedPointer;
+			vk::DeviceSize used;
+			//free range offsets per level, level 0 is the whole block and each level halves the size
+			std::vector<std::set<vk::DeviceSize>> freeLists;
+		};
+
+		struct Pool {
+			uint32_t memoryType;
+			std::vector<std::unique_ptr<Block>> blocks;
+		};
+
+		vk::Device logicalDevice;
+		vk::PhysicalDevice physicalDevice;
+		bool debug;
+
+		vk::PhysicalDeviceMemoryProperties memoryProperties;
+		//linear and optimal resources only need their own pools when a granularity page is bigger than the smallest range
+		bool separateTilings;
+		uint32_t maxAllocationCount;
+
+		//indexed by memory type, then linear
+		std::vector<Pool> pools;
+		uint32_t liveBlocks{ 0 };
+		vk::DeviceSize usedBytes{ 0 };
+		mutable std::mutex lock;
+
+		Block* make_block(Pool& pool, vk::DeviceSize size, uint32_t& blockIndex);
+
+		/*
+			\returns whether a range of the level's size was found, writing its offset
+		*/
+		bool take_range(Block& block, uint32_t level, vk::DeviceSize& offset);
+
+		void release_block(Pool& pool, uint32_t blockIndex);
+	};
+}
\ No newline at end of file
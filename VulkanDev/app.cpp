@@ -1,11 +1,26 @@
 #include "app.h"
+#include <chrono>
 
-App::App(int width, int height, bool debug) {
-	build_glfw_window(width, height, debug);
+App::App(int width, int height, bool headless, const char* sceneFile, const EngineOptions& options) {
+	if (!headless) {
+		build_glfw_window(width, height, options.debug);
+	}
 
-	graphicsEngine = new Engine(width, height, window, debug);
+	graphicsEngine = new Engine(width, height, window, headless, options);
 
-	scene = new Scene();
+	if (sceneFile) {
+		auto loadStart = std::chrono::steady_clock::now();
+		scene = new Scene();
+		if (scene->load(sceneFile, graphicsEngine->mesh_registry())) {
+			double loadMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - loadStart).count();
+			std::cout << "Loaded " << scene->transforms.size() << " instances from " << sceneFile
+				<< " in " << loadMilliseconds << " ms" << std::endl;
+			return;
+		}
+		std::cout << "Falling back to the built in scene" << std::endl;
+		delete scene;
+	}
+	scene = new Scene(graphicsEngine->mesh_registry());
 }
 
 
@@ -27,9 +42,8 @@ void App::build_glfw_window(int width, int height, bool debugMode) {
 		}
 	}
 	else {
-		if (debugMode) {
-			std::cout << "GLFW window creation failed\n";
-		}
+		//there's nothing to render into, so carrying on would only fail later
+		throw std::runtime_error("GLFW window creation failed");
 	}
 }
 
@@ -42,6 +56,31 @@ void App::run() {
 	}
 }
 
+void App::run_headless(int frameCount, double targetSeconds) {
+	using clock = std::chrono::steady_clock;
+	clock::time_point start = clock::now();
+	double elapsed = 0.0;
+	int frames = 0;
+	uint64_t visible = 0, culled = 0, draws = 0;
+
+	while ((frameCount <= 0 || frames < frameCount) && (targetSeconds <= 0.0 || elapsed < targetSeconds))
+	{
+		graphicsEngine->render(scene);
+		visible += graphicsEngine->visible_instances_last_frame();
+		culled += graphicsEngine->culled_instances_last_frame();
+		draws += graphicsEngine->draws_last_frame();
+		++frames;
+		elapsed = std::chrono::duration<double>(clock::now() - start).count();
+	}
+
+	std::cout << "Rendered " << frames << " frames in " << elapsed << " s, "
+		<< (frames > 0 ? 1000.0 * elapsed / frames : 0.0) << " ms per frame\n";
+	if (frames > 0) {
+		std::cout << "Culling: " << visible / frames << " visible and " << culled / frames << " culled instances per frame, in "
+			<< draws / frames << " draws\n";
+	}
+}
+
 void App::calculateFrameRate() {
 	currentTime = glfwGetTime();
 	double delta = currentTime - lastTime;
@@ -50,7 +89,8 @@ void App::calculateFrameRate() {
 	{
 		int framerate{ std::max(1, int(numFrames / delta)) };
 		std::stringstream title;
-		title << "Running at " << framerate << " fps .";
+		title << "Running at " << framerate << " fps, " << graphicsEngine->visible_instances_last_frame()
+			<< " visible, " << graphicsEngine->culled_instances_last_frame() << " culled.";
 		glfwSetWindowTitle(window, title.str().c_str());
 		lastTime = currentTime;
 		numFrames = -1;
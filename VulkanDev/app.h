@@ -6,7 +6,7 @@
 class App {
 private:
 	Engine* graphicsEngine;
-	GLFWwindow* window;
+	GLFWwindow* window{ nullptr };
 	Scene* scene;
 
 	double lastTime, currentTime;
@@ -18,7 +18,20 @@ private:
 	void calculateFrameRate();
 
 public:
-	App(int width, int height, bool debug);
+	/*
+		Throws if a window is needed and can't be made.
+		\param headless render without a window, see Engine
+		\param sceneFile a scene file to map the instances from, nullptr for the built in scene
+		\param options what the engine is made with
+	*/
+	App(int width, int height, bool headless, const char* sceneFile, const EngineOptions& options);
 	~App();
 	void run();
+
+	/*
+		Render without a window until either limit is reached, a limit of zero is ignored.
+		\param frameCount the number of frames to render
+		\param targetSeconds how long to keep rendering for
+	*/
+	void run_headless(int frameCount, double targetSeconds);
 };
\ No newline at end of file
@@ -11,7 +11,7 @@ namespace vkInit {
 	struct commandBufferInputChunk {
 		vk::Device device;
 		vk::CommandPool commandPool;
-		std::vector<vkUtils::SwapChainFrame>& frames;
+		std::vector<vkUtils::FrameContext>& frames;
 	};
 
 	/**
@@ -41,6 +41,30 @@ namespace vkInit {
 		return nullptr;
 	}
 
+	/**
+		Make a transient command pool, its buffers are recycled all at once by resetting the pool.
+		\param device the logical device
+		\param queueFamilyIndex the queue family which the buffers will be submitted to
+		\param debug whether the system is running in debug mode
+		\returns the created command pool
+	*/
+	vk::CommandPool make_transient_command_pool(vk::Device device, uint32_t queueFamilyIndex, bool debug) {
+		vk::CommandPoolCreateInfo poolInfo;
+		poolInfo.flags = vk::CommandPoolCreateFlags() | vk::CommandPoolCreateFlagBits::eTransient;
+		poolInfo.queueFamilyIndex = queueFamilyIndex;
+
+		try {
+			return device.createCommandPool(poolInfo);
+		}
+		catch (vk::SystemError err) {
+			if (debug) {
+				std::cout << "Failed to create transient Command Pool" << std::endl;
+			}
+		}
+
+		return nullptr;
+	}
+
 	/**
 		Make a main command buffer.
 		\param inputChunk the required input info
@@ -77,29 +101,46 @@ namespace vkInit {
 
 
 	/**
-		Make a command buffer for each swapchain frame and return a main command buffer.
-		\param inputChunk the required input info
+		Make the command buffers for each frame context: a primary buffer, plus a
+		secondary buffer for every recording thread. Each buffer gets its own transient pool,
+		so threads never share a pool and a frame's buffers are recycled by resetting the pools.
+		\param inputChunk the required input info, the command pool field is unused
+		\param queueFamilyIndex the queue family which the buffers will be submitted to
+		\param threadCount the number of threads recording secondary buffers
 		\param debug whether the system is running in debug mode
-		\returns the main command buffer
 	*/
-	void make_frame_command_buffers(commandBufferInputChunk inputChunk, bool debug) {
+	void make_frame_command_buffers(commandBufferInputChunk inputChunk, uint32_t queueFamilyIndex, size_t threadCount, bool debug) {
 		vk::CommandBufferAllocateInfo allocInfo = {};
-		allocInfo.commandPool = inputChunk.commandPool;
-		allocInfo.level = vk::CommandBufferLevel::ePrimary;
 		allocInfo.commandBufferCount = 1;
 
-		//Make a command buffer for each frame
+		//Make command buffers for each frame
 		for (int i = 0; i < inputChunk.frames.size(); ++i)
 		{
+			vkUtils::FrameContext& frame = inputChunk.frames[i];
+
 			try {
-				inputChunk.frames[i].commangBuffer = inputChunk.device.allocateCommandBuffers(allocInfo)[0];
+				frame.commandPool = make_transient_command_pool(inputChunk.device, queueFamilyIndex, debug);
+				allocInfo.commandPool = frame.commandPool;
+				allocInfo.level = vk::CommandBufferLevel::ePrimary;
+				frame.commandBuffer = inputChunk.device.allocateCommandBuffers(allocInfo)[0];
+
+				frame.workerCommandPools.resize(threadCount);
+				frame.workerCommandBuffers.resize(threadCount);
+				allocInfo.level = vk::CommandBufferLevel::eSecondary;
+				for (size_t thread = 0; thread < threadCount; ++thread)
+				{
+					frame.workerCommandPools[thread] = make_transient_command_pool(inputChunk.device, queueFamilyIndex, debug);
+					allocInfo.commandPool = frame.workerCommandPools[thread];
+					frame.workerCommandBuffers[thread] = inputChunk.device.allocateCommandBuffers(allocInfo)[0];
+				}
+
 				if (debug) {
-					std::cout << "Allocated command buffer for frame " << i << std::endl;
+					std::cout << "Allocated command buffers for frame " << i << std::endl;
 				}
 			}
 			catch (vk::SystemError err) {
 				if (debug) {
-					std::cout << "Failed to allocate command buffer for frame " << i << std::endl;
+					std::cout << "Failed to allocate command buffers for frame " << i << std::endl;
 				}
 			}
 		}
@@ -10,11 +10,16 @@
 #include <fstream>
 #include <sstream>
 #include <unordered_map>
+#include <algorithm>
 
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 
 
+namespace vkUtils {
+	class MemoryAllocator;
+}
+
 /*
 	Data structures used for creating buffers
 	and allocating memory
@@ -26,6 +31,23 @@ struct BufferInputChunk {
 	vk::Device logicalDevice;
 	vk::PhysicalDevice physicalDevice;
 	vk::MemoryPropertyFlags memoryProperties;
+	vkUtils::MemoryAllocator* allocator;
+};
+
+/*
+	a range of a device memory block, handed out by the allocator
+*/
+struct Allocation {
+	vk::DeviceMemory memory;
+	vk::DeviceSize offset{ 0 };
+	vk::DeviceSize size{ 0 };
+	//host visible memory stays mapped, this points at the start of the range
+	void* mappedPointer{ nullptr };
+
+	//where the range came from, for freeing it
+	uint32_t pool{ 0 };
+	uint32_t block{ 0 };
+	uint32_t level{ 0 };
 };
 
 /*
@@ -33,12 +55,22 @@ struct BufferInputChunk {
 */
 struct Buffer {
 	vk::Buffer buffer;
-	vk::DeviceMemory bufferMemory;
+	Allocation allocation;
 };
 
 //----------------Assets------------------//
-enum class meshTypes {
-	TRIANGLE,
-	SQUARE,
-	STAR
+/*
+	Refers to a mesh in the mesh registry, the generation tells a live mesh from one whose slot was reused
+*/
+struct MeshHandle {
+	uint32_t index{ 0xFFFFFFFF };
+	uint32_t generation{ 0 };
+
+	bool operator==(const MeshHandle& other) const {
+		return index == other.index && generation == other.generation;
+	}
+
+	bool operator!=(const MeshHandle& other) const {
+		return !(*this == other);
+	}
 };
\ No newline at end of file
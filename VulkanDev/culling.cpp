@@ -0,0 +1,171 @@
+#include "culling.h"
+
+//the AVX2 kernel uses FMA, which MSVC's /arch:AVX2 implies and GCC and Clang enable separately
+#if defined(__AVX2__) && (defined(__FMA__) || defined(_MSC_VER))
+#include <immintrin.h>
+#define CULLING_KERNEL_AVX2
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define CULLING_KERNEL_SSE
+#elif defined(__ARM_NEON) || defined(_M_ARM64)
+#include <arm_neon.h>
+#define CULLING_KERNEL_NEON
+#endif
+
+Frustum make_frustum(const glm::mat4& viewProjection) {
+	//glm is column major, so row i is (m[0][i], m[1][i], m[2][i], m[3][i])
+	glm::mat4 rows = glm::transpose(viewProjection);
+
+	Frustum frustum;
+	frustum.planes[0] = rows[3] + rows[0]; //left
+	frustum.planes[1] = rows[3] - rows[0]; //right
+	frustum.planes[2] = rows[3] + rows[1]; //bottom
+	frustum.planes[3] = rows[3] - rows[1]; //top
+	frustum.planes[4] = rows[3] + rows[2]; //near, exact for a -1..1 depth range and a little loose for 0..1
+	frustum.planes[5] = rows[3] - rows[2]; //far
+
+	//normalized so that plane distances are in world units, like the radii
+	for (glm::vec4& plane : frustum.planes) {
+		plane /= glm::length(glm::vec3(plane));
+	}
+	return frustum;
+}
+
+namespace {
+	inline bool sphere_visible(const Frustum& frustum, float x, float y, float z, float radius) {
+		for (const glm::vec4& plane : frustum.planes) {
+			if (plane.x * x + plane.y * y + plane.z * z + plane.w < -radius) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	inline float largest_scale(const TransformStore& transforms, size_t i) {
+		return std::max(std::abs(transforms.scaleX[i]), std::max(std::abs(transforms.scaleY[i]), std::abs(transforms.scaleZ[i])));
+	}
+
+	size_t cull_spheres_scalar(const TransformStore& transforms, float meshRadius, const Frustum& frustum, size_t first, size_t last, uint32_t* out) {
+		size_t count = 0;
+		for (size_t i = first; i < last; ++i) {
+			float radius = meshRadius * largest_scale(transforms, i);
+			if (sphere_visible(frustum, transforms.positionX[i], transforms.positionY[i], transforms.positionZ[i], radius)) {
+				out[count++] = static_cast<uint32_t>(i);
+			}
+		}
+		return count;
+	}
+
+	/*
+		Write the indices base + k for every set bit k of mask
+	*/
+	inline size_t append_survivors(uint32_t* out, size_t count, size_t base, unsigned int mask) {
+		while (mask) {
+			unsigned int bit = 0;
+			while (!(mask & (1u << bit))) {
+				++bit;
+			}
+			out[count++] = static_cast<uint32_t>(base + bit);
+			mask &= mask - 1;
+		}
+		return count;
+	}
+}
+
+#if defined(CULLING_KERNEL_AVX2)
+
+size_t cull_spheres(const TransformStore& transforms, float meshRadius, const Frustum& frustum, size_t first, size_t last, uint32_t* out) {
+	const __m256 signMask = _mm256_set1_ps(-0.0f);
+	const __m256 radiusScale = _mm256_set1_ps(meshRadius);
+
+	size_t count = 0;
+	size_t i = first;
+	for (; i + 8 <= last; i += 8) {
+		__m256 x = _mm256_loadu_ps(&transforms.positionX[i]);
+		__m256 y = _mm256_loadu_ps(&transforms.positionY[i]);
+		__m256 z = _mm256_loadu_ps(&transforms.positionZ[i]);
+		__m256 scale = _mm256_max_ps(_mm256_andnot_ps(signMask, _mm256_loadu_ps(&transforms.scaleX[i])),
+			_mm256_max_ps(_mm256_andnot_ps(signMask, _mm256_loadu_ps(&transforms.scaleY[i])),
+				_mm256_andnot_ps(signMask, _mm256_loadu_ps(&transforms.scaleZ[i]))));
+		__m256 negativeRadius = _mm256_xor_ps(signMask, _mm256_mul_ps(radiusScale, scale));
+
+		__m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+		for (const glm::vec4& plane : frustum.planes) {
+			__m256 distance = _mm256_fmadd_ps(_mm256_set1_ps(plane.x), x,
+				_mm256_fmadd_ps(_mm256_set1_ps(plane.y), y,
+					_mm256_fmadd_ps(_mm256_set1_ps(plane.z), z, _mm256_set1_ps(plane.w))));
+			inside = _mm256_and_ps(inside, _mm256_cmp_ps(distance, negativeRadius, _CMP_GE_OQ));
+		}
+		count = append_survivors(out, count, i, static_cast<unsigned int>(_mm256_movemask_ps(inside)));
+	}
+	return count + cull_spheres_scalar(transforms, meshRadius, frustum, i, last, out + count);
+}
+
+#elif defined(CULLING_KERNEL_SSE)
+
+size_t cull_spheres(const TransformStore& transforms, float meshRadius, const Frustum& frustum, size_t first, size_t last, uint32_t* out) {
+	const __m128 signMask = _mm_set1_ps(-0.0f);
+	const __m128 radiusScale = _mm_set1_ps(meshRadius);
+
+	size_t count = 0;
+	size_t i = first;
+	for (; i + 4 <= last; i += 4) {
+		__m128 x = _mm_loadu_ps(&transforms.positionX[i]);
+		__m128 y = _mm_loadu_ps(&transforms.positionY[i]);
+		__m128 z = _mm_loadu_ps(&transforms.positionZ[i]);
+		__m128 scale = _mm_max_ps(_mm_andnot_ps(signMask, _mm_loadu_ps(&transforms.scaleX[i])),
+			_mm_max_ps(_mm_andnot_ps(signMask, _mm_loadu_ps(&transforms.scaleY[i])),
+				_mm_andnot_ps(signMask, _mm_loadu_ps(&transforms.scaleZ[i]))));
+		__m128 negativeRadius = _mm_xor_ps(signMask, _mm_mul_ps(radiusScale, scale));
+
+		__m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+		for (const glm::vec4& plane : frustum.planes) {
+			__m128 distance = _mm_add_ps(
+				_mm_add_ps(_mm_mul_ps(_mm_set1_ps(plane.x), x), _mm_mul_ps(_mm_set1_ps(plane.y), y)),
+				_mm_add_ps(_mm_mul_ps(_mm_set1_ps(plane.z), z), _mm_set1_ps(plane.w)));
+			inside = _mm_and_ps(inside, _mm_cmpge_ps(distance, negativeRadius));
+		}
+		count = append_survivors(out, count, i, static_cast<unsigned int>(_mm_movemask_ps(inside)));
+	}
+	return count + cull_spheres_scalar(transforms, meshRadius, frustum, i, last, out + count);
+}
+
+#elif defined(CULLING_KERNEL_NEON)
+
+size_t cull_spheres(const TransformStore& transforms, float meshRadius, const Frustum& frustum, size_t first, size_t last, uint32_t* out) {
+	const float32x4_t radiusScale = vdupq_n_f32(meshRadius);
+	//lane k contributes bit k of the survivor mask
+	const uint32_t laneBitValues[4] = { 1, 2, 4, 8 };
+	const uint32x4_t laneBits = vld1q_u32(laneBitValues);
+
+	size_t count = 0;
+	size_t i = first;
+	for (; i + 4 <= last; i += 4) {
+		float32x4_t x = vld1q_f32(&transforms.positionX[i]);
+		float32x4_t y = vld1q_f32(&transforms.positionY[i]);
+		float32x4_t z = vld1q_f32(&transforms.positionZ[i]);
+		float32x4_t scale = vmaxq_f32(vabsq_f32(vld1q_f32(&transforms.scaleX[i])),
+			vmaxq_f32(vabsq_f32(vld1q_f32(&transforms.scaleY[i])), vabsq_f32(vld1q_f32(&transforms.scaleZ[i]))));
+		float32x4_t negativeRadius = vnegq_f32(vmulq_f32(radiusScale, scale));
+
+		uint32x4_t inside = vdupq_n_u32(0xFFFFFFFF);
+		for (const glm::vec4& plane : frustum.planes) {
+			float32x4_t distance = vmlaq_f32(vmlaq_f32(vmlaq_f32(vdupq_n_f32(plane.w), vdupq_n_f32(plane.z), z),
+				vdupq_n_f32(plane.y), y), vdupq_n_f32(plane.x), x);
+			inside = vandq_u32(inside, vcgeq_f32(distance, negativeRadius));
+		}
+		uint32x4_t bits = vandq_u32(inside, laneBits);
+		uint32x2_t pairs = vadd_u32(vget_low_u32(bits), vget_high_u32(bits));
+		unsigned int mask = vget_lane_u32(vpadd_u32(pairs, pairs), 0);
+		count = append_survivors(out, count, i, mask);
+	}
+	return count + cull_spheres_scalar(transforms, meshRadius, frustum, i, last, out + count);
+}
+
+#else
+
+size_t cull_spheres(const TransformStore& transforms, float meshRadius, const Frustum& frustum, size_t first, size_t last, uint32_t* out) {
+	return cull_spheres_scalar(transforms, meshRadius, frustum, first, last, out);
+}
+
+#endif
\ No newline at end of file
@@ -0,0 +1,26 @@
+#pragma once
+#include "config.h"
+#include "transform_store.h"
+
+/**
+	The six planes of a view frustum, each as (normal, distance) with the normal pointing inwards
+*/
+struct Frustum {
+	glm::vec4 planes[6];
+};
+
+/*
+	Extract the frustum planes of a combined view projection matrix.
+*/
+Frustum make_frustum(const glm::mat4& viewProjection);
+
+/*
+	Test the bounding spheres of instances [first, last) against a frustum, several at a time.
+	Each sphere is centered on the instance's position, with the mesh's radius scaled by its largest scale.
+	\param transforms the instances to test
+	\param meshRadius radius of the mesh's bounding sphere around its origin
+	\param frustum the frustum to test against
+	\param out receives the indices of the instances which survive, in order, needs room for last - first
+	\returns the number of survivors
+*/
+size_t cull_spheres(const TransformStore& transforms, float meshRadius, const Frustum& frustum, size_t first, size_t last, uint32_t* out);
\ No newline at end of file
@@ -47,10 +47,18 @@ vk::DescriptorSetLayout vkInit::make_descriptor_set_layout(
 		} VkDescriptorSetLayoutCreateInfo;
 	*/
 	vk::DescriptorSetLayoutCreateInfo layoutInfo;
-	layoutInfo.flags = vk::DescriptorSetLayoutCreateFlagBits();
+	layoutInfo.flags = bindings.layoutFlags;
 	layoutInfo.bindingCount = bindings.count;
 	layoutInfo.pBindings = layoutBindings.data();
 
+	//partially bound and update after bind arrays need their flags chained on
+	vk::DescriptorSetLayoutBindingFlagsCreateInfo bindingFlagsInfo;
+	if (!bindings.bindingFlags.empty()) {
+		bindingFlagsInfo.bindingCount = bindings.count;
+		bindingFlagsInfo.pBindingFlags = bindings.bindingFlags.data();
+		layoutInfo.pNext = &bindingFlagsInfo;
+	}
+
 	try {
 		return device.createDescriptorSetLayout(layoutInfo);
 	}
@@ -111,6 +119,33 @@ vk::DescriptorPool vkInit::make_descriptor_pool(
 	}
 }
 
+/*
+	Make a pool for a single set of update after bind textures
+
+	\param device the logical device
+	\param descriptorCount the number of combined image samplers in the set
+	\returns the created descriptor pool
+*/
+vk::DescriptorPool vkInit::make_bindless_descriptor_pool(vk::Device device, uint32_t descriptorCount) {
+	vk::DescriptorPoolSize poolSize;
+	poolSize.type = vk::DescriptorType::eCombinedImageSampler;
+	poolSize.descriptorCount = descriptorCount;
+
+	vk::DescriptorPoolCreateInfo poolInfo;
+	poolInfo.flags = vk::DescriptorPoolCreateFlagBits::eUpdateAfterBind;
+	poolInfo.maxSets = 1;
+	poolInfo.poolSizeCount = 1;
+	poolInfo.pPoolSizes = &poolSize;
+
+	try {
+		return device.createDescriptorPool(poolInfo);
+	}
+	catch (vk::SystemError err) {
+		std::cout << "Failed to make bindless descriptor pool " << std::endl;
+		return nullptr;
+	}
+}
+
 /*
 	Allocate a descriptor set from a pool.
 	\param device the logical device
@@ -12,6 +12,9 @@ namespace vkInit {
 		std::vector<vk::DescriptorType> types;
 		std::vector<int> counts;
 		std::vector<vk::ShaderStageFlags> stages;
+		//optional, one per binding when set
+		std::vector<vk::DescriptorBindingFlags> bindingFlags;
+		vk::DescriptorSetLayoutCreateFlags layoutFlags;
 	};
 
 	/*
@@ -37,6 +40,15 @@ namespace vkInit {
 		vk::Device device, uint32_t size, const descriptorSetLayoutData& bindings
 	);
 
+	/*
+		Make a pool for a single set of update after bind textures
+
+		\param device the logical device
+		\param descriptorCount the number of combined image samplers in the set
+		\returns the created descriptor pool
+	*/
+	vk::DescriptorPool make_bindless_descriptor_pool(vk::Device device, uint32_t descriptorCount);
+
 	/*
 		Allocate a descriptor set from a pool.
 		\param device the logical device 
@@ -53,21 +53,82 @@ namespace vkInit {
 		return requiredExtensions.empty();
 	}
 
+	/**
+		\param headless whether the engine renders without a surface
+		\returns the device extensions the engine needs
+	*/
+	std::vector<const char*> required_device_extensions(bool headless) {
+		std::vector<const char*> extensions;
+
+		if (!headless) {
+			extensions.push_back(VK_KHR_SWAPCHAIN_EXTENSION_NAME);
+		}
+
+		return extensions;
+	}
+
+	/*
+		\returns whether indirect draws may start past the first instance, every indirect path places its instances that way
+	*/
+	bool supports_draw_indirect_first_instance(const vk::PhysicalDevice& device) {
+		return device.getFeatures().drawIndirectFirstInstance;
+	}
+
+	/*
+		\returns whether the device can take its draw count from a buffer, and start indirect draws past the first instance,
+		which GPU culling needs
+	*/
+	bool supports_draw_indirect_count(const vk::PhysicalDevice& device) {
+		auto features = device.getFeatures2<vk::PhysicalDeviceFeatures2, vk::PhysicalDeviceVulkan12Features>();
+		return features.get<vk::PhysicalDeviceVulkan12Features>().drawIndirectCount
+			&& supports_draw_indirect_first_instance(device);
+	}
+
+	/*
+		\returns whether the device can index a large, partially bound array of textures updated after binding,
+		and draw many indirect draws in one call starting past the first instance, which bindless materials need
+	*/
+	bool supports_bindless(const vk::PhysicalDevice& device) {
+		auto features = device.getFeatures2<vk::PhysicalDeviceFeatures2, vk::PhysicalDeviceVulkan12Features>();
+		const vk::PhysicalDeviceVulkan12Features& vulkan12 = features.get<vk::PhysicalDeviceVulkan12Features>();
+		return features.get<vk::PhysicalDeviceFeatures2>().features.multiDrawIndirect
+			&& features.get<vk::PhysicalDeviceFeatures2>().features.drawIndirectFirstInstance
+			&& vulkan12.runtimeDescriptorArray
+			&& vulkan12.descriptorBindingPartiallyBound
+			&& vulkan12.descriptorBindingSampledImageUpdateAfterBind
+			&& vulkan12.shaderSampledImageArrayNonUniformIndexing;
+	}
+
 	/**
 		Check whether the given physical device is suitable for the system.
 		\param device the physical device to check.
+		\param headless whether the engine renders without a surface
 		\debug whether the system is running in debug mode.
 		\returns whether the device is suitable.
 	*/
 
-	bool isSuitable(const vk::PhysicalDevice& device, const bool debug) {
+	bool isSuitable(const vk::PhysicalDevice& device, bool headless, const bool debug) {
 		if (debug) {
 			std::cout << "Checking if device is suitable\n";
 		}
 
-		const std::vector<const char*> requestedExtensions = {
-			VK_KHR_SWAPCHAIN_EXTENSION_NAME
-		};
+		//frame pacing is built on timeline semaphores, which are core in 1.2
+		if (device.getProperties().apiVersion < VK_API_VERSION_1_2) {
+			if (debug) {
+				std::cout << "Device doesn't support Vulkan 1.2\n";
+			}
+			return false;
+		}
+
+		auto features = device.getFeatures2<vk::PhysicalDeviceFeatures2, vk::PhysicalDeviceVulkan12Features>();
+		if (!features.get<vk::PhysicalDeviceVulkan12Features>().timelineSemaphore) {
+			if (debug) {
+				std::cout << "Device doesn't support timeline semaphores\n";
+			}
+			return false;
+		}
+
+		const std::vector<const char*> requestedExtensions = required_device_extensions(headless);
 
 		if (debug) {
 			std::cout << "We are requesting device extensions:\n";
@@ -92,7 +153,7 @@ namespace vkInit {
 		return true;
 	}
 
-	vk::PhysicalDevice choose_physical_device(const vk::Instance& instance, const bool debug) {
+	vk::PhysicalDevice choose_physical_device(const vk::Instance& instance, bool headless, const bool debug) {
 		if (debug) {
 			std::cout << "Choosing Physical Device\n";
 		}
@@ -110,7 +171,7 @@ namespace vkInit {
 			if (debug) {
 				log_device_properties(device);
 			}
-			if (isSuitable(device, debug))
+			if (isSuitable(device, headless, debug))
 			{
 				return device;
 			}
@@ -124,15 +185,36 @@ namespace vkInit {
 		vkUtil::QueueFamilyIndices indices = vkUtil::findQueueFamilies(physicalDevice, surface, debug);
 		float queuePriority = 1.0f;
 
-		vk::DeviceQueueCreateInfo queueCreateInfo = vk::DeviceQueueCreateInfo(
-			vk::DeviceQueueCreateFlags(), indices.graphicsFamily.value(), 1, &queuePriority
-		);
-
-		std::vector<const char*> deviceExtensions = {
-			VK_KHR_SWAPCHAIN_EXTENSION_NAME
+		//one queue from each distinct family
+		std::set<uint32_t> uniqueFamilies = {
+			indices.graphicsFamily.value(), indices.presentFamily.value(), indices.transferFamily.value()
 		};
+		std::vector<vk::DeviceQueueCreateInfo> queueCreateInfos;
+		for (uint32_t family : uniqueFamilies)
+		{
+			queueCreateInfos.push_back(vk::DeviceQueueCreateInfo(
+				vk::DeviceQueueCreateFlags(), family, 1, &queuePriority
+			));
+		}
+
+		//without a surface there is nothing to present to
+		std::vector<const char*> deviceExtensions = required_device_extensions(!surface);
 
 		vk::PhysicalDeviceFeatures deviceFeatures = vk::PhysicalDeviceFeatures();
+		//optional, for bindless materials
+		bool bindless = supports_bindless(physicalDevice);
+		deviceFeatures.multiDrawIndirect = bindless;
+		//optional, GPU culling and bindless materials draw instance ranges indirectly
+		deviceFeatures.drawIndirectFirstInstance = supports_draw_indirect_first_instance(physicalDevice);
+
+		vk::PhysicalDeviceVulkan12Features vulkan12Features;
+		vulkan12Features.timelineSemaphore = VK_TRUE;
+		//optional, only the GPU culling path draws with it
+		vulkan12Features.drawIndirectCount = supports_draw_indirect_count(physicalDevice);
+		vulkan12Features.runtimeDescriptorArray = bindless;
+		vulkan12Features.descriptorBindingPartiallyBound = bindless;
+		vulkan12Features.descriptorBindingSampledImageUpdateAfterBind = bindless;
+		vulkan12Features.shaderSampledImageArrayNonUniformIndexing = bindless;
 
 		std::vector<const char*> enabledLayers;
 
@@ -141,7 +223,8 @@ namespace vkInit {
 			enabledLayers.push_back("VK_LAYER_KHRONOS_validation");
 		}
 		vk::DeviceCreateInfo deviceInfo = vk::DeviceCreateInfo(
-			vk::DeviceCreateFlags(), 1, &queueCreateInfo, enabledLayers.size(), enabledLayers.data(), deviceExtensions.size(), deviceExtensions.data(), &deviceFeatures);
+			vk::DeviceCreateFlags(), static_cast<uint32_t>(queueCreateInfos.size()), queueCreateInfos.data(), enabledLayers.size(), enabledLayers.data(), deviceExtensions.size(), deviceExtensions.data(), &deviceFeatures);
+		deviceInfo.pNext = &vulkan12Features;
 
 		try {
 			vk::Device device = physicalDevice.createDevice(deviceInfo);
@@ -164,19 +247,20 @@ namespace vkInit {
 	}
 
 	/**
-		get the graphics queue
+		get the graphics, present and transfer queues
 
 		/param physicalDevice the physical device
 		/param device the logic device
 		/param debug whether the system is running in debug mode
-		/returns the physical device's graphics queue
+		/returns the physical device's graphics, present and transfer queues
 	**/
-	std::array<vk::Queue, 2> get_queue(vk::PhysicalDevice physicalDevice, vk::Device device, vk::SurfaceKHR surface, bool debug) {
+	std::array<vk::Queue, 3> get_queue(vk::PhysicalDevice physicalDevice, vk::Device device, vk::SurfaceKHR surface, bool debug) {
 		vkUtil::QueueFamilyIndices indices = vkUtil::findQueueFamilies(physicalDevice, surface, debug);
 
 		return { {
 				device.getQueue(indices.graphicsFamily.value(), 0),
 				device.getQueue(indices.presentFamily.value(), 0),
+				device.getQueue(indices.transferFamily.value(), 0),
 			} };
 	}
 
@@ -0,0 +1,74 @@
+#include "draw_packets.h"
+#include <array>
+
+uint64_t vkUtil::make_sort_key(uint32_t pipeline, uint32_t material, uint32_t meshIndex, uint32_t lod, float depth) {
+	uint64_t depthBucket = static_cast<uint64_t>(std::clamp(depth, 0.0f, 1.0f) * 65535.0f);
+	return (uint64_t(pipeline & 0xFF) << 56)
+		| (uint64_t(material & 0xFFFF) << 40)
+		| (uint64_t(meshIndex & 0x1FFFFF) << 19)
+		| (uint64_t(lod & 0x7) << 16)
+		| depthBucket;
+}
+
+uint32_t vkUtil::mesh_index(uint64_t key) {
+	return static_cast<uint32_t>((key >> 19) & 0x1FFFFF);
+}
+
+uint32_t vkUtil::mesh_lod(uint64_t key) {
+	return static_cast<uint32_t>((key >> 16) & 0x7);
+}
+
+void vkUtil::sort_packets(std::vector<DrawPacket>& packets, std::vector<DrawPacket>& scratch, vkUtils::WorkerPool* workers) {
+	size_t count = packets.size();
+	if (count < 2) {
+		return;
+	}
+	scratch.resize(count);
+
+	//chunks are contiguous and scattered in order, which keeps every pass stable
+	const size_t minimumChunk = 4096;
+	size_t chunkCount = std::max<size_t>(1, std::min(workers->thread_count(), count / minimumChunk));
+	std::vector<std::array<size_t, 256>> histograms(chunkCount);
+
+	for (int shift = 0; shift < 64; shift += 8) {
+		workers->parallel_for(chunkCount, [&](size_t chunk) {
+			std::array<size_t, 256>& histogram = histograms[chunk];
+			histogram.fill(0);
+			size_t first = chunk * count / chunkCount;
+			size_t last = (chunk + 1) * count / chunkCount;
+			for (size_t i = first; i < last; ++i) {
+				++histogram[(packets[i].key >> shift) & 0xFF];
+			}
+		});
+
+		//a byte every key shares leaves the order as it is
+		size_t firstDigitCount = 0;
+		uint64_t firstDigit = (packets[0].key >> shift) & 0xFF;
+		for (const std::array<size_t, 256>& histogram : histograms) {
+			firstDigitCount += histogram[firstDigit];
+		}
+		if (firstDigitCount == count) {
+			continue;
+		}
+
+		//turn counts into write offsets, digit major so that chunks keep their order within a digit
+		size_t offset = 0;
+		for (size_t digit = 0; digit < 256; ++digit) {
+			for (std::array<size_t, 256>& histogram : histograms) {
+				size_t digitCount = histogram[digit];
+				histogram[digit] = offset;
+				offset += digitCount;
+			}
+		}
+
+		workers->parallel_for(chunkCount, [&](size_t chunk) {
+			std::array<size_t, 256>& histogram = histograms[chunk];
+			size_t first = chunk * count / chunkCount;
+			size_t last = (chunk + 1) * count / chunkCount;
+			for (size_t i = first; i < last; ++i) {
+				scratch[histogram[(packets[i].key >> shift) & 0xFF]++] = packets[i];
+			}
+		});
+		packets.swap(scratch);
+	}
+}
\ No newline at end of file
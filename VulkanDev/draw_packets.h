@@ -0,0 +1,45 @@
+#pragma once
+#include "config.h"
+#include "worker_pool.h"
+
+namespace vkUtil {
+
+	/**
+		One visible instance waiting to be drawn. Packets sorted by key come out grouped by pipeline,
+		then material, then mesh, then level of detail, then front to back, so neighbours with the same batch can share a draw.
+		Key layout, from the top bit down: pipeline 8 bits, material 16, mesh index 21, level of detail 3, depth bucket 16
+	*/
+	struct DrawPacket {
+		uint64_t key;
+		uint32_t instance;
+		//generation of the mesh in the key, to rebuild its handle
+		uint32_t meshGeneration;
+	};
+
+	//packets whose keys agree on these bits can be drawn as one instanced draw
+	constexpr uint64_t batchKeyMask = ~uint64_t(0xFFFF);
+
+	/*
+		\param depth in [0, 1], 0 nearest
+		\returns the packet key
+	*/
+	uint64_t make_sort_key(uint32_t pipeline, uint32_t material, uint32_t meshIndex, uint32_t lod, float depth);
+
+	/*
+		\returns the mesh index held in a key
+	*/
+	uint32_t mesh_index(uint64_t key);
+
+	/*
+		\returns the level of detail held in a key
+	*/
+	uint32_t mesh_lod(uint64_t key);
+
+	/*
+		Sort packets by key with a stable LSD radix sort, 8 bits a pass, split across the pool.
+		Passes over bytes which every key shares are skipped, so unused key fields cost nothing.
+		\param packets sorted in place
+		\param scratch working space, resized as needed
+	*/
+	void sort_packets(std::vector<DrawPacket>& packets, std::vector<DrawPacket>& scratch, vkUtils::WorkerPool* workers);
+}
\ No newline at end of file
@@ -8,13 +8,34 @@
 #include "commands.h"
 #include "sync.h"
 #include "descriptors.h"
+#include "culling.h"
+#include "draw_packets.h"
 
-Engine::Engine(int width, int height, GLFWwindow* window, bool debug) {
+Engine::Engine(int width, int height, GLFWwindow* window, bool headless, const EngineOptions& options) {
+
+	if (!headless && !window) {
+		throw std::runtime_error("A windowed engine needs a window to render into");
+	}
 
 	this->width = width;
 	this->height = height;
-	this->window = window;
-	this->debugMode = debug;
+	this->window = headless ? nullptr : window;
+	this->debugMode = options.debug;
+	this->headless = headless;
+	//deeper rings trade latency for throughput
+	this->maxFramesInFlight = std::clamp(options.framesInFlight, 1, 4);
+	this->instanceCapacity = options.instanceCapacity;
+	this->gpuCulling = options.gpuCulling;
+	this->bindless = options.bindless;
+	this->meshArchive = options.meshArchive;
+	this->vertexLayout = options.vertexLayout;
+	this->optimizeMeshes = options.optimizeMeshes;
+	this->meshletCulling = options.meshletCulling;
+	this->lodErrorPixels = options.lodErrorPixels;
+
+	//the calling thread records too
+	size_t hardwareThreads = std::max(1u, std::thread::hardware_concurrency());
+	workers = new vkUtils::WorkerPool(hardwareThreads - 1);
 	if (debugMode) {
 		std::cout << "Making a graphics engine\n";
 	}
@@ -33,9 +54,16 @@ Engine::Engine(int width, int height, GLFWwindow* window, bool debug) {
 }
 
 void Engine::make_instance() {
-	instance = vkInit::make_instance(debugMode, "ID Tech 12");
+	instance = vkInit::make_instance(debugMode, headless, "ID Tech 12");
 	dldi = vk::DispatchLoaderDynamic(instance, vkGetInstanceProcAddr);
 
+	if (headless) {
+		if (debugMode) {
+			std::cout << "Running headless, no surface will be made\n";
+		}
+		return;
+	}
+
 	VkSurfaceKHR c_style_surface;
 	if (glfwCreateWindowSurface(instance, window, nullptr, &c_style_surface) != VK_SUCCESS)
 	{
@@ -59,12 +87,62 @@ void Engine::make_debug_message() {
 }
 
 void Engine::make_device() {
-	physicalDevice = vkInit::choose_physical_device(instance, debugMode);
-	vkUtil::findQueueFamilies(physicalDevice, surface, debugMode);
+	physicalDevice = vkInit::choose_physical_device(instance, headless, debugMode);
+	vkUtil::QueueFamilyIndices indices = vkUtil::findQueueFamilies(physicalDevice, surface, debugMode);
 	device = vkInit::create_logical_device(physicalDevice, surface, debugMode);
-	std::array<vk::Queue, 2> queues = vkInit::get_queue(physicalDevice, device, surface, debugMode);
+	if (gpuCulling && !vkInit::supports_draw_indirect_count(physicalDevice)) {
+		if (debugMode) {
+			std::cout << "Device can't draw with indirect counts or indirect first instances, culling on the CPU instead\n";
+		}
+		gpuCulling = false;
+	}
+	if (meshletCulling && !gpuCulling) {
+		if (debugMode) {
+			std::cout << "Meshlets are culled by the culling shader, drawing whole meshes without GPU culling\n";
+		}
+		meshletCulling = false;
+	}
+	if (bindless && !vkInit::supports_bindless(physicalDevice)) {
+		if (debugMode) {
+			std::cout << "Device can't index textures or multi draw indirectly, binding a descriptor set per material instead\n";
+		}
+		bindless = false;
+	}
+	if (bindless) {
+		auto properties = physicalDevice.getProperties2<vk::PhysicalDeviceProperties2, vk::PhysicalDeviceDescriptorIndexingProperties>();
+		const vk::PhysicalDeviceDescriptorIndexingProperties& indexing = properties.get<vk::PhysicalDeviceDescriptorIndexingProperties>();
+		bindlessTextureCapacity = std::min({ bindlessTextureCapacity,
+			indexing.maxPerStageDescriptorUpdateAfterBindSamplers,
+			indexing.maxPerStageDescriptorUpdateAfterBindSampledImages,
+			indexing.maxDescriptorSetUpdateAfterBindSampledImages });
+		maxDrawIndirectCount = properties.get<vk::PhysicalDeviceProperties2>().properties.limits.maxDrawIndirectCount;
+	}
+	//the model buffer is the largest storage buffer per instance, bound whole
+	maxInstanceCapacity = physicalDevice.getProperties().limits.maxStorageBufferRange / sizeof(glm::mat4);
+	if (instanceCapacity > maxInstanceCapacity) {
+		if (debugMode) {
+			std::cout << "Instance capacity clamped to the device's limit of " << maxInstanceCapacity << " transforms\n";
+		}
+		instanceCapacity = maxInstanceCapacity;
+	}
+	std::array<vk::Queue, 3> queues = vkInit::get_queue(physicalDevice, device, surface, debugMode);
 	graphicsQueue = queues[0];
 	presentQueue = queues[1];
+	transferQueue = queues[2];
+
+	allocator = new vkUtils::MemoryAllocator(device, physicalDevice, debugMode);
+
+	vkUtils::TransferSystemInputChunk transferInput;
+	transferInput.logicalDevice = device;
+	transferInput.transferQueue = transferQueue;
+	transferInput.transferFamily = indices.transferFamily.value();
+	transferInput.graphicsFamily = indices.graphicsFamily.value();
+	transferInput.timelineSemaphore = vkInit::make_timeline_semaphore(device, 0);
+	transferInput.allocator = allocator;
+	transferInput.stagingSize = stagingRingSize;
+	transferInput.physicalDevice = physicalDevice;
+	transferInput.debug = debugMode;
+	transfer = new vkUtils::TransferSystem(transferInput);
 
 	make_swapchain();
 	frameNumber = 0;
@@ -74,21 +152,28 @@ void Engine::make_device() {
 	Make a swapchain
 */
 void Engine::make_swapchain() {
-	vkInit::SwapChainBundle bundle = vkInit::create_swapchain(device, physicalDevice, surface, width, height, debugMode);
+	//offscreen targets stand in for the swapchain, one per frame in flight so that no acquire is needed
+	vkInit::SwapChainBundle bundle = headless ?
+		vkInit::create_offscreen_targets(device, physicalDevice, width, height, allocator, static_cast<uint32_t>(maxFramesInFlight), debugMode) :
+		vkInit::create_swapchain(device, physicalDevice, surface, width, height, debugMode);
 	swapchain = bundle.swapChain;
 	swapchainFrames = bundle.frames;
 	swapchainFormat = bundle.format;
 	swapchainExtent = bundle.extent;
-	maxFrameInFlight = static_cast<int>(swapchainFrames.size());
 
 	for (vkUtils::SwapChainFrame& frame : swapchainFrames)
 	{
 		frame.logicalDevice = device;
 		frame.physicalDevice = physicalDevice;
+		frame.allocator = allocator;
 		frame.width = swapchainExtent.width;
 		frame.height = swapchainExtent.height;
 
 		frame.make_depth_resources();
+
+		if (!headless) {
+			frame.renderFinished = vkInit::make_semaphore(device);
+		}
 	}
 }
 
@@ -108,14 +193,11 @@ void Engine::recreate_swapchain() {
 	cleanup_swapchain();
 	make_swapchain();
 	make_framebuffers();
-	make_frame_resources();
-	vkInit::commandBufferInputChunk commandBufferInput = { device, commandPool, swapchainFrames };
-	vkInit::make_frame_command_buffers(commandBufferInput, debugMode);
 }
 
 void Engine::make_descriptor_set_layout() {
 	vkInit::descriptorSetLayoutData bindings;
-	bindings.count = 2;
+	bindings.count = 3;
 	bindings.indices.push_back(0);
 	bindings.types.push_back(vk::DescriptorType::eUniformBuffer);
 	bindings.counts.push_back(1);
@@ -126,6 +208,12 @@ void Engine::make_descriptor_set_layout() {
 	bindings.counts.push_back(1);
 	bindings.stages.push_back(vk::ShaderStageFlagBits::eVertex);
 
+	//indices of the instances which survived culling
+	bindings.indices.push_back(2);
+	bindings.types.push_back(vk::DescriptorType::eStorageBuffer);
+	bindings.counts.push_back(1);
+	bindings.stages.push_back(vk::ShaderStageFlagBits::eVertex);
+
 	frameSetLayout = vkInit::make_descriptor_set_layout(device, bindings);
 
 	//Binding for individual draw calls
@@ -136,24 +224,69 @@ void Engine::make_descriptor_set_layout() {
 	bindings.counts[0] = 1;
 	bindings.stages[0] = vk::ShaderStageFlagBits::eFragment;
 
+	//or one array holding every material, written as textures load
+	if (bindless) {
+		bindings.counts[0] = bindlessTextureCapacity;
+		bindings.bindingFlags.push_back(vk::DescriptorBindingFlagBits::ePartiallyBound | vk::DescriptorBindingFlagBits::eUpdateAfterBind);
+		bindings.layoutFlags = vk::DescriptorSetLayoutCreateFlagBits::eUpdateAfterBindPool;
+	}
+
 	meshSetLayout = vkInit::make_descriptor_set_layout(device, bindings);
+	bindings.bindingFlags.clear();
+	bindings.layoutFlags = vk::DescriptorSetLayoutCreateFlags();
+
+	if (!gpuCulling) {
+		return;
+	}
+
+	//culling reads the models and writes the visible list and the draws, then reads the meshlets and writes their draws
+	bindings.count = meshletCulling ? 5 : 3;
+	bindings.indices.resize(bindings.count);
+	bindings.types.resize(bindings.count);
+	bindings.counts.resize(bindings.count);
+	bindings.stages.resize(bindings.count);
+	for (int i = 0; i < bindings.count; ++i) {
+		bindings.indices[i] = i;
+		bindings.types[i] = vk::DescriptorType::eStorageBuffer;
+		bindings.counts[i] = 1;
+		bindings.stages[i] = vk::ShaderStageFlagBits::eCompute;
+	}
+
+	cullSetLayout = vkInit::make_descriptor_set_layout(device, bindings);
 }
 
 void Engine::make_pipeline() {
 	vkInit::GraphicsPipelineInBundle specification = {};
 	specification.device = device;
 	specification.vertexFilePath = "shaders/vertex.spv";
-	specification.fragmentFilePath = "shaders/fragment.spv";
+	specification.fragmentFilePath = bindless ? "shaders/fragment_bindless.spv" : "shaders/fragment.spv";
 	specification.swapchainExtent = swapchainExtent;
 	specification.swapchainImageFormat = swapchainFormat;
+	specification.colorFinalLayout = headless ? vk::ImageLayout::eTransferSrcOptimal : vk::ImageLayout::ePresentSrcKHR;
 	specification.descriptorSetLayouts = {frameSetLayout, meshSetLayout};
 	specification.depthFormat = swapchainFrames[0].depthFormat;
+	specification.vertexLayout = vertexLayout;
 
 	vkInit::GraphicsPipelineOutBundle output = vkInit::create_graphics_pipeline(specification);
 
 	pipelineLayout = output.layout;
 	renderpass = output.renderPass;
 	pipeline = output.pipeline;
+
+	if (!gpuCulling) {
+		return;
+	}
+
+	vkInit::ComputePipelineInBundle cullSpecification = {};
+	cullSpecification.device = device;
+	cullSpecification.computeFilePath = meshletCulling ? "shaders/culling_meshlets.spv" : "shaders/culling.spv";
+	cullSpecification.descriptorSetLayouts = { cullSetLayout };
+	cullSpecification.pushConstantSize = sizeof(vkUtil::CullConstants);
+
+	vkInit::ComputePipelineOutBundle cullOutput = vkInit::create_compute_pipeline(cullSpecification);
+
+	cullPipelineLayout = cullOutput.layout;
+	cullPipeline = cullOutput.pipeline;
 }
 
 /*
@@ -173,136 +306,182 @@ void Engine::finalize_setup() {
 
 	commandPool = vkInit::make_command_pool(device, physicalDevice, surface, debugMode);
 
-	vkInit::commandBufferInputChunk commandBufferInput = { device, commandPool, swapchainFrames };
+	make_frame_contexts();
+
+	vkInit::commandBufferInputChunk commandBufferInput = { device, commandPool, frameContexts };
 	mainCommandBuffer = vkInit::make_command_buffer(commandBufferInput, debugMode);
 	
-	vkInit::make_frame_command_buffers(commandBufferInput, debugMode);
-
-	make_frame_resources();
-
+	vkUtil::QueueFamilyIndices queueFamilyIndices = vkUtil::findQueueFamilies(physicalDevice, surface, debugMode);
+	vkInit::make_frame_command_buffers(commandBufferInput, queueFamilyIndices.graphicsFamily.value(), workers->thread_count(), debugMode);
 }
 
-void Engine::make_frame_resources() {
+/*
+	Make the ring of frame contexts. These outlive the swapchain, so a resize
+	doesn't reallocate any per-frame resources.
+*/
+void Engine::make_frame_contexts() {
+	frameTimeline.init(device, vkInit::make_timeline_semaphore(device, 0));
+
 	vkInit::descriptorSetLayoutData bindings;
-	bindings.count = 2;
+	bindings.count = 3;
 	bindings.types.push_back(vk::DescriptorType::eUniformBuffer);
 	bindings.types.push_back(vk::DescriptorType::eStorageBuffer);
+	bindings.types.push_back(vk::DescriptorType::eStorageBuffer);
 
-	frameDescriptorPool = vkInit::make_descriptor_pool(device, static_cast<uint32_t>(swapchainFrames.size()), bindings);
+	frameDescriptorPool = vkInit::make_descriptor_pool(device, static_cast<uint32_t>(maxFramesInFlight), bindings);
 
-	for (vkUtils::SwapChainFrame& frame : swapchainFrames)
+	if (gpuCulling) {
+		bindings.count = meshletCulling ? 5 : 3;
+		bindings.types.assign(bindings.count, vk::DescriptorType::eStorageBuffer);
+		cullDescriptorPool = vkInit::make_descriptor_pool(device, static_cast<uint32_t>(maxFramesInFlight), bindings);
+	}
+
+	frameContexts.resize(maxFramesInFlight);
+
+	for (vkUtils::FrameContext& frame : frameContexts)
 	{
-		frame.imageAvailable = vkInit::make_semaphore(device);
-		frame.renderFinished = vkInit::make_semaphore(device);
+		frame.logicalDevice = device;
+		frame.physicalDevice = physicalDevice;
+		frame.allocator = allocator;
+		frame.timeline = &frameTimeline;
+		frame.modelCapacityLimit = maxInstanceCapacity;
 
-		frame.inFlight = vkInit::make_fence(device);
+		frame.imageAvailable = vkInit::make_semaphore(device);
+		frame.timelineValue = 0;
 
-		frame.make_descriptor_resources();
+		frame.make_descriptor_resources(instanceCapacity);
 
 		frame.descriptorSet = vkInit::allocate_descriptor_set(device, frameDescriptorPool, frameSetLayout);
+		if (gpuCulling) {
+			frame.cullDescriptorSet = vkInit::allocate_descriptor_set(device, cullDescriptorPool, cullSetLayout);
+		}
+		frame.write_descriptor_set();
 	}
 }
 
 void Engine::make_assets() {
-	//Meshes
-	meshes = new VertexMenagerie();
-
-	std::vector<float> vertices = { {
-			 0.0f, -0.1f, 0.0f, 1.0f, 0.0f, 0.5f, 0.0f, //0
-			 0.1f,  0.1f, 0.0f, 1.0f, 0.0f, 1.0f, 1.0f, //1
-			-0.1f,  0.1f, 0.0f, 1.0f, 0.0f, 0.0f, 1.0f  //2
-		} };
-	std::vector<uint32_t> indices = { {
-			0,1,2
-	} };
-
-	meshTypes type = meshTypes::TRIANGLE;
-	meshes->consume(type, vertices, indices);
-
-	vertices = { {
-		-0.1f,  0.1f, 1.0f, 0.0f, 0.0f, 0.0f, 1.0f, //0
-		-0.1f, -0.1f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, //1
-		 0.1f, -0.1f, 1.0f, 0.0f, 0.0f, 1.0f, 0.0f, //2
-		 0.1f,  0.1f, 1.0f, 0.0f, 0.0f, 1.0f, 1.0f, //3
-	} };
-	indices = { {
-			0,1,2,
-			2,3,0
-	} };
-	type = meshTypes::SQUARE;
-	meshes->consume(type, vertices, indices);
-
-	vertices = { {
-		 -0.1f, -0.05f, 1.0f, 1.0f, 1.0f, 0.0f, 0.25f, //0
-		-0.04f, -0.05f, 1.0f, 1.0f, 1.0f, 0.3f, 0.25f, //1
-		-0.06f,   0.0f, 1.0f, 1.0f, 1.0f, 0.2f,  0.5f, //2
-		  0.0f,  -0.1f, 1.0f, 1.0f, 1.0f, 0.5f,  0.0f, //3
-		 0.04f, -0.05f, 1.0f, 1.0f, 1.0f, 0.7f, 0.25f, //4
-		  0.1f, -0.05f, 1.0f, 1.0f, 1.0f, 1.0f, 0.25f, //5
-		 0.06f,   0.0f, 1.0f, 1.0f, 1.0f, 0.8f,  0.5f, //6
-		 0.08f,   0.1f, 1.0f, 1.0f, 1.0f, 0.9f,  1.0f, //7
-		  0.0f,  0.02f, 1.0f, 1.0f, 1.0f, 0.5f,  0.6f, //8
-		-0.08f,   0.1f, 1.0f, 1.0f, 1.0f, 0.1f,  1.0f  //9
-	} };
-	indices = { {
-		0,1,2,
-		1,3,4,
-		2,1,4,
-		4,5,6,
-		2,4,6,
-		6,7,8,
-		2,6,8,
-		2,8,9,
-	} };
-	type = meshTypes::STAR;
-	meshes->consume(type, vertices, indices);
+	//Meshes, registered once their materials have loaded
+	meshes = new VertexMenagerie(vertexLayout, optimizeMeshes, debugMode);
+	std::vector<std::string> meshNames;
+	std::vector<MeshRange> meshRanges;
+
+	if (!meshArchive || !meshes->load_archive(meshArchive, meshNames, meshRanges)) {
+		if (meshArchive) {
+			std::cout << "Falling back to the built in meshes" << std::endl;
+		}
+		consume_default_meshes(*meshes, meshNames, meshRanges);
+	}
 
-	vertexBufferFinalizationChunk finalizationInfo;
-	finalizationInfo.logicalDevice = device;
-	finalizationInfo.physicalDevice = physicalDevice;
-	finalizationInfo.commandBuffer = mainCommandBuffer;
-	finalizationInfo.queue = graphicsQueue;
-	meshes->finalize(finalizationInfo);
+	//every asset upload goes into one batch, submitted once at the end
+	vkUtils::UploadBatch uploadBatch(transfer);
 
-	//Materials
+	//Materials, meshes refer to them by their place in the list
 
-	std::unordered_map<meshTypes, const char*> filenames = {
-		{meshTypes::TRIANGLE, "tex/face.jpg"},
-		{meshTypes::SQUARE, "tex/haus.jpg"},
-		{meshTypes::STAR, "tex/noroi.png"}
+	std::vector<const char*> filenames = {
+		"tex/face.jpg",
+		"tex/haus.jpg",
+		"tex/noroi.png"
 	};
+	if (filenames.size() > maxMaterials) {
+		std::cout << "Only the first " << maxMaterials << " of " << filenames.size() << " materials can be drawn, dropping the rest" << std::endl;
+		filenames.resize(maxMaterials);
+	}
 		
 	//Make a descriptor pool to allocate sets.
-	vkInit::descriptorSetLayoutData bindings;
-	bindings.count = 1;
-	bindings.types.push_back(vk::DescriptorType::eCombinedImageSampler);
-	meshDescriptorPool = vkInit::make_descriptor_pool(device, static_cast<uint32_t>(filenames.size()), bindings);
+	if (bindless) {
+		meshDescriptorPool = vkInit::make_bindless_descriptor_pool(device, bindlessTextureCapacity);
+		materialSet = vkInit::allocate_descriptor_set(device, meshDescriptorPool, meshSetLayout);
+	}
+	else {
+		vkInit::descriptorSetLayoutData bindings;
+		bindings.count = 1;
+		bindings.types.push_back(vk::DescriptorType::eCombinedImageSampler);
+		meshDescriptorPool = vkInit::make_descriptor_pool(device, static_cast<uint32_t>(filenames.size()), bindings);
+	}
 
 	vkImage::TextureInputChunk textureInfo;
-	textureInfo.commandBuffer = mainCommandBuffer;
-	textureInfo.queue = graphicsQueue;
+	textureInfo.uploadBatch = &uploadBatch;
 	textureInfo.logicalDevice = device;
 	textureInfo.physicalDevice = physicalDevice;
+	textureInfo.allocator = allocator;
 	textureInfo.layout = meshSetLayout;
-	textureInfo.descriptorPool = meshDescriptorPool;
-
-	for (const auto & [object, filename] : filenames)
+	//bindless textures go into the material set instead of sets of their own
+	textureInfo.descriptorPool = bindless ? vk::DescriptorPool() : meshDescriptorPool;
+
+	//decoded in parallel, textures go into the batch first so that their staging never needs an early flush
+	materials = vkImage::load_textures(textureInfo, filenames, workers);
+	//bindless draws only reach the materials which fit the texture array
+	size_t materialCount = bindless ? std::min<size_t>(materials.size(), bindlessTextureCapacity) : materials.size();
+	for (size_t i = 0; i < meshRanges.size(); ++i)
 	{
-		textureInfo.filename = filename;
-		materials[object] = new vkImage::Texture(textureInfo);
+		if (meshRanges[i].materialId >= materialCount) {
+			if (debugMode) {
+				std::cout << "Mesh " << meshNames[i] << " has no material " << meshRanges[i].materialId << ", using the first\n";
+			}
+			meshRanges[i].materialId = 0;
+		}
+		meshRanges[i].material = materials[meshRanges[i].materialId];
+		meshRegistry.add(meshNames[i], meshRanges[i]);
 	}
+	if (bindless) {
+		write_material_descriptors();
+	}
+
+	vertexBufferFinalizationChunk finalizationInfo;
+	finalizationInfo.logicalDevice = device;
+	finalizationInfo.physicalDevice = physicalDevice;
+	finalizationInfo.allocator = allocator;
+	finalizationInfo.uploadBatch = &uploadBatch;
+	meshes->finalize(finalizationInfo);
+
+	uploadBatch.submit();
+
+	if (meshletCulling && meshes->meshletBuffer.buffer) {
+		for (vkUtils::FrameContext& frame : frameContexts) {
+			frame.meshletDescriptor.buffer = meshes->meshletBuffer.buffer;
+			frame.meshletDescriptor.offset = 0;
+			frame.meshletDescriptor.range = meshes->meshletBufferSize;
+			frame.reserve_meshlet_draws(1);
+		}
+	}
+}
+
+/*
+	Write every loaded texture into the material array, at its material id
+*/
+void Engine::write_material_descriptors() {
+	if (materials.size() > bindlessTextureCapacity && debugMode) {
+		std::cout << "Only " << bindlessTextureCapacity << " of " << materials.size() << " materials fit the texture array\n";
+	}
+
+	std::vector<vk::DescriptorImageInfo> imageDescriptors;
+	for (size_t i = 0; i < std::min<size_t>(materials.size(), bindlessTextureCapacity); ++i) {
+		imageDescriptors.push_back(materials[i]->descriptor_info());
+	}
+	if (imageDescriptors.empty()) {
+		return;
+	}
+
+	vk::WriteDescriptorSet descriptorWrite;
+	descriptorWrite.dstSet = materialSet;
+	descriptorWrite.dstBinding = 0;
+	descriptorWrite.dstArrayElement = 0;
+	descriptorWrite.descriptorType = vk::DescriptorType::eCombinedImageSampler;
+	descriptorWrite.descriptorCount = static_cast<uint32_t>(imageDescriptors.size());
+	descriptorWrite.pImageInfo = imageDescriptors.data();
+
+	device.updateDescriptorSets(descriptorWrite, nullptr);
 }
 
 
-void Engine::prepare_frame(uint32_t imageIndex, Scene* scene) {
-	vkUtils::SwapChainFrame& _frame = swapchainFrames[imageIndex];
+void Engine::prepare_frame(vkUtils::FrameContext& _frame, Scene* scene) {
 
 	glm::vec3 eye = { 1.0f, 0.0f, -1.0f };
 	glm::vec3 center = { 0.0f, 0.0f, 0.0f };
 	glm::vec3 up = { 0.0f, 0.0f, -1.0f };
 	glm::mat4 view = glm::lookAt(eye, center, up);
 
-	glm::mat4 projection = glm::perspective(glm::radians(45.0f), static_cast<float>(swapchainExtent.width) / static_cast<float>(swapchainExtent.height), 0.1f, 10.0f);
+	glm::mat4 projection = glm::perspective(glm::radians(45.0f), static_cast<float>(swapchainExtent.width) / static_cast<float>(swapchainExtent.height), nearPlane, farPlane);
 
 	projection[1][1] *= -1;
 
@@ -312,35 +491,299 @@ void Engine::prepare_frame(uint32_t imageIndex, Scene* scene) {
 	
 	memcpy(_frame.cameraDataWriteLocation, &(_frame.cameraData), sizeof(vkUtils::UBO));
 
-	size_t i = 0;
-	for(glm::vec3& position : scene->trianglePositions)
-	{
-		_frame.modelTransforms[i++] = glm::translate(glm::mat4(1.0f), position);
+	const TransformStore& transforms = scene->transforms;
+	size_t instanceCount = transforms.size();
+	_frame.reserve_models(instanceCount);
+
+	//only what changed since this frame's model buffer was last written gets rebuilt
+	std::vector<uint32_t>& blocks = _frame.changedBlocks;
+	transforms.changed_blocks(_frame.transformVersion, blocks);
+
+	//world matrices are built straight into the mapped model buffer, in chunks across the pool
+	glm::mat4* models = static_cast<glm::mat4*>(_frame.modelBufferWriteLocation);
+	const size_t blocksPerChunk = 256;
+	size_t chunkCount = (blocks.size() + blocksPerChunk - 1) / blocksPerChunk;
+	std::atomic<size_t> written{ 0 };
+	workers->parallel_for(chunkCount, [&](size_t chunk) {
+		size_t first = chunk * blocksPerChunk;
+		size_t count = std::min(blocks.size() - first, blocksPerChunk);
+		written += transforms.write_changed_world_matrices(models, _frame.transformVersion, blocks.data() + first, count);
+	});
+	_frame.transformVersion = transforms.version();
+
+	transformBytesLastFrame = written * sizeof(glm::mat4);
+	transformBytesTotal += transformBytesLastFrame;
+
+	if (gpuCulling) {
+		prepare_gpu_culling(_frame, scene);
 	}
-	for (glm::vec3& position : scene->squarePositions)
-	{
-		_frame.modelTransforms[i++] = glm::translate(glm::mat4(1.0f), position);
+	else {
+		cull_instances(_frame, scene);
 	}
-	for (glm::vec3& position : scene->starPositions)
-	{
-		_frame.modelTransforms[i++] = glm::translate(glm::mat4(1.0f), position);
+	++framesPrepared;
+}
+
+
+
+/*
+	Frustum cull the scene's spatial index, a part of the tree per task across the worker pool, then sort
+	the survivors into batches by pipeline, material, mesh and level of detail, front to back within each. Their indices go
+	compactly into the frame's visible buffer, with one instanced draw per batch.
+	Bindless materials don't split batches, their draws are written out for a single indirect call.
+*/
+void Engine::cull_instances(vkUtils::FrameContext& frame, Scene* scene) {
+	Frustum frustum = make_frustum(frame.cameraData.viewProjection);
+	const TransformStore& transforms = scene->transforms;
+	const glm::mat4& view = frame.cameraData.view;
+	//pixels an error of one unit covers at a depth of one, over the pixels allowed
+	float lodScale = lodErrorPixels > 0.0f ? std::abs(frame.cameraData.projection[1][1]) * 0.5f * static_cast<float>(swapchainExtent.height) / lodErrorPixels : 0.0f;
+
+	//every frame in flight shares the index, only what moved since the last frame is refit
+	scene->update_spatial_index(meshRegistry);
+	const SpatialIndex& spatialIndex = scene->spatialIndex;
+
+	//each part of the tree culls into its own part of the scratch lists
+	std::vector<int32_t>& parts = frame.cullParts;
+	spatialIndex.partition(4 * workers->thread_count(), parts);
+	frame.cullOffsets.resize(parts.size());
+	size_t offset = 0;
+	for (size_t i = 0; i < parts.size(); ++i) {
+		frame.cullOffsets[i] = offset;
+		offset += spatialIndex.part_size(parts[i]);
+	}
+
+	frame.cullScratch.resize(transforms.size());
+	frame.drawPackets.resize(transforms.size());
+	frame.cullCounts.resize(parts.size());
+	workers->parallel_for(parts.size(), [&](size_t i) {
+		size_t first = frame.cullOffsets[i];
+		size_t count = spatialIndex.query_frustum(frustum, parts[i], &frame.cullScratch[first]);
+
+		//survivors come out in tree order, instances outside every range or of removed meshes aren't drawn
+		size_t kept = 0;
+		for (size_t k = 0; k < count; ++k) {
+			uint32_t instance = frame.cullScratch[first + k];
+			const Scene::InstanceRange* range = scene->find_range(instance);
+			if (!range || !meshRegistry.contains(range->mesh)) {
+				continue;
+			}
+			const MeshRange& mesh = meshRegistry.get(range->mesh);
+
+			//grouped by index type in place of a pipeline, and the distance along the view direction
+			float depth = -(view[0][2] * transforms.positionX[instance] + view[1][2] * transforms.positionY[instance]
+				+ view[2][2] * transforms.positionZ[instance] + view[3][2]);
+			//the level of detail by its projected error, against the largest scale
+			float scale = std::max(std::abs(transforms.scaleX[instance]), std::max(std::abs(transforms.scaleY[instance]), std::abs(transforms.scaleZ[instance])));
+			uint32_t lod = select_lod(mesh, scale, depth, lodScale);
+			vkUtil::DrawPacket& packet = frame.drawPackets[first + kept++];
+			packet.key = vkUtil::make_sort_key(index_group(mesh), bindless ? 0 : mesh.materialId, range->mesh.index, lod, depth / farPlane);
+			packet.instance = instance;
+			packet.meshGeneration = range->mesh.generation;
+		}
+		frame.cullCounts[i] = kept;
+	});
+
+	//gather the packets, every part's survivors sit at the start of its part of the list
+	size_t visibleCount = 0;
+	for (size_t i = 0; i < parts.size(); ++i) {
+		std::copy(frame.drawPackets.begin() + frame.cullOffsets[i], frame.drawPackets.begin() + frame.cullOffsets[i] + frame.cullCounts[i],
+			frame.drawPackets.begin() + visibleCount);
+		visibleCount += frame.cullCounts[i];
+	}
+	frame.drawPackets.resize(visibleCount);
+
+	vkUtil::sort_packets(frame.drawPackets, frame.packetScratch, workers);
+
+	//merge neighbouring packets of the same batch into instanced draws
+	uint32_t* visible = static_cast<uint32_t*>(frame.visibleBufferWriteLocation);
+	uint32_t materialId = 0;
+	frame.draws.clear();
+	for (size_t i = 0; i < visibleCount; ++i) {
+		const vkUtil::DrawPacket& packet = frame.drawPackets[i];
+		if (i == 0 || ((packet.key ^ frame.drawPackets[i - 1].key) & vkUtil::batchKeyMask)) {
+			vkUtil::DrawCommand draw;
+			draw.mesh.index = vkUtil::mesh_index(packet.key);
+			draw.mesh.generation = packet.meshGeneration;
+			draw.lod = vkUtil::mesh_lod(packet.key);
+			draw.firstInstance = static_cast<uint32_t>(i);
+			draw.instanceCount = 0;
+			frame.draws.push_back(draw);
+			materialId = meshRegistry.get(draw.mesh).materialId;
+		}
+		visible[2 * i] = packet.instance;
+		visible[2 * i + 1] = materialId;
+		++frame.draws.back().instanceCount;
+	}
+
+	if (bindless) {
+		frame.reserve_cull_draws(std::max<size_t>(frame.draws.size(), 1));
+		vkUtil::CullDraw* commands = static_cast<vkUtil::CullDraw*>(frame.cullDrawWriteLocation);
+		for (size_t i = 0; i < frame.draws.size(); ++i) {
+			const vkUtil::DrawCommand& draw = frame.draws[i];
+			const MeshRange& mesh = meshRegistry.get(draw.mesh);
+			commands[i].command.indexCount = mesh.lods[draw.lod].indexCount;
+			commands[i].command.instanceCount = draw.instanceCount;
+			commands[i].command.firstIndex = mesh.lods[draw.lod].firstIndex;
+			commands[i].command.vertexOffset = mesh.vertexOffset;
+			commands[i].command.firstInstance = draw.firstInstance;
+		}
+	}
+
+	drawsLastFrame = static_cast<uint32_t>(frame.draws.size());
+	frame.visibleInstances = static_cast<uint32_t>(visibleCount);
+	frame.culledInstances = static_cast<uint32_t>(transforms.size() - visibleCount);
+	visibleInstancesLastFrame = frame.visibleInstances;
+	culledInstancesLastFrame = frame.culledInstances;
+}
+
+/*
+	Write one indirect draw per instance range for the culling shader to fill in, the CPU never touches
+	individual instances. The retired frame's draws are read back first for the culling counts.
+*/
+void Engine::prepare_gpu_culling(vkUtils::FrameContext& frame, Scene* scene) {
+	vkUtil::CullDraw* cullDraws = static_cast<vkUtil::CullDraw*>(frame.cullDrawWriteLocation);
+	if (!frame.draws.empty()) {
+		uint32_t visible = 0;
+		for (size_t i = 0; i < frame.draws.size(); ++i) {
+			visible += cullDraws[i].command.instanceCount;
+		}
+		//counts are from this context's last frame, maxFramesInFlight frames ago
+		frame.visibleInstances = visible;
+		frame.culledInstances = frame.cullInputInstances - visible;
+		visibleInstancesLastFrame = frame.visibleInstances;
+		culledInstancesLastFrame = frame.culledInstances;
+	}
+
+	frame.reserve_cull_draws(std::max<size_t>(scene->ranges.size(), 1));
+	cullDraws = static_cast<vkUtil::CullDraw*>(frame.cullDrawWriteLocation);
+
+	//ranges are drawn in batch order too, so that neighbouring draws share state, ranges of removed meshes aren't drawn
+	frame.drawPackets.clear();
+	for (size_t i = 0; i < scene->ranges.size(); ++i) {
+		MeshHandle handle = scene->ranges[i].mesh;
+		if (!meshRegistry.contains(handle)) {
+			continue;
+		}
+		vkUtil::DrawPacket packet;
+		const MeshRange& mesh = meshRegistry.get(handle);
+		packet.key = vkUtil::make_sort_key(index_group(mesh), bindless ? 0 : mesh.materialId, handle.index, 0, 0.0f);
+		packet.instance = static_cast<uint32_t>(i);
+		packet.meshGeneration = handle.generation;
+		frame.drawPackets.push_back(packet);
+	}
+	vkUtil::sort_packets(frame.drawPackets, frame.packetScratch, workers);
+
+	frame.draws.clear();
+	uint32_t meshletDraws = 0;
+	for (size_t i = 0; i < frame.drawPackets.size(); ++i) {
+		const Scene::InstanceRange& range = scene->ranges[frame.drawPackets[i].instance];
+
+		const MeshRange& mesh = meshRegistry.get(range.mesh);
+		vkUtil::CullDraw& cullDraw = cullDraws[i];
+		cullDraw.command.indexCount = mesh.indexCount;
+		cullDraw.command.instanceCount = 0;
+		cullDraw.command.firstIndex = mesh.firstIndex;
+		cullDraw.command.vertexOffset = mesh.vertexOffset;
+		//each range culls into its own part of the visible buffer
+		cullDraw.command.firstInstance = range.first;
+		cullDraw.rangeCount = range.count;
+		cullDraw.radius = mesh.boundingRadius;
+		cullDraw.materialId = mesh.materialId;
+		cullDraw.drawCount = 0;
+		cullDraw.firstMeshlet = mesh.firstMeshlet;
+		cullDraw.meshletCount = 0;
+		cullDraw.firstMeshletDraw = meshletDraws;
+		cullDraw.meshletDrawCount = 0;
+		if (draws_meshlets(mesh)) {
+			//the instances are drawn meshlet by meshlet instead, every meshlet of every instance might survive
+			cullDraw.command.indexCount = 0;
+			cullDraw.meshletCount = mesh.meshletCount;
+			meshletDraws += range.count * mesh.meshletCount;
+		}
+
+		vkUtil::DrawCommand draw;
+		draw.mesh = range.mesh;
+		draw.lod = 0;
+		draw.firstInstance = range.first;
+		draw.instanceCount = range.count;
+		frame.draws.push_back(draw);
+	}
+	if (meshletCulling) {
+		frame.reserve_meshlet_draws(std::max<size_t>(meshletDraws, 1));
 	}
-	memcpy(_frame.modelBufferWriteLocation, _frame.modelTransforms.data(), i * sizeof(glm::mat4));
+	frame.cullInputInstances = static_cast<uint32_t>(scene->transforms.size());
+	drawsLastFrame = static_cast<uint32_t>(frame.draws.size());
+}
 
-	_frame.write_descriptor_set();
+/*
+	Dispatch the culling shader, outside of the renderpass, and make its output visible to the draws
+*/
+void Engine::record_gpu_culling(vkUtils::FrameContext& frame, vk::CommandBuffer commandBuffer) {
+	Frustum frustum = make_frustum(frame.cameraData.viewProjection);
+
+	vkUtil::CullConstants constants;
+	for (int i = 0; i < 6; ++i) {
+		constants.planes[i] = frustum.planes[i];
+	}
+	constants.cameraPosition = glm::inverse(frame.cameraData.view)[3];
+	constants.instanceCount = frame.cullInputInstances;
+	constants.drawCount = static_cast<uint32_t>(frame.draws.size());
+
+	commandBuffer.bindPipeline(vk::PipelineBindPoint::eCompute, cullPipeline);
+	commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eCompute, cullPipelineLayout, 0, frame.cullDescriptorSet, nullptr);
+	commandBuffer.pushConstants(cullPipelineLayout, vk::ShaderStageFlagBits::eCompute, 0, sizeof(constants), &constants);
+	commandBuffer.dispatch((constants.instanceCount + 63) / 64, 1, 1);
+
+	//the draws read the commands and the visible list, the host reads the counts back once the frame retires
+	vk::MemoryBarrier barrier;
+	barrier.srcAccessMask = vk::AccessFlagBits::eShaderWrite;
+	barrier.dstAccessMask = vk::AccessFlagBits::eIndirectCommandRead | vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eHostRead;
+	commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eComputeShader,
+		vk::PipelineStageFlagBits::eDrawIndirect | vk::PipelineStageFlagBits::eVertexShader | vk::PipelineStageFlagBits::eHost,
+		vk::DependencyFlags(), barrier, nullptr, nullptr);
 }
 
+/*
+	Draws are grouped by index type first, through the pipeline field of their sort keys
+*/
+uint32_t Engine::index_group(const MeshRange& mesh) const {
+	return mesh.indexType == vk::IndexType::eUint16 ? 0 : 1;
+}
 
+/*
+	The coarsest level of detail whose error, projected at the instance's depth, stays within the allowed pixels
+*/
+uint32_t Engine::select_lod(const MeshRange& mesh, float scale, float depth, float lodScale) const {
+	if (lodErrorPixels <= 0.0f) {
+		return 0;
+	}
+	float limit = std::max(depth, nearPlane);
+	uint32_t lod = 0;
+	while (lod + 1 < mesh.lodCount && mesh.lods[lod + 1].error * scale * lodScale <= limit) {
+		++lod;
+	}
+	return lod;
+}
+
+/*
+	Meshes of a single meshlet gain nothing from culling it after the instance
+*/
+bool Engine::draws_meshlets(const MeshRange& mesh) const {
+	return meshletCulling && mesh.meshletCount > 1;
+}
 
 void Engine::prepare_scene(vk::CommandBuffer commandBuffer) {
 	vk::Buffer vertexBuffers[] = { meshes->vertexBuffer.buffer };
 	vk::DeviceSize offsets[] = { 0 };
 	commandBuffer.bindVertexBuffers(0, 1, vertexBuffers, offsets);
-	commandBuffer.bindIndexBuffer(meshes->indexBuffer.buffer, 0, vk::IndexType::eUint32);
+	//index buffers are bound by the draws, for their mesh's index type
 }
 
-void Engine::record_draw_commands(vk::CommandBuffer commandBuffer, uint32_t imageIndex, Scene* scene) {
+void Engine::record_draw_commands(vkUtils::FrameContext& frame, uint32_t imageIndex, Scene* scene) {
+	vk::CommandBuffer commandBuffer = frame.commandBuffer;
+
 	vk::CommandBufferBeginInfo beginInfo = {};
+	beginInfo.flags = vk::CommandBufferUsageFlagBits::eOneTimeSubmit;
 
 	try {
 		commandBuffer.begin(beginInfo);
@@ -351,6 +794,13 @@ void Engine::record_draw_commands(vk::CommandBuffer commandBuffer, uint32_t imag
 		}
 	}
 
+	//take ownership of whatever the transfer queue has finished uploading since the last frame
+	frame.uploadWaitValue = transfer->record_acquires(commandBuffer);
+
+	if (gpuCulling) {
+		record_gpu_culling(frame, commandBuffer);
+	}
+
 	vk::RenderPassBeginInfo renderpassInfo = {};
 	renderpassInfo.renderPass = renderpass;
 	renderpassInfo.framebuffer = swapchainFrames[imageIndex].frameBuffer;
@@ -369,54 +819,255 @@ void Engine::record_draw_commands(vk::CommandBuffer commandBuffer, uint32_t imag
 	renderpassInfo.clearValueCount = clearValues.size();
 	renderpassInfo.pClearValues = clearValues.data();
 
-	commandBuffer.beginRenderPass(&renderpassInfo, vk::SubpassContents::eInline);
-	commandBuffer.bindPipeline(vk::PipelineBindPoint::eGraphics, pipeline);
+	//the draw list comes out of culling, its instances index the visible buffer
+	const std::vector<vkUtil::DrawCommand>& draws = frame.draws;
 
-	commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, pipelineLayout, 0, swapchainFrames[imageIndex].descriptorSet, nullptr);
-	prepare_scene(commandBuffer);
+	//split the draw list into one contiguous chunk per recording thread
+	size_t chunkCount = std::max<size_t>(1, std::min(workers->thread_count(), draws.size()));
+	workers->parallel_for(chunkCount, [&](size_t chunk) {
+		size_t first = chunk * draws.size() / chunkCount;
+		size_t last = (chunk + 1) * draws.size() / chunkCount;
+		record_draw_chunk(frame, imageIndex, chunk, draws, first, last);
+	});
+
+	commandBuffer.beginRenderPass(&renderpassInfo, vk::SubpassContents::eSecondaryCommandBuffers);
+	commandBuffer.executeCommands(static_cast<uint32_t>(chunkCount), frame.workerCommandBuffers.data());
+	commandBuffer.endRenderPass();
+
+	try {
+		commandBuffer.end();
+	}
+	catch (vk::SystemError err) {
+		if (debugMode) {
+			std::cout << "failed to record command buffer!" << std::endl;
+		}
+	}
+}
 
-	uint32_t startInstance = 0;
+/*
+	Record draws [first, last) into the chunk's secondary command buffer, called from the worker threads
+*/
+void Engine::record_draw_chunk(vkUtils::FrameContext& frame, uint32_t imageIndex, size_t chunk, const std::vector<vkUtil::DrawCommand>& draws, size_t first, size_t last) {
+	vk::CommandBuffer commandBuffer = frame.workerCommandBuffers[chunk];
 
-	//Triangles
-	render_objects(commandBuffer, meshTypes::TRIANGLE, startInstance, static_cast<uint32_t>(scene->trianglePositions.size()));
+	vk::CommandBufferInheritanceInfo inheritanceInfo = {};
+	inheritanceInfo.renderPass = renderpass;
+	inheritanceInfo.subpass = 0;
+	inheritanceInfo.framebuffer = swapchainFrames[imageIndex].frameBuffer;
 
-	
-	//Squares
-	render_objects(commandBuffer, meshTypes::SQUARE, startInstance, static_cast<uint32_t>(scene->squarePositions.size()));
+	vk::CommandBufferBeginInfo beginInfo = {};
+	beginInfo.flags = vk::CommandBufferUsageFlagBits::eRenderPassContinue | vk::CommandBufferUsageFlagBits::eOneTimeSubmit;
+	beginInfo.pInheritanceInfo = &inheritanceInfo;
 
-	//Stars
-	render_objects(commandBuffer, meshTypes::STAR, startInstance, static_cast<uint32_t>(scene->starPositions.size()));
+	try {
+		commandBuffer.begin(beginInfo);
+	}
+	catch (vk::SystemError err) {
+		if (debugMode) {
+			std::cout << "Failed to begin recording secondary command buffer!" << std::endl;
+		}
+	}
 
-	commandBuffer.endRenderPass();
+	//secondary buffers don't inherit state, so every chunk binds its own
+	commandBuffer.bindPipeline(vk::PipelineBindPoint::eGraphics, pipeline);
+	commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, pipelineLayout, 0, frame.descriptorSet, nullptr);
+	prepare_scene(commandBuffer);
+
+	if (bindless) {
+		render_objects_bindless(commandBuffer, frame, first, last);
+	}
+	else {
+		//draws are sorted, so most neighbours share their material
+		vkUtil::BoundState bound;
+		for (size_t i = first; i < last; i++)
+		{
+			if (gpuCulling) {
+				render_objects_indirect(commandBuffer, frame, i, draws[i], bound);
+			}
+			else {
+				render_objects(commandBuffer, draws[i], bound);
+			}
+		}
+	}
 
 	try {
 		commandBuffer.end();
 	}
 	catch (vk::SystemError err) {
 		if (debugMode) {
-			std::cout << "failed to record command buffer!" << std::endl;
+			std::cout << "failed to record secondary command buffer!" << std::endl;
+		}
+	}
+}
+
+/*
+	Bind the index buffer of a mesh's index type unless it is bound already
+*/
+void Engine::bind_index_buffer(vk::CommandBuffer commandBuffer, const MeshRange& mesh, vkUtil::BoundState& bound) {
+	if (bound.indexBufferBound && bound.indexType == mesh.indexType) {
+		return;
+	}
+	commandBuffer.bindIndexBuffer(meshes->index_buffer(mesh.indexType).buffer, 0, mesh.indexType);
+	bound.indexBufferBound = true;
+	bound.indexType = mesh.indexType;
+}
+
+/*
+	Bind a mesh's material unless it is bound already
+*/
+void Engine::bind_material(vk::CommandBuffer commandBuffer, const MeshRange& mesh, vkUtil::BoundState& bound) {
+	if (bound.material == mesh.material) {
+		return;
+	}
+	mesh.material->use(commandBuffer, pipelineLayout);
+	bound.material = mesh.material;
+}
+
+void Engine::render_objects(vk::CommandBuffer commandBuffer, const vkUtil::DrawCommand& draw, vkUtil::BoundState& bound) {
+	//a plain array index, this runs on several threads at once
+	const MeshRange& mesh = meshRegistry.get(draw.mesh);
+	bind_index_buffer(commandBuffer, mesh, bound);
+	bind_material(commandBuffer, mesh, bound);
+	const MeshLod& lod = mesh.lods[draw.lod];
+	commandBuffer.drawIndexed(lod.indexCount, draw.instanceCount, lod.firstIndex, mesh.vertexOffset, draw.firstInstance);
+}
+
+/*
+	Draw a range from the culling shader's output, the draw count it wrote skips the draw if nothing survived
+*/
+void Engine::render_objects_indirect(vk::CommandBuffer commandBuffer, vkUtils::FrameContext& frame, size_t drawIndex, const vkUtil::DrawCommand& draw, vkUtil::BoundState& bound) {
+	const MeshRange& mesh = meshRegistry.get(draw.mesh);
+	bind_index_buffer(commandBuffer, mesh, bound);
+	bind_material(commandBuffer, mesh, bound);
+	if (draws_meshlets(mesh)) {
+		render_meshlets(commandBuffer, frame, drawIndex);
+		return;
+	}
+	vk::DeviceSize offset = drawIndex * sizeof(vkUtil::CullDraw);
+	commandBuffer.drawIndexedIndirectCount(frame.cullDrawBuffer.buffer, offset,
+		frame.cullDrawBuffer.buffer, offset + offsetof(vkUtil::CullDraw, drawCount), 1, sizeof(vkUtil::CullDraw));
+}
+
+/*
+	Draw the meshlets of a range which survived culling, as many draws as the culling shader appended
+*/
+void Engine::render_meshlets(vk::CommandBuffer commandBuffer, vkUtils::FrameContext& frame, size_t drawIndex) {
+	const vkUtil::DrawCommand& draw = frame.draws[drawIndex];
+	const MeshRange& mesh = meshRegistry.get(draw.mesh);
+	const vkUtil::CullDraw* cullDraws = static_cast<const vkUtil::CullDraw*>(frame.cullDrawWriteLocation);
+	vk::DeviceSize offset = drawIndex * sizeof(vkUtil::CullDraw);
+	commandBuffer.drawIndexedIndirectCount(frame.meshletDrawBuffer.buffer,
+		cullDraws[drawIndex].firstMeshletDraw * sizeof(vk::DrawIndexedIndirectCommand),
+		frame.cullDrawBuffer.buffer, offset + offsetof(vkUtil::CullDraw, meshletDrawCount),
+		draw.instanceCount * mesh.meshletCount, sizeof(vk::DrawIndexedIndirectCommand));
+}
+
+/*
+	Draw [first, last) with a multi draw per index type from the frame's indirect commands, instances pick their
+	materials out of the bound array. Draws which culling emptied have no instances and cost nothing.
+*/
+void Engine::render_objects_bindless(vk::CommandBuffer commandBuffer, vkUtils::FrameContext& frame, size_t first, size_t last) {
+	commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, pipelineLayout, 1, materialSet, nullptr);
+	vkUtil::BoundState bound;
+	while (first < last) {
+		//draws are grouped by index type, one multi draw can't switch index buffers
+		const MeshRange& mesh = meshRegistry.get(frame.draws[first].mesh);
+		bind_index_buffer(commandBuffer, mesh, bound);
+		size_t groupStart = first;
+		size_t groupEnd = first + 1;
+		while (groupEnd < last && meshRegistry.get(frame.draws[groupEnd].mesh).indexType == mesh.indexType) {
+			++groupEnd;
+		}
+
+		while (first < groupEnd) {
+			uint32_t count = static_cast<uint32_t>(std::min<size_t>(groupEnd - first, maxDrawIndirectCount));
+			commandBuffer.drawIndexedIndirect(frame.cullDrawBuffer.buffer, first * sizeof(vkUtil::CullDraw), count, sizeof(vkUtil::CullDraw));
+			first += count;
+		}
+		//meshlet ranges were empty draws in the multi draw, their meshlets follow
+		for (size_t i = groupStart; i < groupEnd; ++i) {
+			if (draws_meshlets(meshRegistry.get(frame.draws[i].mesh))) {
+				render_meshlets(commandBuffer, frame, i);
+			}
 		}
 	}
 }
 
-void Engine::render_objects(vk::CommandBuffer commandBuffer, meshTypes objectType, uint32_t& startInstance, uint32_t instanceCount) {
-	int vertexCount = meshes->indexCounts.find(objectType)->second;
-	int firstVertex = meshes->firstIndices.find(objectType)->second;
-	materials[objectType]->use(commandBuffer, pipelineLayout);
-	commandBuffer.drawIndexed(vertexCount, instanceCount, firstVertex, 0, startInstance);
-	startInstance += instanceCount;
+void Engine::render_offscreen(Scene* scene) {
+	vkUtils::FrameContext& frame = frameContexts[frameNumber];
+
+	frameTimeline.wait(frame.timelineValue);
+	frameTimeline.collect();
+
+	uint32_t imageIndex = static_cast<uint32_t>(frameNumber);
+
+	vk::CommandBuffer commandbuffer = frame.commandBuffer;
+
+	frame.reset_command_pools();
+
+	prepare_frame(frame, scene);
+
+	record_draw_commands(frame, imageIndex, scene);
+
+	uint64_t signalValue = frameTimeline.next();
+
+	vk::SubmitInfo submitInfo = {};
+
+	std::vector<vk::Semaphore> waitSemaphores;
+	std::vector<vk::PipelineStageFlags> waitStages;
+	std::vector<uint64_t> waitValues;
+	if (frame.uploadWaitValue) {
+		waitSemaphores.push_back(transfer->timeline.semaphore);
+		waitStages.push_back(vk::PipelineStageFlagBits::eAllCommands);
+		waitValues.push_back(frame.uploadWaitValue);
+	}
+	submitInfo.waitSemaphoreCount = static_cast<uint32_t>(waitSemaphores.size());
+	submitInfo.pWaitSemaphores = waitSemaphores.data();
+	submitInfo.pWaitDstStageMask = waitStages.data();
+
+	vk::TimelineSemaphoreSubmitInfo timelineInfo = {};
+	timelineInfo.waitSemaphoreValueCount = static_cast<uint32_t>(waitValues.size());
+	timelineInfo.pWaitSemaphoreValues = waitValues.data();
+	timelineInfo.signalSemaphoreValueCount = 1;
+	timelineInfo.pSignalSemaphoreValues = &signalValue;
+
+	submitInfo.pNext = &timelineInfo;
+	submitInfo.commandBufferCount = 1;
+	submitInfo.pCommandBuffers = &commandbuffer;
+	submitInfo.signalSemaphoreCount = 1;
+	submitInfo.pSignalSemaphores = &frameTimeline.semaphore;
+
+	try {
+		graphicsQueue.submit(submitInfo, nullptr);
+		frameTimeline.mark_submitted(signalValue);
+		frame.timelineValue = signalValue;
+	}
+	catch (vk::SystemError err) {
+		if (debugMode) {
+			std::cout << "failed to submit draw command buffer!" << std::endl;
+		}
+	}
+
+	frameNumber = (frameNumber + 1) % maxFramesInFlight;
 }
 
 void Engine::render(Scene* scene) {
-	device.waitForFences(1, &(swapchainFrames[frameNumber].inFlight), VK_TRUE, UINT64_MAX);
-	device.resetFences(1, &(swapchainFrames[frameNumber].inFlight));
+	if (headless) {
+		render_offscreen(scene);
+		return;
+	}
+
+	vkUtils::FrameContext& frame = frameContexts[frameNumber];
 
+	//the context's resources are free once the last frame which used them has retired
+	frameTimeline.wait(frame.timelineValue);
+	frameTimeline.collect();
 
 	uint32_t imageIndex;
 
 	try
 	{
-		vk::ResultValue acquire = device.acquireNextImageKHR(swapchain, UINT64_MAX, swapchainFrames[frameNumber].imageAvailable, nullptr);
+		vk::ResultValue acquire = device.acquireNextImageKHR(swapchain, UINT64_MAX, frame.imageAvailable, nullptr);
 		imageIndex = acquire.value;
 	}
 	catch (vk::OutOfDateKHRError error)
@@ -434,33 +1085,50 @@ void Engine::render(Scene* scene) {
 		std::cout << "Failed to acquire swapchain image!" << std::endl;
 	}
 
-	
-
-	vk::CommandBuffer commandbuffer = swapchainFrames[frameNumber].commangBuffer;
+	vk::CommandBuffer commandbuffer = frame.commandBuffer;
 
-	commandbuffer.reset();
+	frame.reset_command_pools();
 
-	prepare_frame(imageIndex, scene);
+	prepare_frame(frame, scene);
 
-	record_draw_commands(commandbuffer, imageIndex, scene);
+	record_draw_commands(frame, imageIndex, scene);
 
 	vk::SubmitInfo submitInfo = {};
 
-	vk::Semaphore waitSemaphores[] = { swapchainFrames[frameNumber].imageAvailable };
-	vk::PipelineStageFlags waitStages[] = { vk::PipelineStageFlagBits::eColorAttachmentOutput };
-	submitInfo.waitSemaphoreCount = 1;
-	submitInfo.pWaitSemaphores = waitSemaphores;
-	submitInfo.pWaitDstStageMask = waitStages;
+	//values are ignored for binary semaphores, but the arrays must match the semaphore counts
+	std::vector<vk::Semaphore> waitSemaphores = { frame.imageAvailable };
+	std::vector<vk::PipelineStageFlags> waitStages = { vk::PipelineStageFlagBits::eColorAttachmentOutput };
+	std::vector<uint64_t> waitValues = { 0 };
+	if (frame.uploadWaitValue) {
+		waitSemaphores.push_back(transfer->timeline.semaphore);
+		waitStages.push_back(vk::PipelineStageFlagBits::eAllCommands);
+		waitValues.push_back(frame.uploadWaitValue);
+	}
+	submitInfo.waitSemaphoreCount = static_cast<uint32_t>(waitSemaphores.size());
+	submitInfo.pWaitSemaphores = waitSemaphores.data();
+	submitInfo.pWaitDstStageMask = waitStages.data();
 
 	submitInfo.commandBufferCount = 1;
 	submitInfo.pCommandBuffers = &commandbuffer;
 
-	vk::Semaphore signalSemaphores[] = { swapchainFrames[frameNumber].renderFinished };
-	submitInfo.signalSemaphoreCount = 1;
+	//binary for presentation, timeline for pacing
+	vk::Semaphore signalSemaphores[] = { swapchainFrames[imageIndex].renderFinished, frameTimeline.semaphore };
+	submitInfo.signalSemaphoreCount = 2;
 	submitInfo.pSignalSemaphores = signalSemaphores;
 
+	uint64_t signalValue = frameTimeline.next();
+	uint64_t signalValues[] = { 0, signalValue };
+	vk::TimelineSemaphoreSubmitInfo timelineInfo = {};
+	timelineInfo.waitSemaphoreValueCount = static_cast<uint32_t>(waitValues.size());
+	timelineInfo.pWaitSemaphoreValues = waitValues.data();
+	timelineInfo.signalSemaphoreValueCount = 2;
+	timelineInfo.pSignalSemaphoreValues = signalValues;
+	submitInfo.pNext = &timelineInfo;
+
 	try {
-		graphicsQueue.submit(submitInfo, swapchainFrames[frameNumber].inFlight);
+		graphicsQueue.submit(submitInfo, nullptr);
+		frameTimeline.mark_submitted(signalValue);
+		frame.timelineValue = signalValue;
 	}
 	catch (vk::SystemError err) {
 		if (debugMode) {
@@ -487,14 +1155,57 @@ void Engine::render(Scene* scene) {
 		present = vk::Result::eErrorOutOfDateKHR;
 	}
 
+	frameNumber = (frameNumber + 1) % maxFramesInFlight;
+
 	if (present == vk::Result::eErrorOutOfDateKHR || present == vk::Result::eSuboptimalKHR)
 	{
 		std::cout << "Recreate" << std::endl;
 		recreate_swapchain();
 		return;
 	}
+}
+
+const MeshRegistry& Engine::mesh_registry() const {
+	return meshRegistry;
+}
+
+size_t Engine::transform_bytes_last_frame() const {
+	return transformBytesLastFrame;
+}
+
+uint64_t Engine::transform_bytes_total() const {
+	return transformBytesTotal;
+}
+
+uint32_t Engine::visible_instances_last_frame() const {
+	return visibleInstancesLastFrame;
+}
+
+uint32_t Engine::culled_instances_last_frame() const {
+	return culledInstancesLastFrame;
+}
+
+uint32_t Engine::draws_last_frame() const {
+	return drawsLastFrame;
+}
 
-	frameNumber = (frameNumber + 1) % maxFrameInFlight;
+/*
+	Print how big the instance storage got, to pre-size it for a given scene
+*/
+void Engine::report_instance_storage() {
+	size_t capacity = 0, highWaterMark = 0;
+	uint32_t growths = 0;
+	for (const vkUtils::FrameContext& frame : frameContexts) {
+		capacity = std::max(capacity, frame.modelCapacity);
+		highWaterMark = std::max(highWaterMark, frame.modelHighWaterMark);
+		growths += frame.modelBufferGrowths;
+	}
+	std::cout << "Instance storage: capacity " << capacity << " of at most " << maxInstanceCapacity
+		<< ", high water mark " << highWaterMark << ", grown " << growths << " times across " << frameContexts.size() << " frames" << std::endl;
+	if (framesPrepared) {
+		std::cout << "Transform uploads: " << transformBytesTotal << " bytes over " << framesPrepared
+			<< " frames, " << transformBytesTotal / framesPrepared << " per frame on average" << std::endl;
+	}
 }
 
 /*
@@ -504,9 +1215,24 @@ void Engine::cleanup_swapchain() {
 	for (vkUtils::SwapChainFrame frame : swapchainFrames) {
 		frame.destroy();
 	}
-	device.destroySwapchainKHR(swapchain);
+	if (swapchain) {
+		device.destroySwapchainKHR(swapchain);
+	}
+}
+
+/*
+	Free the resources owned by the frames in flight
+*/
+void Engine::cleanup_frame_contexts() {
+	frameTimeline.destroy();
+
+	for (vkUtils::FrameContext& frame : frameContexts) {
+		frame.destroy();
+	}
+	frameContexts.clear();
 
 	device.destroyDescriptorPool(frameDescriptorPool);
+	device.destroyDescriptorPool(cullDescriptorPool);
 }
 
 Engine::~Engine() {
@@ -515,26 +1241,44 @@ Engine::~Engine() {
 
 	if (debugMode)
 	{
+		report_instance_storage();
 		std::cout << "Goodbye see you! " << std::endl;
 	}
 
 	device.destroyCommandPool(commandPool);
 
+	delete workers;
+
 	device.destroyPipeline(pipeline);
 	device.destroyPipelineLayout(pipelineLayout);
+	device.destroyPipeline(cullPipeline);
+	device.destroyPipelineLayout(cullPipelineLayout);
 	device.destroyRenderPass(renderpass);
 
 	cleanup_swapchain();
+	cleanup_frame_contexts();
 
 	device.destroyDescriptorSetLayout(frameSetLayout);
 	device.destroyDescriptorSetLayout(meshSetLayout);
+	device.destroyDescriptorSetLayout(cullSetLayout);
 	device.destroyDescriptorPool(meshDescriptorPool);
 
 	delete meshes;
+	for (vkImage::Texture* material : materials) {
+		delete material;
+	}
+
+	//after the device is idle, so every staging buffer has retired
+	delete transfer;
+
+	//last, every buffer and image has been destroyed by now
+	delete allocator;
 
 	device.destroy();
 
-	instance.destroySurfaceKHR(surface);
+	if (surface) {
+		instance.destroySurfaceKHR(surface);
+	}
 	if (debugMode) {
 		instance.destroyDebugUtilsMessengerEXT(debugMessage, nullptr, dldi);
 	}
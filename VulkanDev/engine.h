@@ -5,17 +5,87 @@
 #include "frame.h"
 #include "scene.h"
 #include "vertex_menagerie.h"
+#include "mesh_registry.h"
 #include "image.h"
+#include "timeline.h"
+#include "transfer.h"
+#include "allocator.h"
+#include "worker_pool.h"
+#include "render_structs.h"
+
+/**
+	How the engine renders, beyond the window it renders into. Filled from the command line,
+	each request the device can't honour falls back as its field describes.
+*/
+struct EngineOptions {
+	bool debug{ true };
+	//frames recorded ahead of the GPU, clamped to [1, 4]
+	int framesInFlight{ 2 };
+	//instances the model buffers start out with room for, they grow past it on demand
+	size_t instanceCapacity{ 1024 };
+	//culls on the CPU instead if the device can't draw with indirect counts or indirect first instances
+	bool gpuCulling{ false };
+	//one descriptor set per texture instead if the device lacks descriptor indexing
+	bool bindless{ false };
+	//null or unloadable for the built in meshes
+	const char* meshArchive{ nullptr };
+	//how the meshes' vertices are stored
+	vkMesh::VertexLayout vertexLayout;
+	//optimize the built in meshes for the vertex cache, overdraw and fetch as they're loaded
+	bool optimizeMeshes{ false };
+	//needs GPU culling, it culls the meshlets of every surviving instance too
+	bool meshletCulling{ false };
+	//culling on the CPU draws each instance at the coarsest level of detail whose error covers at most
+	//this many pixels on screen, 0 always draws the full meshes
+	float lodErrorPixels{ 1.0f };
+};
 
 class Engine {
 public:
-	Engine(int width, int height, GLFWwindow* window, bool debug);
+	/*
+		A headless engine renders into device-owned color targets with no surface or swapchain,
+		its window is ignored. Otherwise the window must exist.
+		GPU culling falls back to culling on the CPU if the device can't draw with indirect counts,
+		and bindless materials fall back to a descriptor set per texture without descriptor indexing.
+		Meshes come from the mesh archive if one is given and can be loaded, the built in meshes otherwise,
+		and have their vertices stored in the vertex layout, optimized for the vertex cache, overdraw and fetch if asked to.
+		Meshlet culling needs GPU culling, it culls the meshlets of every surviving instance too.
+		Levels of detail are only picked when culling on the CPU.
+	*/
+	Engine(int width, int height, GLFWwindow* window, bool headless, const EngineOptions& options);
 
 	~Engine();
 
 	void render(Scene* scene);
+
+	/*
+		\returns the loaded meshes, for building scenes
+	*/
+	const MeshRegistry& mesh_registry() const;
+
+	/*
+		\returns the bytes of world matrices the last frame wrote to its model buffer
+	*/
+	size_t transform_bytes_last_frame() const;
+
+	/*
+		\returns the bytes of world matrices written to model buffers since startup
+	*/
+	uint64_t transform_bytes_total() const;
+
+	/*
+		\returns how many instances the last frame drew, and how many it culled
+	*/
+	uint32_t visible_instances_last_frame() const;
+	uint32_t culled_instances_last_frame() const;
+
+	/*
+		\returns how many draws the last frame was batched into
+	*/
+	uint32_t draws_last_frame() const;
 private:
 	bool debugMode = true;
+	bool headless = false;
 
 	//glfw window parameters
 	int width{ 640 };
@@ -40,6 +110,7 @@ private:
 	vk::Device device{ nullptr };
 	vk::Queue graphicsQueue{ nullptr };
 	vk::Queue presentQueue{ nullptr };
+	vk::Queue transferQueue{ nullptr };
 	vk::SwapchainKHR swapchain{ nullptr };
 	std::vector<vkUtils::SwapChainFrame> swapchainFrames;
 	vk::Format swapchainFormat;
@@ -56,16 +127,75 @@ private:
 	vk::DescriptorSetLayout meshSetLayout;
 	vk::DescriptorPool meshDescriptorPool;  //Descriptors bound on a "pre mesh" basis
 
+	//GPU culling, a compute pass which fills in indirect draws
+	bool gpuCulling{ false };
+	vk::DescriptorSetLayout cullSetLayout;
+	vk::DescriptorPool cullDescriptorPool;
+	vk::PipelineLayout cullPipelineLayout;
+	vk::Pipeline cullPipeline;
+	//the culling shader goes on to cull meshlets, which are drawn from their own indirect buffer
+	bool meshletCulling{ false };
+
+	//Bindless materials, every texture in one array indexed per instance
+	bool bindless{ false };
+	vk::DescriptorSet materialSet;
+	//the size of the texture array, clamped to the device's limits
+	uint32_t bindlessTextureCapacity{ 4096 };
+	uint32_t maxDrawIndirectCount{ 1 };
+
 	//Command-related variables
 	vk::CommandPool commandPool;
 	vk::CommandBuffer mainCommandBuffer;
 
-	//Synchronization objects
-	int maxFrameInFlight, frameNumber;
+	//Sub-allocates every buffer and image
+	vkUtils::MemoryAllocator* allocator;
+
+	//Asynchronous uploads, on a dedicated transfer queue when the device has one
+	vkUtils::TransferSystem* transfer;
+	//every upload stages through a ring of this size, bigger uploads are split up
+	vk::DeviceSize stagingRingSize{ 32 * 1024 * 1024 };
+
+	//Threads for recording secondary command buffers
+	vkUtils::WorkerPool* workers;
+
+	//Frames in flight, independent of the swapchain image count
+	std::vector<vkUtils::FrameContext> frameContexts;
+	int maxFramesInFlight, frameNumber;
+
+	//transforms each frame's model buffer starts out holding, it grows on demand
+	size_t instanceCapacity;
+	//the most transforms a model buffer's descriptor can cover, from the device's storage buffer range
+	size_t maxInstanceCapacity;
+
+	//model buffer write bandwidth
+	size_t transformBytesLastFrame{ 0 };
+	uint64_t transformBytesTotal{ 0 };
+	uint64_t framesPrepared{ 0 };
+
+	//culling results of the last frame
+	uint32_t visibleInstancesLastFrame{ 0 }, culledInstancesLastFrame{ 0 };
+	uint32_t drawsLastFrame{ 0 };
+
+	//screen space error allowed for a level of detail, in pixels
+	float lodErrorPixels{ 1.0f };
+
+	//clip distances, depth sort keys are scaled by the far one
+	float nearPlane{ 0.1f }, farPlane{ 10.0f };
+
+	//Every graphics submit signals the next value, frame N is done once the counter reaches N
+	vkUtils::Timeline frameTimeline;
 
 	//asset pointers
 	VertexMenagerie* meshes;
-	std::unordered_map<meshTypes, vkImage::Texture*> materials;
+	//mapped instead of the built in meshes when set, only while loading assets
+	const char* meshArchive{ nullptr };
+	//how vertices are quantized, the pipeline's vertex input matches it
+	vkMesh::VertexLayout vertexLayout;
+	//reorder the built in meshes as they're consumed, archives are optimized when they're written
+	bool optimizeMeshes{ false };
+	MeshRegistry meshRegistry;
+	//every loaded texture, meshes refer to them
+	std::vector<vkImage::Texture*> materials;
 
 	//instance setup
 	void make_instance();
@@ -85,16 +215,33 @@ private:
 	//final setup steps
 	void finalize_setup();
 	void make_framebuffers();
-	void make_frame_resources();
+	void make_frame_contexts();
 
 	//asset creation
 	void make_assets();
 
-	void prepare_frame(uint32_t imageIndex, Scene* scene);
+	void render_offscreen(Scene* scene);
+	void prepare_frame(vkUtils::FrameContext& frame, Scene* scene);
+	void cull_instances(vkUtils::FrameContext& frame, Scene* scene);
+	void prepare_gpu_culling(vkUtils::FrameContext& frame, Scene* scene);
+	void record_gpu_culling(vkUtils::FrameContext& frame, vk::CommandBuffer commandBuffer);
 	void prepare_scene(vk::CommandBuffer commandBuffer);
-	void record_draw_commands(vk::CommandBuffer commandBuffer, uint32_t imageIndex, Scene* scene);
-	void render_objects(vk::CommandBuffer commandBuffer, meshTypes objectType, uint32_t& startInstance, uint32_t instanceCount);
+	void record_draw_commands(vkUtils::FrameContext& frame, uint32_t imageIndex, Scene* scene);
+	void record_draw_chunk(vkUtils::FrameContext& frame, uint32_t imageIndex, size_t chunk, const std::vector<vkUtil::DrawCommand>& draws, size_t first, size_t last);
+	uint32_t index_group(const MeshRange& mesh) const;
+	uint32_t select_lod(const MeshRange& mesh, float scale, float depth, float lodScale) const;
+	bool draws_meshlets(const MeshRange& mesh) const;
+	void render_meshlets(vk::CommandBuffer commandBuffer, vkUtils::FrameContext& frame, size_t drawIndex);
+	void bind_index_buffer(vk::CommandBuffer commandBuffer, const MeshRange& mesh, vkUtil::BoundState& bound);
+	void bind_material(vk::CommandBuffer commandBuffer, const MeshRange& mesh, vkUtil::BoundState& bound);
+	void render_objects(vk::CommandBuffer commandBuffer, const vkUtil::DrawCommand& draw, vkUtil::BoundState& bound);
+	void render_objects_indirect(vk::CommandBuffer commandBuffer, vkUtils::FrameContext& frame, size_t drawIndex, const vkUtil::DrawCommand& draw, vkUtil::BoundState& bound);
+	void render_objects_bindless(vk::CommandBuffer commandBuffer, vkUtils::FrameContext& frame, size_t first, size_t last);
+	void write_material_descriptors();
+
+	void report_instance_storage();
 
 	//Cleanup functions
 	void cleanup_swapchain();
+	void cleanup_frame_contexts();
 };
\ No newline at end of file
@@ -1,8 +1,9 @@
 #include "frame.h"
 #include "memory.h"
 #include "image.h"
+#include "allocator.h"
 
-void vkUtils::SwapChainFrame::make_descriptor_resources() {
+void vkUtils::FrameContext::make_descriptor_resources(size_t instanceCapacity) {
 
 	BufferInputChunk input;
 	input.logicalDevice = logicalDevice;
@@ -10,22 +11,12 @@ void vkUtils::SwapChainFrame::make_descriptor_resources() {
 	input.physicalDevice = physicalDevice;
 	input.size = sizeof(UBO);
 	input.usage = vk::BufferUsageFlagBits::eUniformBuffer;
+	input.allocator = allocator;
 	cameraDataBuffer = createBuffer(input);
 
-	cameraDataWriteLocation = logicalDevice.mapMemory(cameraDataBuffer.bufferMemory, 0, input.size);
+	cameraDataWriteLocation = cameraDataBuffer.allocation.mappedPointer;
 
-	input.size = 1024 * sizeof(glm::mat4);
-	input.usage = vk::BufferUsageFlagBits::eStorageBuffer;
-	modelBuffer = createBuffer(input);
-
-	modelBufferWriteLocation = logicalDevice.mapMemory(modelBuffer.bufferMemory, 0, 1024 * sizeof(glm::mat4));
-
-	modelTransforms.reserve(1024);
-
-	for (size_t i = 0; i < 1024; i++)
-	{
-		modelTransforms.push_back(glm::mat4(1.0f));
-	}
+	make_model_buffer(std::max<size_t>(instanceCapacity, 1));
 
 	/*
 	typedef struct VkDescriptorBufferInfo {
@@ -37,10 +28,57 @@ void vkUtils::SwapChainFrame::make_descriptor_resources() {
 	uniformBufferDescriptor.buffer = cameraDataBuffer.buffer;
 	uniformBufferDescriptor.offset = 0;
 	uniformBufferDescriptor.range = sizeof(UBO);
+}
+
+void vkUtils::FrameContext::make_model_buffer(size_t instanceCapacity) {
+	BufferInputChunk input;
+	input.logicalDevice = logicalDevice;
+	input.physicalDevice = physicalDevice;
+	input.memoryProperties = vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent;
+	input.size = instanceCapacity * sizeof(glm::mat4);
+	input.usage = vk::BufferUsageFlagBits::eStorageBuffer;
+	input.allocator = allocator;
+	modelBuffer = createBuffer(input);
+
+	modelBufferWriteLocation = modelBuffer.allocation.mappedPointer;
+	modelCapacity = instanceCapacity;
 
 	modelBufferDescriptor.buffer = modelBuffer.buffer;
 	modelBufferDescriptor.offset = 0;
-	modelBufferDescriptor.range = 1024 * sizeof(glm::mat4);
+	modelBufferDescriptor.range = input.size;
+
+	//at worst every instance is visible, each entry is the instance and its material
+	input.size = instanceCapacity * 2 * sizeof(uint32_t);
+	visibleBuffer = createBuffer(input);
+
+	visibleBufferWriteLocation = visibleBuffer.allocation.mappedPointer;
+
+	visibleBufferDescriptor.buffer = visibleBuffer.buffer;
+	visibleBufferDescriptor.offset = 0;
+	visibleBufferDescriptor.range = input.size;
+}
+
+void vkUtils::FrameContext::reserve_models(size_t instanceCount) {
+	modelHighWaterMark = std::max(modelHighWaterMark, instanceCount);
+	if (instanceCount <= modelCapacity) {
+		return;
+	}
+
+	if (instanceCount > modelCapacityLimit) {
+		throw std::runtime_error("Scene has " + std::to_string(instanceCount) + " instances, but the device's storage buffer range only covers "
+			+ std::to_string(modelCapacityLimit) + " transforms");
+	}
+
+	//doubling keeps the number of reallocations logarithmic in the final size, short of the limit
+	size_t newCapacity = std::min(std::max(instanceCount, modelCapacity * 2), modelCapacityLimit);
+
+	retire_buffer(modelBuffer);
+	retire_buffer(visibleBuffer);
+	make_model_buffer(newCapacity);
+	write_descriptor_set();
+	transformVersion = 0;
+
+	++modelBufferGrowths;
 }
 
 void vkUtils::SwapChainFrame::make_depth_resources() {
@@ -54,15 +92,16 @@ void vkUtils::SwapChainFrame::make_depth_resources() {
 	imageInfo.width = width;
 	imageInfo.height = height;
 	imageInfo.format = depthFormat;
+	imageInfo.allocator = allocator;
 
 	depthBuffer = vkImage::make_image(imageInfo);
-	depthBufferMemory = vkImage::make_image_memory(imageInfo, depthBuffer);
+	depthBufferAllocation = vkImage::make_image_memory(imageInfo, depthBuffer);
 	depthBufferView = vkImage::make_image_view(logicalDevice, depthBuffer, depthFormat, vk::ImageAspectFlagBits::eDepth);
 
 
 }
 
-void vkUtils::SwapChainFrame::write_descriptor_set() {
+void vkUtils::FrameContext::write_descriptor_set() {
 	vk::WriteDescriptorSet writeInfo;
 	/*
 	typedef struct VkWriteDescriptorSet {
@@ -96,24 +135,152 @@ void vkUtils::SwapChainFrame::write_descriptor_set() {
 	writeInfo2.pBufferInfo = &modelBufferDescriptor;
 
 	logicalDevice.updateDescriptorSets(writeInfo2, nullptr);
+
+	vk::WriteDescriptorSet writeInfo3;
+	writeInfo3.dstSet = descriptorSet;
+	writeInfo3.dstBinding = 2;
+	writeInfo3.dstArrayElement = 0;
+	writeInfo3.descriptorCount = 1;
+	writeInfo3.descriptorType = vk::DescriptorType::eStorageBuffer;
+	writeInfo3.pBufferInfo = &visibleBufferDescriptor;
+
+	logicalDevice.updateDescriptorSets(writeInfo3, nullptr);
+
+	if (!cullDescriptorSet || !cullDrawBuffer.buffer) {
+		return;
+	}
+
+	std::array<vk::WriteDescriptorSet, 3> cullWrites;
+	const vk::DescriptorBufferInfo* cullBuffers[] = { &modelBufferDescriptor, &visibleBufferDescriptor, &cullDrawDescriptor };
+	for (uint32_t i = 0; i < cullWrites.size(); ++i) {
+		cullWrites[i].dstSet = cullDescriptorSet;
+		cullWrites[i].dstBinding = i;
+		cullWrites[i].dstArrayElement = 0;
+		cullWrites[i].descriptorCount = 1;
+		cullWrites[i].descriptorType = vk::DescriptorType::eStorageBuffer;
+		cullWrites[i].pBufferInfo = cullBuffers[i];
+	}
+	logicalDevice.updateDescriptorSets(cullWrites, nullptr);
+
+	if (!meshletDescriptor.buffer || !meshletDrawBuffer.buffer) {
+		return;
+	}
+
+	std::array<vk::WriteDescriptorSet, 2> meshletWrites;
+	const vk::DescriptorBufferInfo* meshletBuffers[] = { &meshletDescriptor, &meshletDrawDescriptor };
+	for (uint32_t i = 0; i < meshletWrites.size(); ++i) {
+		meshletWrites[i].dstSet = cullDescriptorSet;
+		meshletWrites[i].dstBinding = 3 + i;
+		meshletWrites[i].dstArrayElement = 0;
+		meshletWrites[i].descriptorCount = 1;
+		meshletWrites[i].descriptorType = vk::DescriptorType::eStorageBuffer;
+		meshletWrites[i].pBufferInfo = meshletBuffers[i];
+	}
+	logicalDevice.updateDescriptorSets(meshletWrites, nullptr);
+}
+
+void vkUtils::FrameContext::reserve_cull_draws(size_t drawCount) {
+	if (drawCount <= cullDrawCapacity) {
+		return;
+	}
+	cullDrawCapacity = std::max(drawCount, cullDrawCapacity * 2);
+
+	retire_buffer(cullDrawBuffer);
+
+	BufferInputChunk input;
+	input.logicalDevice = logicalDevice;
+	input.physicalDevice = physicalDevice;
+	input.memoryProperties = vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent;
+	input.size = cullDrawCapacity * sizeof(vkUtil::CullDraw);
+	input.usage = vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eIndirectBuffer;
+	input.allocator = allocator;
+	cullDrawBuffer = createBuffer(input);
+
+	cullDrawWriteLocation = cullDrawBuffer.allocation.mappedPointer;
+
+	cullDrawDescriptor.buffer = cullDrawBuffer.buffer;
+	cullDrawDescriptor.offset = 0;
+	cullDrawDescriptor.range = input.size;
+
+	write_descriptor_set();
+}
+
+void vkUtils::FrameContext::reserve_meshlet_draws(size_t drawCount) {
+	if (drawCount <= meshletDrawCapacity) {
+		return;
+	}
+	meshletDrawCapacity = std::max(drawCount, meshletDrawCapacity * 2);
+
+	retire_buffer(meshletDrawBuffer);
+
+	//only the culling shader writes these, so they can live in device memory
+	BufferInputChunk input;
+	input.logicalDevice = logicalDevice;
+	input.physicalDevice = physicalDevice;
+	input.memoryProperties = vk::MemoryPropertyFlagBits::eDeviceLocal;
+	input.size = meshletDrawCapacity * sizeof(vk::DrawIndexedIndirectCommand);
+	input.usage = vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eIndirectBuffer;
+	input.allocator = allocator;
+	meshletDrawBuffer = createBuffer(input);
+
+	meshletDrawDescriptor.buffer = meshletDrawBuffer.buffer;
+	meshletDrawDescriptor.offset = 0;
+	meshletDrawDescriptor.range = input.size;
+
+	write_descriptor_set();
+}
+
+void vkUtils::FrameContext::retire_buffer(Buffer& buffer) {
+	if (!buffer.buffer) {
+		return;
+	}
+
+	//destroyed once every submission so far has retired, the old buffer is gone from the descriptor sets by then
+	vk::Device device = logicalDevice;
+	MemoryAllocator* memoryAllocator = allocator;
+	Buffer retired = buffer;
+	timeline->defer([device, memoryAllocator, retired]() mutable {
+		destroyBuffer(device, memoryAllocator, retired);
+	});
+	buffer.buffer = nullptr;
+	buffer.allocation = {};
 }
 
 void vkUtils::SwapChainFrame::destroy() {
 	logicalDevice.destroyImageView(imageView);
 	logicalDevice.destroyFramebuffer(frameBuffer);
-	logicalDevice.destroyFence(inFlight);
-	logicalDevice.destroySemaphore(imageAvailable);
 	logicalDevice.destroySemaphore(renderFinished);
 
-	logicalDevice.unmapMemory(cameraDataBuffer.bufferMemory);
-	logicalDevice.freeMemory(cameraDataBuffer.bufferMemory);
-	logicalDevice.destroyBuffer(cameraDataBuffer.buffer);
-
-	logicalDevice.unmapMemory(modelBuffer.bufferMemory);
-	logicalDevice.freeMemory(modelBuffer.bufferMemory);
-	logicalDevice.destroyBuffer(modelBuffer.buffer);
+	if (imageAllocation.memory) {
+		logicalDevice.destroyImage(image);
+		allocator->free(imageAllocation);
+	}
 
 	logicalDevice.destroyImage(depthBuffer);
-	logicalDevice.freeMemory(depthBufferMemory);
+	allocator->free(depthBufferAllocation);
 	logicalDevice.destroyImageView(depthBufferView);
+}
+
+void vkUtils::FrameContext::reset_command_pools() {
+	logicalDevice.resetCommandPool(commandPool);
+	for (vk::CommandPool pool : workerCommandPools) {
+		logicalDevice.resetCommandPool(pool);
+	}
+}
+
+void vkUtils::FrameContext::destroy() {
+	logicalDevice.destroyCommandPool(commandPool);
+	for (vk::CommandPool pool : workerCommandPools) {
+		logicalDevice.destroyCommandPool(pool);
+	}
+	workerCommandPools.clear();
+	workerCommandBuffers.clear();
+
+	logicalDevice.destroySemaphore(imageAvailable);
+
+	destroyBuffer(logicalDevice, allocator, cameraDataBuffer);
+	destroyBuffer(logicalDevice, allocator, modelBuffer);
+	destroyBuffer(logicalDevice, allocator, visibleBuffer);
+	destroyBuffer(logicalDevice, allocator, cullDrawBuffer);
+	destroyBuffer(logicalDevice, allocator, meshletDrawBuffer);
 }
\ No newline at end of file
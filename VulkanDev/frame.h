@@ -1,6 +1,9 @@
 #pragma once
 #include "config.h"
 #include "memory.h"
+#include "render_structs.h"
+#include "draw_packets.h"
+#include "timeline.h"
 
 namespace vkUtils {
 
@@ -17,7 +20,7 @@ namespace vkUtils {
 
 
 	/**
-		Holds the data structures associated with a "Frame"
+		Holds the data structures associated with a swapchain image
 	*/
 
 	class SwapChainFrame {
@@ -25,45 +28,151 @@ namespace vkUtils {
 		//For doing work
 		vk::Device logicalDevice;
 		vk::PhysicalDevice physicalDevice;
+		MemoryAllocator* allocator;
 		
 		//swapchain-type stuff
 		vk::Image image;
 		vk::ImageView imageView;
 		vk::Framebuffer frameBuffer;
 
+		//only set for offscreen targets, swapchain images belong to the swapchain
+		Allocation imageAllocation;
+
 		vk::Image depthBuffer;
-		vk::DeviceMemory depthBufferMemory;
+		Allocation depthBufferAllocation;
 		vk::ImageView depthBufferView;
 		vk::Format depthFormat;
 		int width, height;
 
-		vk::CommandBuffer commangBuffer;
+		//Signalled when rendering to this image is done, presentation waits on it
+		vk::Semaphore renderFinished;
+
+		void make_depth_resources();
+
+		void destroy();
+	};
+
+	/**
+		Holds the CPU-written resources for one frame in flight.
+		Frame contexts form a ring whose depth is independent of the swapchain image count.
+	*/
+
+	class FrameContext {
+	public:
+		//For doing work
+		vk::Device logicalDevice;
+		vk::PhysicalDevice physicalDevice;
+		MemoryAllocator* allocator;
+		//buffers replaced while growing are destroyed through it
+		Timeline* timeline;
+
+		//Primary buffer, only executes the secondaries
+		vk::CommandPool commandPool;
+		vk::CommandBuffer commandBuffer;
+
+		//One transient pool and secondary buffer per recording thread
+		std::vector<vk::CommandPool> workerCommandPools;
+		std::vector<vk::CommandBuffer> workerCommandBuffers;
 
 		//Sync objects
-		vk::Semaphore imageAvailable, renderFinished;
-		vk::Fence inFlight;
+		vk::Semaphore imageAvailable;
+		//frame timeline value signalled by the last submission which used this context
+		uint64_t timelineValue{ 0 };
+		//upload timeline value the current submission waits for, 0 when it has no uploads to acquire
+		uint64_t uploadWaitValue{ 0 };
 
 		//Resources
 		UBO cameraData;
 		Buffer cameraDataBuffer;
 		void* cameraDataWriteLocation;
-		std::vector<glm::mat4> modelTransforms;
 		Buffer modelBuffer;
 		void* modelBufferWriteLocation;
+		//transform store version the model buffer is up to date with, 0 when it holds nothing yet
+		uint64_t transformVersion{ 0 };
+		//scratch list of the transform blocks to rewrite this frame
+		std::vector<uint32_t> changedBlocks;
+		//indices of the instances which survived culling, compacted per draw
+		Buffer visibleBuffer;
+		void* visibleBufferWriteLocation;
+
+		//this frame's draws, their instance ranges index the visible buffer
+		std::vector<vkUtil::DrawCommand> draws;
+		//culling output per part of the spatial index, before compaction
+		std::vector<int32_t> cullParts;
+		std::vector<uint32_t> cullScratch;
+		std::vector<size_t> cullOffsets, cullCounts;
+		//survivors with their sort keys, and working space for sorting them
+		std::vector<vkUtil::DrawPacket> drawPackets, packetScratch;
+		uint32_t visibleInstances{ 0 }, culledInstances{ 0 };
+
+		//GPU culling only, one vkUtil::CullDraw per instance range, written by the host and the culling shader
+		Buffer cullDrawBuffer;
+		void* cullDrawWriteLocation{ nullptr };
+		size_t cullDrawCapacity{ 0 };
+		uint32_t cullInputInstances{ 0 };
+		//meshlet culling only, the culling shader appends a VkDrawIndexedIndirectCommand per surviving meshlet
+		Buffer meshletDrawBuffer;
+		size_t meshletDrawCapacity{ 0 };
+
+		//Instance storage stats, capacity is in transforms
+		size_t modelCapacity{ 0 };
+		//the device's storage buffer range in transforms, the model buffer never grows past it
+		size_t modelCapacityLimit{ SIZE_MAX };
+		size_t modelHighWaterMark{ 0 };
+		uint32_t modelBufferGrowths{ 0 };
 
 		//Resource Descriptors
 		vk::DescriptorBufferInfo uniformBufferDescriptor;
 		vk::DescriptorBufferInfo modelBufferDescriptor;
+		vk::DescriptorBufferInfo visibleBufferDescriptor;
 		vk::DescriptorSet descriptorSet;
+		//reads the model buffer and writes the visible and cull draw buffers, GPU culling only
+		vk::DescriptorBufferInfo cullDrawDescriptor;
+		//the mesh's meshlets and the meshlet draws, bound only when culling meshlets
+		vk::DescriptorBufferInfo meshletDescriptor;
+		vk::DescriptorBufferInfo meshletDrawDescriptor;
+		vk::DescriptorSet cullDescriptorSet;
+
+		/*
+			\param instanceCapacity the number of transforms the model buffer starts out holding
+		*/
+		void make_descriptor_resources(size_t instanceCapacity);
 
-		void make_descriptor_resources();
-
-		void make_depth_resources();
+		void write_descriptor_set();
 
+		/*
+			Make sure the model and visible buffers can hold the given number of instances, growing it geometrically
+			and rewriting the descriptor set if it can't. A new buffer has to be written in full.
+			Growth stops at the capacity limit, more instances than that throw.
+			The frame must have retired.
+		*/
+		void reserve_models(size_t instanceCount);
+
+		/*
+			Make sure the cull draw buffer holds the given number of draws, rewriting the descriptor sets
+			if it has to grow. The frame must have retired.
+		*/
+		void reserve_cull_draws(size_t drawCount);
+
+		/*
+			Make sure the meshlet draw buffer holds the given number of draws, rewriting the descriptor sets
+			if it has to grow. The frame must have retired.
+		*/
+		void reserve_meshlet_draws(size_t drawCount);
+
+		/*
+			Recycle every command buffer of the frame, the frame must have retired.
+		*/
+		void reset_command_pools();
 
+		void destroy();
 
-		void write_descriptor_set();
+	private:
+		void make_model_buffer(size_t instanceCapacity);
 
-		void destroy();
+		/*
+			Hand a buffer to the frame timeline for deletion and clear it.
+		*/
+		void retire_buffer(Buffer& buffer);
 	};
 }
\ No newline at end of file
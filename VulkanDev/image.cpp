@@ -2,20 +2,25 @@
 #define STB_IMAGE_IMPLEMENTATION
 #include "stb_image.h"
 #include "memory.h"
-#include "single_time_commands.h" 
+#include "allocator.h"
 #include "descriptors.h"
 
-vkImage::Texture::Texture(TextureInputChunk input) {
+vkImage::Texture::Texture(TextureInputChunk input, int width, int height) {
 	logicalDevice = input.logicalDevice;
 	physicalDevice = input.physicalDevice;
 	filename = input.filename;
-	commandBuffer = input.commandBuffer;
-	queue = input.queue;
+	allocator = input.allocator;
 	layout = input.layout;
 	descriptorPool = input.descriptorPool;
 
-	load();
+	this->width = width;
+	this->height = height;
+	channels = 4;
 
+	make_resources();
+}
+
+void vkImage::Texture::make_resources() {
 	ImageInputChunk imageInput;
 	imageInput.logicalDevice = logicalDevice;
 	imageInput.physicalDevice = physicalDevice;
@@ -25,13 +30,10 @@ vkImage::Texture::Texture(TextureInputChunk input) {
 	imageInput.tilling = vk::ImageTiling::eOptimal;
 	imageInput.usage = vk::ImageUsageFlagBits::eTransferDst | vk::ImageUsageFlagBits::eSampled;
 	imageInput.memoryProperties = vk::MemoryPropertyFlagBits::eDeviceLocal;
+	imageInput.allocator = allocator;
 
 	image = make_image(imageInput);
-	imageMemory = make_image_memory(imageInput, image);
-
-	populate();
-
-	free(pixels);
+	imageAllocation = make_image_memory(imageInput, image);
 
 	make_view();
 
@@ -41,64 +43,12 @@ vkImage::Texture::Texture(TextureInputChunk input) {
 }
 
 vkImage::Texture::~Texture() {
-	logicalDevice.freeMemory(imageMemory);
 	logicalDevice.destroyImage(image);
+	allocator->free(imageAllocation);
 	logicalDevice.destroyImageView(imageView);
 	logicalDevice.destroySampler(sampler);
 }
 
-void vkImage::Texture::load() {
-	pixels = stbi_load(filename, &width, &height, &channels, STBI_rgb_alpha);
-	if (!pixels)
-	{
-		std::cout << "Unable to load: " << filename << std::endl;
-	}
-}
-
-void vkImage::Texture::populate() {
-	//First create a CPU-visible buffer...
-	BufferInputChunk input;
-	input.logicalDevice = logicalDevice;
-	input.physicalDevice = physicalDevice;
-	input.memoryProperties = vk::MemoryPropertyFlagBits::eHostCoherent | vk::MemoryPropertyFlagBits::eHostVisible;
-	input.usage = vk::BufferUsageFlagBits::eTransferSrc;
-	input.size = width * height * 4;
-
-	Buffer stagingBuffer = vkUtils::createBuffer(input);
-
-	//... then fill it
-	void* writeLocation = logicalDevice.mapMemory(stagingBuffer.bufferMemory, 0, input.size);
-	memcpy(writeLocation, pixels, input.size);
-	logicalDevice.unmapMemory(stagingBuffer.bufferMemory);
-
-	//then transfer it to image memory
-	ImageLayoutTransitionJob transitionJob;
-	transitionJob.commandBuffer = commandBuffer;
-	transitionJob.queue = queue;
-	transitionJob.image = image;
-	transitionJob.oldLayout = vk::ImageLayout::eUndefined;
-	transitionJob.newLayout = vk::ImageLayout::eTransferDstOptimal;
-	transition_image_layout(transitionJob);
-
-	BufferImageCopyJob copyJob;
-	copyJob.commandBuffer = commandBuffer;
-	copyJob.queue = queue;
-	copyJob.srcBuffer = stagingBuffer.buffer;
-	copyJob.dstImage = image;
-	copyJob.width = width;
-	copyJob.height = height;
-	copy_buffer_to_image(copyJob);
-
-	transitionJob.oldLayout = vk::ImageLayout::eTransferDstOptimal;
-	transitionJob.newLayout = vk::ImageLayout::eShaderReadOnlyOptimal;
-
-	transition_image_layout(transitionJob);
-
-	//Now the staging buffer can be destroyed
-	logicalDevice.freeMemory(stagingBuffer.bufferMemory);
-	logicalDevice.destroyBuffer(stagingBuffer.buffer);
-}
-
 void vkImage::Texture::make_view() {
 	imageView = make_image_view(logicalDevice, image, vk::Format::eR8G8B8A8Unorm, vk::ImageAspectFlagBits::eColor);
 }
@@ -156,12 +106,13 @@ void vkImage::Texture::make_sampler() {
 }
 
 void vkImage::Texture::make_descriptor_set() {
+	if (!descriptorPool) {
+		return;
+	}
+
 	descroptorSet = vkInit::allocate_descriptor_set(logicalDevice, descriptorPool, layout);
 
-	vk::DescriptorImageInfo imageDescriptor;
-	imageDescriptor.imageLayout = vk::ImageLayout::eShaderReadOnlyOptimal;
-	imageDescriptor.imageView = imageView;
-	imageDescriptor.sampler = sampler;
+	vk::DescriptorImageInfo imageDescriptor = descriptor_info();
 
 	vk::WriteDescriptorSet descriptorWrite;
 	descriptorWrite.dstSet = descroptorSet;
@@ -174,10 +125,113 @@ void vkImage::Texture::make_descriptor_set() {
 	logicalDevice.updateDescriptorSets(descriptorWrite, nullptr);
 }
 
+vk::DescriptorImageInfo vkImage::Texture::descriptor_info() const {
+	vk::DescriptorImageInfo imageDescriptor;
+	imageDescriptor.imageLayout = vk::ImageLayout::eShaderReadOnlyOptimal;
+	imageDescriptor.imageView = imageView;
+	imageDescriptor.sampler = sampler;
+	return imageDescriptor;
+}
+
 void vkImage::Texture::use(vk::CommandBuffer commandBuffer, vk::PipelineLayout pipelineLayout) {
 	commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, pipelineLayout, 1, descroptorSet, nullptr);
 }
 
+std::vector<vkImage::Texture*> vkImage::load_textures(TextureInputChunk input, const std::vector<const char*>& filenames, vkUtils::WorkerPool* workers) {
+	struct PendingTexture {
+		int width{ 0 }, height{ 0 };
+		bool readable{ false };
+		vkUtils::StagingRange range;
+	};
+	std::vector<PendingTexture> pending(filenames.size());
+	std::vector<Texture*> textures(filenames.size());
+
+	//image sizes come from the headers, which is enough to make every resource up front
+	workers->parallel_for(filenames.size(), [&](size_t i) {
+		int channels;
+		pending[i].readable = stbi_info(filenames[i], &pending[i].width, &pending[i].height, &channels) != 0;
+	});
+
+	for (size_t i = 0; i < filenames.size(); ++i) {
+		if (!pending[i].readable) {
+			std::cout << "Unable to load: " << filenames[i] << std::endl;
+			//a single texel placeholder, so the material still has something to bind
+			pending[i].width = pending[i].height = 1;
+		}
+		input.filename = filenames[i];
+		textures[i] = new Texture(input, pending[i].width, pending[i].height);
+	}
+
+	//decode in waves which fit half the staging ring, so a wave never waits on its own ranges
+	vk::DeviceSize waveBudget = input.uploadBatch->capacity() / 2;
+	size_t next = 0;
+	while (next < filenames.size()) {
+		std::vector<size_t> wave;
+		vk::DeviceSize waveBytes = 0;
+		for (; next < filenames.size(); ++next) {
+			vk::DeviceSize bytes = static_cast<vk::DeviceSize>(pending[next].width) * pending[next].height * 4;
+			if (!wave.empty() && waveBytes + bytes > waveBudget) {
+				break;
+			}
+			wave.push_back(next);
+			waveBytes += bytes;
+			if (bytes > waveBudget) {
+				//too big to stage in one piece, goes on its own
+				++next;
+				break;
+			}
+		}
+
+		if (waveBytes > waveBudget) {
+			//staged in pieces by the batch, with the same magenta as the waves if it fails to decode
+			size_t i = wave[0];
+			int width = 0, height = 0, channels = 0;
+			stbi_uc* pixels = pending[i].readable ?
+				stbi_load(filenames[i], &width, &height, &channels, STBI_rgb_alpha) : nullptr;
+			std::vector<uint32_t> magenta;
+			if (!pixels || width != pending[i].width || height != pending[i].height) {
+				magenta.assign(static_cast<size_t>(pending[i].width) * pending[i].height, 0xffff00ffu);
+			}
+			const void* texels = magenta.empty() ? static_cast<const void*>(pixels) : magenta.data();
+			input.uploadBatch->stage_image(texels, textures[i]->image, pending[i].width, pending[i].height);
+			stbi_image_free(pixels);
+			continue;
+		}
+
+		//a flush while reserving would close this wave's ranges before they are written,
+		//so anything already in the batch goes first
+		if (!input.uploadBatch->empty()) {
+			input.uploadBatch->submit();
+		}
+		for (size_t i : wave) {
+			pending[i].range = input.uploadBatch->reserve(static_cast<vk::DeviceSize>(pending[i].width) * pending[i].height * 4);
+		}
+
+		workers->parallel_for(wave.size(), [&](size_t j) {
+			PendingTexture& texture = pending[wave[j]];
+			int width = 0, height = 0, channels = 0;
+			stbi_uc* pixels = texture.readable ?
+				stbi_load(filenames[wave[j]], &width, &height, &channels, STBI_rgb_alpha) : nullptr;
+
+			if (pixels && width == texture.width && height == texture.height) {
+				memcpy(texture.range.writeLocation, pixels, texture.range.size);
+			}
+			else {
+				//magenta for anything which failed to decode
+				uint32_t* texels = static_cast<uint32_t*>(texture.range.writeLocation);
+				std::fill(texels, texels + texture.range.size / 4, 0xffff00ffu);
+			}
+			stbi_image_free(pixels);
+		});
+
+		for (size_t i : wave) {
+			input.uploadBatch->copy_image(pending[i].range, textures[i]->image, pending[i].width, pending[i].height, 0, pending[i].height, true, true);
+		}
+	}
+
+	return textures;
+}
+
 vk::Image vkImage::make_image(ImageInputChunk input) {
 	/*
 	typedef struct VkImageCreateInfo {
@@ -220,122 +274,22 @@ vk::Image vkImage::make_image(ImageInputChunk input) {
 	}
 }
 
-vk::DeviceMemory vkImage::make_image_memory(ImageInputChunk input, vk::Image image) {
+Allocation vkImage::make_image_memory(ImageInputChunk input, vk::Image image) {
 	vk::MemoryRequirements requirements = input.logicalDevice.getImageMemoryRequirements(image);
 
-	vk::MemoryAllocateInfo allocation;
-	allocation.allocationSize = requirements.size;
-	allocation.memoryTypeIndex = vkUtils::findMemoryTypeIndex(input.physicalDevice, requirements.memoryTypeBits, input.memoryProperties);
+	Allocation allocation = input.allocator->allocate(requirements, input.memoryProperties, input.tilling == vk::ImageTiling::eLinear);
+	if (!allocation.memory) {
+		std::cout << "Unable to allocate memory for image" << std::endl;
+		return allocation;
+	}
 
 	try {
-		vk::DeviceMemory imageMemory = input.logicalDevice.allocateMemory(allocation);
-		input.logicalDevice.bindImageMemory(image, imageMemory, 0);
-		return imageMemory;
+		input.logicalDevice.bindImageMemory(image, allocation.memory, allocation.offset);
 	}
 	catch (vk::SystemError err) {
 		std::cout << "Unable to allocate memory for image" << std::endl;
 	}
-}
-
-void vkImage::transition_image_layout(ImageLayoutTransitionJob transitionJob) {
-	vkUtils::startJob(transitionJob.commandBuffer);
-	/*
-	typedef struct VkImageSubresourceRange {
-		VkImageAspectFlags    aspectMask;
-		uint32_t              baseMipLevel;
-		uint32_t              levelCount;
-		uint32_t              baseArrayLayer;
-		uint32_t              layerCount;
-	} VkImageSubresourceRange;
-	*/
-	vk::ImageSubresourceRange access;
-	access.aspectMask = vk::ImageAspectFlagBits::eColor;
-	access.baseMipLevel = 0;
-	access.levelCount = 1;
-	access.baseArrayLayer = 0;
-	access.layerCount = 1;
-	/*
-	typedef struct VkImageMemoryBarrier {
-		VkStructureType            sType;
-		const void* pNext;
-		VkAccessFlags              srcAccessMask;
-		VkAccessFlags              dstAccessMask;
-		VkImageLayout              oldLayout;
-		VkImageLayout              newLayout;
-		uint32_t                   srcQueueFamilyIndex;
-		uint32_t                   dstQueueFamilyIndex;
-		VkImage                    image;
-		VkImageSubresourceRange    subresourceRange;
-	} VkImageMemoryBarrier;
-	*/
-
-	vk::ImageMemoryBarrier barrier;
-	barrier.oldLayout = transitionJob.oldLayout;
-	barrier.newLayout = transitionJob.newLayout;
-	barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-	barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-	barrier.image = transitionJob.image;
-	barrier.subresourceRange = access;
-		
-	vk::PipelineStageFlags sourceStage, destinationStage;
-
-	if (transitionJob.oldLayout == vk::ImageLayout::eUndefined && transitionJob.newLayout == vk::ImageLayout::eTransferDstOptimal)
-	{
-		barrier.srcAccessMask = vk::AccessFlagBits::eNoneKHR;
-		barrier.dstAccessMask = vk::AccessFlagBits::eTransferWrite;
-
-		sourceStage = vk::PipelineStageFlagBits::eTopOfPipe;
-		destinationStage = vk::PipelineStageFlagBits::eTransfer;
-	}
-	else {
-		barrier.srcAccessMask = vk::AccessFlagBits::eTransferWrite;
-		barrier.dstAccessMask = vk::AccessFlagBits::eShaderRead;
-
-		sourceStage = vk::PipelineStageFlagBits::eTransfer;
-		destinationStage = vk::PipelineStageFlagBits::eFragmentShader;
-	}
-
-	transitionJob.commandBuffer.pipelineBarrier(sourceStage, destinationStage, vk::DependencyFlags(), nullptr, nullptr, barrier);
-
-	vkUtils::endJob(transitionJob.commandBuffer, transitionJob.queue);
-}
-
-void vkImage::copy_buffer_to_image(BufferImageCopyJob copyJob) {
-	vkUtils::startJob(copyJob.commandBuffer);
-
-	/*
-	typedef struct VkBufferImageCopy {
-		VkDeviceSize                bufferOffset;
-		uint32_t                    bufferRowLength;
-		uint32_t                    bufferImageHeight;
-		VkImageSubresourceLayers    imageSubresource;
-		VkOffset3D                  imageOffset;
-		VkExtent3D                  imageExtent;
-	} VkBufferImageCopy;
-	*/
-
-	vk::BufferImageCopy copy;
-	copy.bufferOffset = 0;
-	copy.bufferRowLength = 0;
-	copy.bufferImageHeight = 0;
-
-	vk::ImageSubresourceLayers access;
-	access.aspectMask = vk::ImageAspectFlagBits::eColor;
-	access.mipLevel = 0;
-	access.baseArrayLayer = 0;
-	access.layerCount = 1;
-	copy.imageSubresource = access;
-
-	copy.imageOffset = vk::Offset3D(0, 0, 0);
-	copy.imageExtent = vk::Extent3D(
-		copyJob.width,
-		copyJob.height,
-		1.0f
-	);
-
-	copyJob.commandBuffer.copyBufferToImage(copyJob.srcBuffer, copyJob.dstImage, vk::ImageLayout::eTransferDstOptimal, copy);
-
-	vkUtils::endJob(copyJob.commandBuffer, copyJob.queue);
+	return allocation;
 }
 
 vk::ImageView vkImage::make_image_view(vk::Device logicalDevice, vk::Image image, vk::Format format, vk::ImageAspectFlags aspect) {
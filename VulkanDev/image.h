@@ -1,6 +1,8 @@
 #pragma once
 #include "stb_image.h"
 #include "config.h"
+#include "transfer.h"
+#include "worker_pool.h"
 
 namespace vkImage {
 	/*
@@ -10,9 +12,10 @@ namespace vkImage {
 		vk::Device logicalDevice;
 		vk::PhysicalDevice physicalDevice;
 		const char* filename;
-		vk::CommandBuffer commandBuffer;
-		vk::Queue queue;
+		vkUtils::MemoryAllocator* allocator;
+		vkUtils::UploadBatch* uploadBatch;
 		vk::DescriptorSetLayout layout;
+		//null for bindless textures, which get no set of their own
 		vk::DescriptorPool descriptorPool;
 	};
 
@@ -28,44 +31,46 @@ namespace vkImage {
 		vk::ImageUsageFlags usage;
 		vk::MemoryPropertyFlags memoryProperties;
 		vk::Format format;
+		vkUtils::MemoryAllocator* allocator;
 	};
 
+	class Texture;
+
 	/*
-		For transitioning image layouts
-	*/
-	struct ImageLayoutTransitionJob {
-		vk::CommandBuffer commandBuffer;
-		vk::Queue queue;
-		vk::Image image;
-		vk::ImageLayout oldLayout, newLayout;
-	};
-	
-	/*
-		For coping a buffer to image
+		Load many textures at once. Files are decoded in parallel across the worker pool straight into
+		staging memory, and all of their copies are added to the input's upload batch.
+		\param input shared by every texture, the filename is ignored
+		\param filenames the images to load
+		\param workers the pool to decode on
+		\returns one texture per filename, in the same order
 	*/
-	struct BufferImageCopyJob {
-		vk::CommandBuffer commandBuffer;
-		vk::Queue queue;
-		vk::Buffer srcBuffer;
-		vk::Image dstImage;
-		int width, height;
-	};
+	std::vector<Texture*> load_textures(TextureInputChunk input, const std::vector<const char*>& filenames, vkUtils::WorkerPool* workers);
 
 	class Texture {
 	public:
-		Texture(TextureInputChunk input);
 		void use(vk::CommandBuffer commandBuffer, vk::PipelineLayout pipelineLayout);
+
+		/*
+			\returns the texture as a combined image sampler, for writing it into a bindless array
+		*/
+		vk::DescriptorImageInfo descriptor_info() const;
 		~Texture();
 	private:
+		friend std::vector<Texture*> load_textures(TextureInputChunk input, const std::vector<const char*>& filenames, vkUtils::WorkerPool* workers);
+
+		/*
+			Make the texture's resources for an image of known size, leaving its upload to the caller.
+		*/
+		Texture(TextureInputChunk input, int width, int height);
+
 		int width, height, channels;
 		vk::Device logicalDevice;
 		vk::PhysicalDevice physicalDevice;
 		const char* filename;
-		stbi_uc* pixels;
 
 		//Resources
 		vk::Image image;
-		vk::DeviceMemory imageMemory;
+		Allocation imageAllocation;
 		vk::ImageView imageView;
 		vk::Sampler sampler;
 
@@ -74,21 +79,15 @@ namespace vkImage {
 		vk::DescriptorSet descroptorSet;
 		vk::DescriptorPool descriptorPool;
 
-		vk::CommandBuffer commandBuffer;
-		vk::Queue queue;
-
-		/*
-			Load the raw image data from the internally set filepath.
-		*/
-		void load();
+		vkUtils::MemoryAllocator* allocator;
 
 		/*
-			Send loaded data to the image. The image must be loaded before calling
+			Make the image, view, sampler and descriptor set, the size must be known.
 		*/
-		void populate();
+		void make_resources();
 
 		/*
-			Create a view of the texture. The image must be populated before calling the function
+			Create a view of the texture. The image must be made before calling the function
 		*/
 		void make_view();
 
@@ -110,23 +109,9 @@ namespace vkImage {
 	vk::Image make_image(ImageInputChunk input);
 
 	/*
-		Allocate and bind the backing memory for a vulkan Image, this memory must be freed upon image destruction.
-	*/
-	vk::DeviceMemory make_image_memory(ImageInputChunk input, vk::Image image);
-
-	/*
-		Transition the layout of an image.
-		Currently supports:
-
-		undefined -> transfer_dst_optimal,
-		transfer_dst_optimal -> shader_read_only_optimal,
-	*/
-	void transition_image_layout(ImageLayoutTransitionJob transitionJob);
-
-	/*
-		Copy from a buffer to an image. Image must be in the transfer_dst_optimal layout.
+		Sub-allocate and bind the backing memory for a vulkan Image, this memory must be freed upon image destruction.
 	*/
-	void copy_buffer_to_image(BufferImageCopyJob copyJob);
+	Allocation make_image_memory(ImageInputChunk input, vk::Image image);
 
 	/*
 		Create a view of a vulkan image.
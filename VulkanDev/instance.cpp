@@ -67,7 +67,7 @@ bool vkInit::supported(std::vector<const char*>& extensions, std::vector<const c
 	return true;
 }
 
-vk::Instance vkInit::make_instance(bool debug, const char* applicationName) {
+vk::Instance vkInit::make_instance(bool debug, bool headless, const char* applicationName) {
 	if (debug) {
 		std::cout << "Making an instance...\n";
 	}
@@ -84,6 +84,14 @@ vk::Instance vkInit::make_instance(bool debug, const char* applicationName) {
 
 	version &= ~(0xFFFU);
 
+	//timeline semaphores are core from 1.2 onwards
+	if (version < VK_API_VERSION_1_2) {
+		if (debug) {
+			std::cout << "Vulkan 1.2 is required!\n";
+		}
+		return nullptr;
+	}
+
 	vk::ApplicationInfo appInfo = vk::ApplicationInfo(
 		applicationName,
 		version,
@@ -91,11 +99,16 @@ vk::Instance vkInit::make_instance(bool debug, const char* applicationName) {
 		version,
 		version
 	);
-	uint32_t glfwExtensionCount = 0;
-	const char** glfwExtensions;
-	glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
+	std::vector<const char*> extensions;
+
+	//a headless instance never makes a surface, so glfw isn't needed
+	if (!headless) {
+		uint32_t glfwExtensionCount = 0;
+		const char** glfwExtensions;
+		glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
 
-	std::vector<const char*> extensions(glfwExtensions, glfwExtensions + glfwExtensionCount);
+		extensions.assign(glfwExtensions, glfwExtensions + glfwExtensionCount);
+	}
 
 	if (debug) {
 		extensions.push_back("VK_EXT_debug_utils");
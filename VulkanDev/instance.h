@@ -6,5 +6,5 @@ namespace vkInit {
 	
 	bool supported(std::vector<const char*>& extensions, std::vector<const char*>& layers, bool debug);
 
-	vk::Instance make_instance(bool debug, const char* applicationName);
+	vk::Instance make_instance(bool debug, bool headless, const char* applicationName);
 }
@@ -1,9 +1,134 @@
 #include "app.h"
+#include "transform_store.h"
+#include "scene.h"
+#include "vertex_menagerie.h"
+#include <cctype>
+#include <cerrno>
+#include <cstring>
 
-int main() {
-	App* myApp = new App(640, 480, true);
+namespace {
+	/*
+		Parse a count from the command line, digits only
+		\returns whether it was one, the value is unchanged otherwise
+	*/
+	bool parse_count(const char* text, size_t& value) {
+		if (!std::isdigit(static_cast<unsigned char>(text[0]))) {
+			return false;
+		}
+		char* end = nullptr;
+		errno = 0;
+		unsigned long long parsed = std::strtoull(text, &end, 10);
+		if (*end != '\0' || errno == ERANGE || parsed > SIZE_MAX) {
+			return false;
+		}
+		value = static_cast<size_t>(parsed);
+		return true;
+	}
 
-	myApp->run();
+	//whether the argument after a flag is a value for it rather than the next flag
+	bool has_value(int argc, char** argv, int i) {
+		return i + 1 < argc && strncmp(argv[i + 1], "--", 2) != 0;
+	}
+}
+
+int main(int argc, char** argv) {
+	bool headless = false;
+	int frameCount = 0;
+	double targetSeconds = 0.0;
+	const char* sceneFile = nullptr;
+	EngineOptions options;
+
+	for (int i = 1; i < argc; i++)
+	{
+		std::string arg = argv[i];
+		if (arg == "--headless") {
+			headless = true;
+		}
+		else if (arg == "--frames" && i + 1 < argc) {
+			frameCount = std::atoi(argv[++i]);
+		}
+		else if (arg == "--seconds" && i + 1 < argc) {
+			targetSeconds = std::atof(argv[++i]);
+		}
+		else if (arg == "--frames-in-flight" && i + 1 < argc) {
+			options.framesInFlight = std::atoi(argv[++i]);
+		}
+		else if (arg == "--instance-capacity" && i + 1 < argc) {
+			if (!parse_count(argv[++i], options.instanceCapacity)) {
+				std::cout << "Invalid instance capacity " << argv[i] << ", keeping the default" << std::endl;
+			}
+		}
+		else if (arg == "--gpu-culling") {
+			options.gpuCulling = true;
+		}
+		else if (arg == "--bindless") {
+			options.bindless = true;
+		}
+		else if (arg == "--scene" && i + 1 < argc) {
+			sceneFile = argv[++i];
+		}
+		else if (arg == "--mesh-archive" && i + 1 < argc) {
+			options.meshArchive = argv[++i];
+		}
+		else if (arg == "--vertex-layout" && i + 1 < argc) {
+			if (!vkMesh::VertexLayout::parse(argv[++i], options.vertexLayout)) {
+				std::cout << "Unknown vertex layout " << argv[i] << ", keeping the default" << std::endl;
+			}
+		}
+		else if (arg == "--optimize-meshes") {
+			options.optimizeMeshes = true;
+		}
+		else if (arg == "--meshlets") {
+			options.meshletCulling = true;
+		}
+		else if (arg == "--lod-error" && i + 1 < argc) {
+			options.lodErrorPixels = static_cast<float>(std::atof(argv[++i]));
+		}
+		else if (arg == "--write-mesh-archive" && i + 1 < argc) {
+			//runs on the CPU only, writes the built in meshes in the vertex layout given before it, optimized if asked before it
+			return write_default_mesh_archive(argv[++i], options.vertexLayout, options.optimizeMeshes) ? 0 : 1;
+		}
+		else if (arg == "--write-scene" && i + 1 < argc) {
+			//runs on the CPU only, without an instance count it writes the built in scene
+			const char* filename = argv[++i];
+			size_t sceneInstances = 0;
+			if (has_value(argc, argv, i) && !parse_count(argv[++i], sceneInstances)) {
+				std::cout << "Invalid instance count " << argv[i] << std::endl;
+				return 1;
+			}
+			return write_procedural_scene(filename, sceneInstances) ? 0 : 1;
+		}
+		else if (arg == "--transform-benchmark") {
+			//runs on the CPU only, no window or device needed
+			size_t benchmarkInstances = 1000000;
+			if (has_value(argc, argv, i) && !parse_count(argv[++i], benchmarkInstances)) {
+				std::cout << "Invalid instance count " << argv[i] << std::endl;
+				return 1;
+			}
+			benchmark_transforms(benchmarkInstances);
+			return 0;
+		}
+	}
+
+	App* myApp;
+	try {
+		myApp = new App(640, 480, headless, sceneFile, options);
+	}
+	catch (const std::runtime_error& error) {
+		std::cout << error.what() << std::endl;
+		return 1;
+	}
+
+	if (headless) {
+		//without any limit a headless run would never end
+		if (frameCount <= 0 && targetSeconds <= 0.0) {
+			frameCount = 1000;
+		}
+		myApp->run_headless(frameCount, targetSeconds);
+	}
+	else {
+		myApp->run();
+	}
 	delete myApp;
 	
 	return 0;
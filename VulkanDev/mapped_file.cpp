@@ -0,0 +1,168 @@
+#include "mapped_file.h"
+#include <cstring>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+vkUtils::MappedFile::~MappedFile() {
+	close();
+}
+
+vkUtils::MappedFile::MappedFile(MappedFile&& other) noexcept {
+	*this = std::move(other);
+}
+
+vkUtils::MappedFile& vkUtils::MappedFile::operator=(MappedFile&& other) noexcept {
+	if (this != &other) {
+		close();
+		mapping = other.mapping;
+		length = other.length;
+		other.mapping = nullptr;
+		other.length = 0;
+	}
+	return *this;
+}
+
+#ifdef _WIN32
+
+bool vkUtils::MappedFile::open(const char* filename) {
+	close();
+
+	HANDLE file = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (file == INVALID_HANDLE_VALUE) {
+		return false;
+	}
+
+	LARGE_INTEGER fileSize;
+	if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0) {
+		CloseHandle(file);
+		return false;
+	}
+
+	//the view keeps the file open, so neither handle is needed once it exists
+	HANDLE fileMapping = CreateFileMappingA(file, nullptr, PAGE_WRITECOPY, 0, 0, nullptr);
+	CloseHandle(file);
+	if (!fileMapping) {
+		return false;
+	}
+	void* view = MapViewOfFile(fileMapping, FILE_MAP_COPY, 0, 0, 0);
+	CloseHandle(fileMapping);
+	if (!view) {
+		return false;
+	}
+
+	mapping = static_cast<uint8_t*>(view);
+	length = static_cast<size_t>(fileSize.QuadPart);
+
+	WIN32_MEMORY_RANGE_ENTRY range;
+	range.VirtualAddress = mapping;
+	range.NumberOfBytes = length;
+	PrefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0);
+	return true;
+}
+
+void vkUtils::MappedFile::close() {
+	if (mapping) {
+		UnmapViewOfFile(mapping);
+	}
+	mapping = nullptr;
+	length = 0;
+}
+
+#else
+
+bool vkUtils::MappedFile::open(const char* filename) {
+	close();
+
+	int file = ::open(filename, O_RDONLY);
+	if (file < 0) {
+		return false;
+	}
+
+	struct stat status;
+	if (fstat(file, &status) != 0 || status.st_size == 0) {
+		::close(file);
+		return false;
+	}
+
+	//the mapping keeps the file open
+	void* view = mmap(nullptr, static_cast<size_t>(status.st_size), PROT_READ | PROT_WRITE, MAP_PRIVATE, file, 0);
+	::close(file);
+	if (view == MAP_FAILED) {
+		return false;
+	}
+
+	mapping = static_cast<uint8_t*>(view);
+	length = static_cast<size_t>(status.st_size);
+	madvise(mapping, length, MADV_WILLNEED);
+	return true;
+}
+
+void vkUtils::MappedFile::close() {
+	if (mapping) {
+		munmap(mapping, length);
+	}
+	mapping = nullptr;
+	length = 0;
+}
+
+#endif
+
+uint8_t* vkUtils::MappedFile::data() const {
+	return mapping;
+}
+
+size_t vkUtils::MappedFile::size() const {
+	return length;
+}
+
+bool vkUtils::little_endian() {
+	uint32_t value = 1;
+	uint8_t firstByte;
+	memcpy(&firstByte, &value, 1);
+	return firstByte == 1;
+}
+
+bool vkUtils::blob_fits(uint64_t offset, uint64_t count, uint64_t elementSize, uint64_t fileSize, uint64_t alignment) {
+	return count <= fileSize / elementSize && offset % alignment == 0 && offset <= fileSize - count * elementSize;
+}
+
+bool vkUtils::write_blobs(const char* filename, const std::vector<FileBlob>& blobs, uint64_t fileSize) {
+	std::ofstream file(filename, std::ios::binary);
+	if (!file) {
+		std::cout << "Failed to open " << filename << " for writing" << std::endl;
+		return false;
+	}
+
+	uint64_t written = 0;
+	auto pad = [&](uint64_t target) {
+		static const char zeros[256] = {};
+		while (written < target) {
+			uint64_t size = std::min<uint64_t>(target - written, sizeof(zeros));
+			file.write(zeros, static_cast<std::streamsize>(size));
+			written += size;
+		}
+	};
+
+	for (const FileBlob& blob : blobs) {
+		pad(blob.offset);
+		file.write(static_cast<const char*>(blob.data), static_cast<std::streamsize>(blob.size));
+		written += blob.size;
+	}
+	pad(fileSize);
+
+	file.close();
+	if (!file) {
+		std::cout << "Failed to write " << filename << std::endl;
+		return false;
+	}
+	return true;
+}
\ No newline at end of file
@@ -0,0 +1,93 @@
+#pragma once
+#include "config.h"
+#include <cstring>
+
+namespace vkUtils {
+
+	/**
+		A whole file mapped into memory copy-on-write: the mapping can be written to,
+		but the writes go to private pages and never reach the file.
+	*/
+	class MappedFile {
+	public:
+		MappedFile() = default;
+		~MappedFile();
+
+		MappedFile(MappedFile&& other) noexcept;
+		MappedFile& operator=(MappedFile&& other) noexcept;
+		MappedFile(const MappedFile&) = delete;
+		MappedFile& operator=(const MappedFile&) = delete;
+
+		/*
+			Map a file, closing whatever was mapped before. Reading ahead starts right away,
+			pages come in as they're touched.
+			\returns whether the file could be mapped, empty files can't be
+		*/
+		bool open(const char* filename);
+
+		void close();
+
+		uint8_t* data() const;
+		size_t size() const;
+
+	private:
+		uint8_t* mapping{ nullptr };
+		size_t length{ 0 };
+	};
+
+	/*
+		\returns whether this machine is little endian, the byte order files are written to be mapped in
+	*/
+	bool little_endian();
+
+	/*
+		Copy the header out of a mapped file and check what the headers of files laid out for mapping start with:
+		magic, formatVersion, byteOrder and fileSize. Nothing may point into the file until the rest of the header
+		has been checked against fileSize too.
+		\param kind what the file should be, for saying why it's refused
+		\returns whether the file holds a header of that kind, version and byte order, and is no shorter than it says
+	*/
+	template<typename Header>
+	bool read_file_header(const MappedFile& file, const char* filename, const char* kind,
+		const char (&magic)[8], uint32_t version, uint32_t byteOrder, Header& header) {
+		if (file.size() < sizeof(header)) {
+			std::cout << filename << " is too small to be a " << kind << std::endl;
+			return false;
+		}
+		memcpy(&header, file.data(), sizeof(header));
+		if (memcmp(header.magic, magic, sizeof(header.magic)) != 0 || header.formatVersion != version) {
+			std::cout << filename << " is not a version " << version << " " << kind << std::endl;
+			return false;
+		}
+		if (header.byteOrder != byteOrder) {
+			std::cout << filename << " was written in another byte order" << std::endl;
+			return false;
+		}
+		if (header.fileSize > file.size()) {
+			std::cout << filename << " is truncated" << std::endl;
+			return false;
+		}
+		return true;
+	}
+
+	/*
+		\returns whether count elements of elementSize bytes, from an aligned offset, fit in fileSize bytes
+	*/
+	bool blob_fits(uint64_t offset, uint64_t count, uint64_t elementSize, uint64_t fileSize, uint64_t alignment);
+
+	/*
+		A run of bytes to write at an offset into a file
+	*/
+	struct FileBlob {
+		uint64_t offset;
+		const void* data;
+		uint64_t size;
+	};
+
+	/*
+		Write a file laid out for mapping, zero filling before each blob and after the last one up to fileSize
+		\param blobs in order of offset, without overlaps
+		\returns whether the whole file was written
+	*/
+	bool write_blobs(const char* filename, const std::vector<FileBlob>& blobs, uint64_t fileSize);
+}
\ No newline at end of file
@@ -1,4 +1,5 @@
 #include "memory.h"
+#include "allocator.h"
 
 uint32_t vkUtils::findMemoryTypeIndex(vk::PhysicalDevice physicalDevice, uint32_t supportedMemoryIndices, vk::MemoryPropertyFlags requestedProperties) {
 	/*
@@ -41,22 +42,13 @@ void vkUtils::allocateBufferMemory(Buffer& buffer, const BufferInputChunk& input
 
 	vk::MemoryRequirements memoryRequirements = input.logicalDevice.getBufferMemoryRequirements(buffer.buffer);
 
-
-	/*
-		* // Provided by VK_VERSION_1_0
-		typedef struct VkMemoryAllocateInfo {
-			VkStructureType    sType;
-			const void*        pNext;
-			VkDeviceSize       allocationSize;
-			uint32_t           memoryTypeIndex;
-		} VkMemoryAllocateInfo;
-	*/
-
-	vk::MemoryAllocateInfo allocInfo;
-	allocInfo.allocationSize = memoryRequirements.size;
-	allocInfo.memoryTypeIndex = findMemoryTypeIndex(input.physicalDevice, memoryRequirements.memoryTypeBits, input.memoryProperties);
-	buffer.bufferMemory = input.logicalDevice.allocateMemory(allocInfo);
-	input.logicalDevice.bindBufferMemory(buffer.buffer, buffer.bufferMemory, 0);
+	buffer.allocation = input.allocator->allocate(memoryRequirements, input.memoryProperties, true);
+	//fail the way allocateMemory would have, rather than bind a null handle
+	if (!buffer.allocation.memory) {
+		input.logicalDevice.destroyBuffer(buffer.buffer);
+		throw vk::OutOfDeviceMemoryError("Unable to allocate memory for buffer");
+	}
+	input.logicalDevice.bindBufferMemory(buffer.buffer, buffer.allocation.memory, buffer.allocation.offset);
 }
 
 Buffer vkUtils::createBuffer(BufferInputChunk input) {
@@ -88,35 +80,8 @@ Buffer vkUtils::createBuffer(BufferInputChunk input) {
 	return buffer;
 }
 
-
-void vkUtils::copyBuffer(Buffer& srcBuffer, Buffer& dstBuffer, vk::DeviceSize size, vk::Queue queue, vk::CommandBuffer commandBuffer) {
-	commandBuffer.reset();
-
-	vk::CommandBufferBeginInfo beginInfo;
-	beginInfo.flags = vk::CommandBufferUsageFlagBits::eOneTimeSubmit;
-	commandBuffer.begin(beginInfo);
-	/*
-	* // Provided by VK_VERSION_1_0
-	typedef struct VkBufferCopy {
-		VkDeviceSize    srcOffset;
-		VkDeviceSize    dstOffset;
-		VkDeviceSize    size;
-	} VkBufferCopy;
-	*/
-
-	vk::BufferCopy copyRegion;
-	copyRegion.srcOffset = 0;
-	copyRegion.dstOffset = 0;
-	copyRegion.size = size;
-	commandBuffer.copyBuffer(srcBuffer.buffer, dstBuffer.buffer, 1, &copyRegion);
-
-	commandBuffer.end();
-
-	vk::SubmitInfo submitInfo;
-	submitInfo.commandBufferCount = 1;
-	submitInfo.pCommandBuffers = &commandBuffer;
-
-	queue.submit(1, &submitInfo, nullptr);
-
-	queue.waitIdle();
+void vkUtils::destroyBuffer(vk::Device logicalDevice, MemoryAllocator* allocator, Buffer& buffer) {
+	logicalDevice.destroyBuffer(buffer.buffer);
+	allocator->free(buffer.allocation);
+	buffer.buffer = nullptr;
 }
\ No newline at end of file
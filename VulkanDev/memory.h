@@ -16,7 +16,7 @@ namespace vkUtils {
 	);
 
 	/*
-		Allocate a memory block for the given buffer
+		Sub-allocate and bind memory for the given buffer
 
 		\param buffer the buffer to allocate memory for
 		\param input holds various parameters
@@ -32,12 +32,7 @@ namespace vkUtils {
 	Buffer createBuffer(BufferInputChunk input);
 
 	/*
-		Copy a buffer.
-		\param srcBuffer the buffer to copy from
-		\param dstBuffer the buffer to copy to
-		\param size the size (in bytes) to copy
-		\param queue on which to submit the job
-		\param commandBuffer the command buffer on which to record the job
+		Destroy a buffer and return its memory to the allocator.
 	*/
-	void copyBuffer(Buffer& srcBuffer, Buffer& dstBuffer, vk::DeviceSize size, vk::Queue queue, vk::CommandBuffer commandBuffer);
+	void destroyBuffer(vk::Device logicalDevice, MemoryAllocator* allocator, Buffer& buffer);
 }
\ No newline at end of file
@@ -1,11 +1,12 @@
 #pragma once
 #include "config.h"
+#include "vertex_layout.h"
 
 namespace vkMesh {
 	/*
-		\returns the input binding description for a (vec2 pos, vec3 color) vertex format.
+		\returns the input binding description for a (vec2 pos, vec3 color, vec2 texCoord) vertex format stored in the layout.
 	*/
-	vk::VertexInputBindingDescription getPosColorBindingDescription() {
+	vk::VertexInputBindingDescription getPosColorBindingDescription(const VertexLayout& layout) {
 		/* Provided by VK_VERSION_1_0
 		typedef struct VkVertexInputBindingDescription {
 			uint32_t             binding;
@@ -16,17 +17,18 @@ namespace vkMesh {
 
 		vk::VertexInputBindingDescription bindingDescription;
 		bindingDescription.binding = 0;
-		bindingDescription.stride = 7 * sizeof(float);
+		bindingDescription.stride = layout.stride();
 		bindingDescription.inputRate = vk::VertexInputRate::eVertex;
 
 		return bindingDescription;
 	}
 
 	/*
-		\returns the input attribute descriptions for a (vec2 pos, vec3 color) vertex format. 
+		\returns the input attribute descriptions for a (vec2 pos, vec3 color, vec2 texCoord) vertex format stored in the layout,
+		vertex fetch turns quantized attributes back into floats.
 	*/
 
-	std::array<vk::VertexInputAttributeDescription, 3> getPosColorAttributeDescription() {
+	std::array<vk::VertexInputAttributeDescription, 3> getPosColorAttributeDescription(const VertexLayout& layout) {
 		/* Provided by VK_VERSION_1_0
 			typedef struct VkVertexInputAttributeDescription {
 				uint32_t    location;
@@ -41,20 +43,20 @@ namespace vkMesh {
 		//Pos
 		attributes[0].binding = 0;
 		attributes[0].location = 0;
-		attributes[0].format = vk::Format::eR32G32Sfloat;
-		attributes[0].offset = 0;
+		attributes[0].format = layout.position_format();
+		attributes[0].offset = layout.position_offset();
 
 		//Color
 		attributes[1].binding = 0;
 		attributes[1].location = 1;
-		attributes[1].format = vk::Format::eR32G32B32Sfloat;
-		attributes[1].offset = 2 * sizeof(float);
+		attributes[1].format = layout.color_format();
+		attributes[1].offset = layout.color_offset();
 
 		//TexCoord
 		attributes[2].binding = 0;
 		attributes[2].location = 2;
-		attributes[2].format = vk::Format::eR32G32Sfloat;
-		attributes[2].offset = 5 * sizeof(float);
+		attributes[2].format = layout.tex_coord_format();
+		attributes[2].offset = layout.tex_coord_offset();
 
 		return attributes;
 
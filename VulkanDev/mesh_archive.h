@@ -0,0 +1,69 @@
+#pragma once
+#include "config.h"
+#include "mesh_registry.h"
+
+/*
+	Mesh archives are built offline and little endian, laid out to be staged straight from the mapped file:
+
+	MeshArchiveHeader
+	MeshArchiveEntry[meshCount], from meshesOffset
+	vertexCount vertices of vertexStride bytes in the archive's vertex layout, from verticesOffset
+	uint16_t[index16Count], from indices16Offset
+	uint32_t[index32Count], from indices32Offset
+	vkMesh::Meshlet[meshletCount], from meshletsOffset
+
+	Indices start from 0 for every mesh, which is drawn with its vertexOffset as the base vertex.
+
+	Every offset is from the start of the file and a multiple of meshArchiveAlignment.
+*/
+
+constexpr char meshArchiveMagic[8] = "VDMESH";
+//bumped whenever the layout changes, archives of any other version are refused
+constexpr uint32_t meshArchiveVersion = 5;
+//reads back as written only on a machine of the same byte order
+constexpr uint32_t meshArchiveByteOrder = 0x01020304;
+constexpr uint64_t meshArchiveAlignment = 64;
+
+struct MeshArchiveHeader {
+	char magic[8];
+	uint32_t formatVersion;
+	uint32_t byteOrder;
+	uint64_t fileSize;
+	//bytes per vertex and vkMesh::VertexLayout::key, archives of another layout are refused
+	uint32_t vertexStride;
+	uint32_t vertexLayout;
+	uint32_t meshCount;
+	uint32_t reserved;
+	uint64_t vertexCount;
+	uint64_t index16Count;
+	uint64_t index32Count;
+	uint64_t meshesOffset;
+	uint64_t verticesOffset;
+	uint64_t indices16Offset;
+	uint64_t indices32Offset;
+	uint64_t meshletCount;
+	uint64_t meshletsOffset;
+};
+
+/*
+	A MeshRange with its name, without the material pointer
+*/
+struct MeshArchiveEntry {
+	//null terminated, the name the mesh is registered under
+	char name[48];
+	//2 or 4, the mesh's indices are in that blob
+	uint32_t indexSize;
+	uint32_t firstIndex;
+	uint32_t indexCount;
+	int32_t vertexOffset;
+	float boundingRadius;
+	uint32_t materialId;
+	uint32_t firstMeshlet;
+	uint32_t meshletCount;
+	//levels of detail in the same blob as the full mesh
+	uint32_t lodCount;
+	MeshLod lods[maxMeshLods];
+};
+
+static_assert(sizeof(MeshArchiveHeader) == 112, "mesh archive header layout changed");
+static_assert(sizeof(MeshArchiveEntry) == 180, "mesh archive entry layout changed");
\ No newline at end of file
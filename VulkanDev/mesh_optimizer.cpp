@@ -0,0 +1,206 @@
+#include "mesh_optimizer.h"
+
+vkMesh::VertexCacheStats vkMesh::analyze_vertex_cache(const std::vector<uint32_t>& indices, size_t vertexCount, uint32_t cacheSize) {
+	//a vertex is cached while fewer than cacheSize misses have come after its own
+	std::vector<uint64_t> cacheTime(vertexCount, 0);
+	uint64_t time = uint64_t(cacheSize) + 1;
+	size_t misses = 0;
+	for (uint32_t index : indices) {
+		if (time - cacheTime[index] > cacheSize) {
+			cacheTime[index] = time++;
+			++misses;
+		}
+	}
+
+	VertexCacheStats stats;
+	stats.acmr = indices.size() >= 3 ? static_cast<float>(misses) / static_cast<float>(indices.size() / 3) : 0.0f;
+	stats.atvr = vertexCount ? static_cast<float>(misses) / static_cast<float>(vertexCount) : 0.0f;
+	return stats;
+}
+
+void vkMesh::optimize_vertex_cache(std::vector<uint32_t>& indices, size_t vertexCount, uint32_t cacheSize, std::vector<uint32_t>* clusters) {
+	if (clusters) {
+		clusters->clear();
+	}
+	size_t triangleCount = indices.size() / 3;
+	if (triangleCount == 0) {
+		return;
+	}
+
+	//the triangles around each vertex, and how many of them are still to be emitted
+	std::vector<uint32_t> live(vertexCount, 0);
+	for (size_t i = 0; i < 3 * triangleCount; ++i) {
+		++live[indices[i]];
+	}
+	std::vector<uint32_t> offsets(vertexCount + 1, 0);
+	for (size_t v = 0; v < vertexCount; ++v) {
+		offsets[v + 1] = offsets[v] + live[v];
+	}
+	std::vector<uint32_t> adjacency(3 * triangleCount);
+	std::vector<uint32_t> filled(offsets.begin(), offsets.end() - 1);
+	for (size_t i = 0; i < 3 * triangleCount; ++i) {
+		adjacency[filled[indices[i]]++] = static_cast<uint32_t>(i / 3);
+	}
+
+	std::vector<uint64_t> cacheTime(vertexCount, 0);
+	uint64_t time = uint64_t(cacheSize) + 1;
+	std::vector<uint8_t> emitted(triangleCount, 0);
+	std::vector<uint32_t> deadEnd, candidates, output;
+	deadEnd.reserve(3 * triangleCount);
+	output.reserve(3 * triangleCount);
+	size_t cursor = 0;
+
+	//the most recently used vertex with triangles left, or else the next one in input order
+	auto skip_dead_end = [&]() -> int64_t {
+		while (!deadEnd.empty()) {
+			uint32_t vertex = deadEnd.back();
+			deadEnd.pop_back();
+			if (live[vertex] > 0) {
+				return vertex;
+			}
+		}
+		for (; cursor < vertexCount; ++cursor) {
+			if (live[cursor] > 0) {
+				return static_cast<int64_t>(cursor);
+			}
+		}
+		return -1;
+	};
+
+	int64_t fanning = skip_dead_end();
+	bool fromDeadEnd = true;
+	while (fanning >= 0) {
+		if (fromDeadEnd && clusters) {
+			clusters->push_back(static_cast<uint32_t>(output.size() / 3));
+		}
+
+		//emit every triangle left around the fanning vertex
+		candidates.clear();
+		for (uint32_t a = offsets[fanning]; a < offsets[fanning + 1]; ++a) {
+			uint32_t triangle = adjacency[a];
+			if (emitted[triangle]) {
+				continue;
+			}
+			for (int corner = 0; corner < 3; ++corner) {
+				uint32_t vertex = indices[3 * triangle + corner];
+				output.push_back(vertex);
+				deadEnd.push_back(vertex);
+				candidates.push_back(vertex);
+				--live[vertex];
+				if (time - cacheTime[vertex] > cacheSize) {
+					cacheTime[vertex] = time++;
+				}
+			}
+			emitted[triangle] = 1;
+		}
+
+		//fan next around the candidate which will have been in the cache longest without falling out
+		//once its remaining triangles are emitted, candidates which would fall out are a last resort
+		int64_t best = -1, bestPriority = -1;
+		for (uint32_t vertex : candidates) {
+			if (live[vertex] == 0) {
+				continue;
+			}
+			int64_t priority = 0;
+			int64_t age = static_cast<int64_t>(time - cacheTime[vertex]);
+			if (age + 2 * static_cast<int64_t>(live[vertex]) <= cacheSize) {
+				priority = age;
+			}
+			if (priority > bestPriority) {
+				best = vertex;
+				bestPriority = priority;
+			}
+		}
+
+		fromDeadEnd = best < 0;
+		fanning = fromDeadEnd ? skip_dead_end() : best;
+	}
+
+	indices.swap(output);
+}
+
+void vkMesh::optimize_overdraw(std::vector<uint32_t>& indices, const std::vector<uint32_t>& clusters,
+	const float* positions, uint32_t positionComponents, size_t stride) {
+	size_t triangleCount = indices.size() / 3;
+	if (clusters.size() < 2) {
+		return;
+	}
+
+	auto position = [&](uint32_t vertex) {
+		const float* p = positions + vertex * stride;
+		return glm::vec3(p[0], p[1], positionComponents > 2 ? p[2] : 0.0f);
+	};
+
+	//area weighted centers and summed normals of the clusters, and of the whole mesh
+	size_t clusterCount = clusters.size();
+	std::vector<glm::vec3> centers(clusterCount, glm::vec3(0.0f)), normals(clusterCount, glm::vec3(0.0f));
+	std::vector<float> areas(clusterCount, 0.0f);
+	glm::vec3 meshCenter(0.0f);
+	float meshArea = 0.0f;
+	for (size_t c = 0; c < clusterCount; ++c) {
+		size_t last = c + 1 < clusterCount ? clusters[c + 1] : triangleCount;
+		for (size_t t = clusters[c]; t < last; ++t) {
+			glm::vec3 a = position(indices[3 * t]), b = position(indices[3 * t + 1]), d = position(indices[3 * t + 2]);
+			glm::vec3 normal = glm::cross(b - a, d - a);
+			float area = 0.5f * glm::length(normal);
+			centers[c] += (a + b + d) * (area / 3.0f);
+			normals[c] += normal;
+			areas[c] += area;
+		}
+		meshCenter += centers[c];
+		meshArea += areas[c];
+		if (areas[c] > 0.0f) {
+			centers[c] /= areas[c];
+		}
+	}
+	if (meshArea > 0.0f) {
+		meshCenter /= meshArea;
+	}
+
+	//clusters further out along their own normal are more likely to occlude the rest
+	std::vector<float> scores(clusterCount, 0.0f);
+	for (size_t c = 0; c < clusterCount; ++c) {
+		float length = glm::length(normals[c]);
+		if (length > 0.0f) {
+			scores[c] = glm::dot(centers[c] - meshCenter, normals[c] / length);
+		}
+	}
+	std::vector<uint32_t> order(clusterCount);
+	for (size_t c = 0; c < clusterCount; ++c) {
+		order[c] = static_cast<uint32_t>(c);
+	}
+	std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+		return scores[a] > scores[b];
+	});
+
+	std::vector<uint32_t> output;
+	output.reserve(indices.size());
+	for (uint32_t c : order) {
+		size_t last = c + 1 < clusterCount ? clusters[c + 1] : triangleCount;
+		output.insert(output.end(), indices.begin() + 3 * clusters[c], indices.begin() + 3 * last);
+	}
+	indices.swap(output);
+}
+
+size_t vkMesh::optimize_vertex_fetch(std::vector<float>& vertices, size_t stride, std::vector<uint32_t>& indices) {
+	size_t vertexCount = vertices.size() / stride;
+	const uint32_t unused = 0xFFFFFFFF;
+
+	std::vector<uint32_t> remap(vertexCount, unused);
+	uint32_t next = 0;
+	for (uint32_t& index : indices) {
+		if (remap[index] == unused) {
+			remap[index] = next++;
+		}
+		index = remap[index];
+	}
+
+	std::vector<float> reordered(next * stride);
+	for (size_t v = 0; v < vertexCount; ++v) {
+		if (remap[v] != unused) {
+			std::copy(vertices.begin() + v * stride, vertices.begin() + (v + 1) * stride, reordered.begin() + remap[v] * stride);
+		}
+	}
+	vertices.swap(reordered);
+	return next;
+}
\ No newline at end of file
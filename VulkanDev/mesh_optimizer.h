@@ -0,0 +1,48 @@
+#pragma once
+#include "config.h"
+
+namespace vkMesh {
+
+	/**
+		How well an index order uses a FIFO post-transform vertex cache
+	*/
+	struct VertexCacheStats {
+		//average cache misses per triangle, 0.5 at best for big regular meshes, 3 at worst
+		float acmr;
+		//average transforms per vertex, 1 at best
+		float atvr;
+	};
+
+	/*
+		Simulate a FIFO vertex cache over an index list.
+		\param vertexCount the number of vertices the indices reach, unreferenced ones count against the ATVR
+	*/
+	VertexCacheStats analyze_vertex_cache(const std::vector<uint32_t>& indices, size_t vertexCount, uint32_t cacheSize);
+
+	/*
+		Reorder triangles for vertex cache reuse with Tipsify: fan around one vertex at a time,
+		moving on to the vertex most likely to still be in the cache.
+		\param clusters when not null, receives the first triangle of every run which started at a dead end,
+			where the cache had nothing left to offer, starting with 0
+	*/
+	void optimize_vertex_cache(std::vector<uint32_t>& indices, size_t vertexCount, uint32_t cacheSize, std::vector<uint32_t>* clusters);
+
+	/*
+		Reorder the clusters optimize_vertex_cache left, keeping the triangles within each in order,
+		so that clusters facing outwards from the mesh's center come first and hide what's behind them.
+		Meshes with 2D positions are flat, every cluster scores the same and the order is kept.
+		\param positions the first vertex's position
+		\param positionComponents 2 or 3, a missing z is 0
+		\param stride floats from one vertex's position to the next
+	*/
+	void optimize_overdraw(std::vector<uint32_t>& indices, const std::vector<uint32_t>& clusters,
+		const float* positions, uint32_t positionComponents, size_t stride);
+
+	/*
+		Renumber the vertices in the order the indices first use them and move them to match,
+		so vertex fetch walks forwards through memory. Unreferenced vertices are dropped.
+		\param vertices stride floats a vertex
+		\returns the number of vertices left
+	*/
+	size_t optimize_vertex_fetch(std::vector<float>& vertices, size_t stride, std::vector<uint32_t>& indices);
+}
\ No newline at end of file
@@ -0,0 +1,65 @@
+#include "mesh_registry.h"
+
+MeshHandle MeshRegistry::add(const std::string& name, const MeshRange& range) {
+	MeshHandle mesh;
+	if (freeSlots.empty()) {
+		if (ranges.size() >= maxMeshes) {
+			std::cout << "Can't register " << name << ", all " << maxMeshes << " mesh slots are in use" << std::endl;
+			return mesh;
+		}
+		mesh.index = static_cast<uint32_t>(ranges.size());
+		ranges.push_back(range);
+		//generations start at 1, so a default constructed handle is never live
+		generations.push_back(1);
+		names.push_back(name);
+	}
+	else {
+		mesh.index = freeSlots.back();
+		freeSlots.pop_back();
+		ranges[mesh.index] = range;
+		names[mesh.index] = name;
+	}
+	mesh.generation = generations[mesh.index];
+
+	handlesByName[name] = mesh;
+	return mesh;
+}
+
+void MeshRegistry::remove(MeshHandle mesh) {
+	if (!contains(mesh)) {
+		return;
+	}
+
+	handlesByName.erase(names[mesh.index]);
+	names[mesh.index].clear();
+	++generations[mesh.index];
+	freeSlots.push_back(mesh.index);
+}
+
+bool MeshRegistry::contains(MeshHandle mesh) const {
+	return mesh.index < generations.size() && generations[mesh.index] == mesh.generation;
+}
+
+const MeshRange& MeshRegistry::get(MeshHandle mesh) const {
+	return ranges[mesh.index];
+}
+
+MeshRange& MeshRegistry::get(MeshHandle mesh) {
+	return ranges[mesh.index];
+}
+
+MeshHandle MeshRegistry::find(const std::string& name) const {
+	auto found = handlesByName.find(name);
+	if (found == handlesByName.end()) {
+		return MeshHandle();
+	}
+	return found->second;
+}
+
+const std::string& MeshRegistry::name(MeshHandle mesh) const {
+	return names[mesh.index];
+}
+
+size_t MeshRegistry::size() const {
+	return ranges.size() - freeSlots.size();
+}
\ No newline at end of file
@@ -0,0 +1,97 @@
+#pragma once
+#include "config.h"
+
+namespace vkImage {
+	class Texture;
+}
+
+//levels of detail a mesh can have, the full one included, draw sort keys hold the level in 3 bits
+constexpr uint32_t maxMeshLods = 8;
+//live meshes and materials, draw sort keys hold a mesh's slot in 21 bits and its material in 16
+constexpr uint32_t maxMeshes = 1 << 21;
+constexpr uint32_t maxMaterials = 1 << 16;
+
+/**
+	One level of detail of a mesh, drawn with the mesh's vertices
+*/
+struct MeshLod {
+	//in indices of the mesh's type, from the start of that type's buffer
+	uint32_t firstIndex;
+	uint32_t indexCount;
+	//the furthest a vertex of the full mesh lies from its surface, in the mesh's units
+	float error;
+};
+
+/**
+	Where a mesh lives in the shared vertex and index buffers, and what it is drawn with
+*/
+struct MeshRange {
+	//indices are 16-bit when every vertex of the mesh can be reached with them, each type has its own buffer
+	vk::IndexType indexType;
+	//in indices of the mesh's type, from the start of that type's buffer
+	uint32_t firstIndex;
+	uint32_t indexCount;
+	//the mesh's first vertex, its indices start from 0
+	int32_t vertexOffset;
+	//radius of a sphere around the mesh's origin which holds all of its vertices
+	float boundingRadius;
+	//the mesh's meshlets, in the meshlet buffer
+	uint32_t firstMeshlet;
+	uint32_t meshletCount;
+	//lods[0] is the full mesh above, each level after it has about half the triangles of the one before
+	uint32_t lodCount;
+	MeshLod lods[maxMeshLods];
+	vkImage::Texture* material;
+	//the material's place in the engine's list, draws are sorted by it
+	uint32_t materialId;
+};
+
+/**
+	Hands out generational handles to meshes and keeps their ranges in a flat array indexed by handle,
+	so that a draw finds its mesh without hashing. Removing a mesh bumps the generation of its slot,
+	which invalidates every handle to it before the slot is reused.
+*/
+class MeshRegistry {
+public:
+	/*
+		\param name for looking the mesh up while loading content, names must be unique
+		\returns the new mesh's handle, or a handle which is never live once maxMeshes slots are in use
+	*/
+	MeshHandle add(const std::string& name, const MeshRange& range);
+
+	void remove(MeshHandle mesh);
+
+	/*
+		\returns whether the handle refers to a live mesh
+	*/
+	bool contains(MeshHandle mesh) const;
+
+	/*
+		\returns the mesh's range, the handle must be live
+	*/
+	const MeshRange& get(MeshHandle mesh) const;
+	MeshRange& get(MeshHandle mesh);
+
+	/*
+		Look a mesh up by name, this hashes so it's meant for loading rather than drawing.
+		\returns the mesh's handle, or an invalid handle if there is no such mesh
+	*/
+	MeshHandle find(const std::string& name) const;
+
+	/*
+		\returns the name the mesh was added with, the handle must be live
+	*/
+	const std::string& name(MeshHandle mesh) const;
+
+	/*
+		\returns the number of live meshes
+	*/
+	size_t size() const;
+
+private:
+	std::vector<MeshRange> ranges;
+	std::vector<uint32_t> generations;
+	std::vector<std::string> names;
+	std::vector<uint32_t> freeSlots;
+	std::unordered_map<std::string, MeshHandle> handlesByName;
+};
\ No newline at end of file
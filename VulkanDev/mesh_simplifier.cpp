@@ -0,0 +1,362 @@
+#include "mesh_simplifier.h"
+#include <limits>
+#include <numeric>
+#include <unordered_set>
+
+namespace {
+	/**
+		Weighted squared distances to a set of planes, as a symmetric 4x4 matrix
+	*/
+	struct Quadric {
+		double a00{ 0 }, a11{ 0 }, a22{ 0 }, a01{ 0 }, a02{ 0 }, a12{ 0 };
+		double b0{ 0 }, b1{ 0 }, b2{ 0 };
+		double c{ 0 };
+		double weight{ 0 };
+
+		void add_plane(const glm::dvec3& normal, double distance, double planeWeight) {
+			a00 += planeWeight * normal.x * normal.x;
+			a11 += planeWeight * normal.y * normal.y;
+			a22 += planeWeight * normal.z * normal.z;
+			a01 += planeWeight * normal.x * normal.y;
+			a02 += planeWeight * normal.x * normal.z;
+			a12 += planeWeight * normal.y * normal.z;
+			b0 += planeWeight * normal.x * distance;
+			b1 += planeWeight * normal.y * distance;
+			b2 += planeWeight * normal.z * distance;
+			c += planeWeight * distance * distance;
+			weight += planeWeight;
+		}
+
+		void add(const Quadric& other) {
+			a00 += other.a00;
+			a11 += other.a11;
+			a22 += other.a22;
+			a01 += other.a01;
+			a02 += other.a02;
+			a12 += other.a12;
+			b0 += other.b0;
+			b1 += other.b1;
+			b2 += other.b2;
+			c += other.c;
+			weight += other.weight;
+		}
+
+		/*
+			\returns the mean squared distance from a point to the planes
+		*/
+		double error(const glm::dvec3& p) const {
+			double sum = a00 * p.x * p.x + a11 * p.y * p.y + a22 * p.z * p.z
+				+ 2.0 * (a01 * p.x * p.y + a02 * p.x * p.z + a12 * p.y * p.z)
+				+ 2.0 * (b0 * p.x + b1 * p.y + b2 * p.z) + c;
+			return weight > 0.0 ? std::max(sum, 0.0) / weight : 0.0;
+		}
+	};
+
+	/**
+		Merge a vertex into a neighbour
+	*/
+	struct Collapse {
+		uint32_t from;
+		uint32_t to;
+		double error;
+	};
+
+	uint64_t edge_key(uint32_t a, uint32_t b) {
+		return (uint64_t(a) << 32) | b;
+	}
+
+	/*
+		\returns the distance from a point to the closest point of a triangle
+	*/
+	double triangle_distance(const glm::dvec3& p, const glm::dvec3& a, const glm::dvec3& b, const glm::dvec3& c) {
+		glm::dvec3 ab = b - a, ac = c - a, ap = p - a;
+		double d1 = glm::dot(ab, ap), d2 = glm::dot(ac, ap);
+		if (d1 <= 0.0 && d2 <= 0.0) {
+			return glm::length(ap);
+		}
+		glm::dvec3 bp = p - b;
+		double d3 = glm::dot(ab, bp), d4 = glm::dot(ac, bp);
+		if (d3 >= 0.0 && d4 <= d3) {
+			return glm::length(bp);
+		}
+		double vc = d1 * d4 - d3 * d2;
+		if (vc <= 0.0 && d1 >= 0.0 && d3 <= 0.0) {
+			return glm::length(p - (a + ab * (d1 / (d1 - d3))));
+		}
+		glm::dvec3 cp = p - c;
+		double d5 = glm::dot(ab, cp), d6 = glm::dot(ac, cp);
+		if (d6 >= 0.0 && d5 <= d6) {
+			return glm::length(cp);
+		}
+		double vb = d5 * d2 - d1 * d6;
+		if (vb <= 0.0 && d2 >= 0.0 && d6 <= 0.0) {
+			return glm::length(p - (a + ac * (d2 / (d2 - d6))));
+		}
+		double va = d3 * d6 - d5 * d4;
+		if (va <= 0.0 && d4 - d3 >= 0.0 && d5 - d6 >= 0.0) {
+			return glm::length(p - (b + (c - b) * ((d4 - d3) / ((d4 - d3) + (d5 - d6)))));
+		}
+		double denominator = va + vb + vc;
+		if (denominator == 0.0) {
+			//degenerate, the closest corner will do
+			return std::min({ glm::length(ap), glm::length(bp), glm::length(cp) });
+		}
+		return glm::length(p - (a + ab * (vb / denominator) + ac * (vc / denominator)));
+	}
+
+	/*
+		The furthest any vertex of the input lies from the simplified surface. A merged vertex is measured against
+		the triangles around the vertex it was merged into, or every triangle if none are left there, which bounds its distance.
+	*/
+	template <typename Position>
+	double surface_distance(const std::vector<uint32_t>& indices, const std::vector<uint32_t>& result,
+		const std::vector<uint32_t>& merged, const Position& position) {
+
+		std::vector<uint32_t> offsets(merged.size() + 1, 0);
+		for (uint32_t index : result) {
+			++offsets[index + 1];
+		}
+		for (size_t v = 0; v < merged.size(); ++v) {
+			offsets[v + 1] += offsets[v];
+		}
+		std::vector<uint32_t> filled(offsets.begin(), offsets.end() - 1), adjacency(result.size());
+		for (size_t i = 0; i < result.size(); ++i) {
+			adjacency[filled[result[i]]++] = static_cast<uint32_t>(i / 3);
+		}
+
+		auto distance_to = [&](const glm::dvec3& p, uint32_t triangle) {
+			return triangle_distance(p, position(result[3 * triangle]), position(result[3 * triangle + 1]), position(result[3 * triangle + 2]));
+		};
+
+		double worst = 0.0;
+		std::vector<uint8_t> measured(merged.size(), 0);
+		for (uint32_t vertex : indices) {
+			uint32_t target = merged[vertex];
+			bool kept = offsets[vertex + 1] > offsets[vertex];
+			if (measured[vertex] || kept) {
+				continue;
+			}
+			measured[vertex] = 1;
+
+			glm::dvec3 p = position(vertex);
+			double closest = std::numeric_limits<double>::max();
+			for (uint32_t i = offsets[target]; i < offsets[target + 1]; ++i) {
+				closest = std::min(closest, distance_to(p, adjacency[i]));
+			}
+			if (offsets[target] == offsets[target + 1]) {
+				for (uint32_t triangle = 0; triangle < result.size() / 3; ++triangle) {
+					closest = std::min(closest, distance_to(p, triangle));
+				}
+			}
+			if (closest != std::numeric_limits<double>::max()) {
+				worst = std::max(worst, closest);
+			}
+		}
+		return worst;
+	}
+
+	//border planes outweigh the surface, so borders give way last
+	constexpr double borderWeight = 10.0;
+}
+
+std::vector<uint32_t> vkMesh::simplify(const std::vector<uint32_t>& indices, const float* positions, uint32_t positionComponents,
+	size_t stride, size_t vertexCount, size_t targetIndexCount, float targetError, float* resultError) {
+
+	std::vector<uint32_t> result(indices.begin(), indices.begin() + indices.size() / 3 * 3);
+	if (resultError) {
+		*resultError = 0.0f;
+	}
+
+	auto position = [&](uint32_t vertex) {
+		const float* p = positions + vertex * stride;
+		return glm::dvec3(p[0], p[1], positionComponents > 2 ? p[2] : 0.0f);
+	};
+
+	//vertices split along a seam would tear apart if only one side moved
+	std::vector<uint8_t> locked(vertexCount, 0);
+	std::vector<uint32_t> order(vertexCount);
+	std::iota(order.begin(), order.end(), 0);
+	auto position_less = [&](uint32_t a, uint32_t b) {
+		glm::dvec3 pa = position(a), pb = position(b);
+		return pa.x < pb.x || (pa.x == pb.x && (pa.y < pb.y || (pa.y == pb.y && pa.z < pb.z)));
+	};
+	std::sort(order.begin(), order.end(), position_less);
+	for (size_t i = 1; i < vertexCount; ++i) {
+		if (position(order[i - 1]) == position(order[i])) {
+			locked[order[i - 1]] = locked[order[i]] = 1;
+		}
+	}
+
+	//an edge is on a border when no triangle runs along it the other way
+	std::unordered_set<uint64_t> edges;
+	auto find_edges = [&]() {
+		edges.clear();
+		for (size_t i = 0; i < result.size(); i += 3) {
+			for (int k = 0; k < 3; ++k) {
+				edges.insert(edge_key(result[i + k], result[i + (k + 1) % 3]));
+			}
+		}
+	};
+	find_edges();
+
+	//the planes of the triangles around each vertex, weighted by area, and of the borders through it
+	std::vector<Quadric> quadrics(vertexCount);
+	for (size_t i = 0; i < result.size(); i += 3) {
+		glm::dvec3 p[3] = { position(result[i]), position(result[i + 1]), position(result[i + 2]) };
+		glm::dvec3 normal = glm::cross(p[2] - p[0], p[1] - p[0]);
+		double length = glm::length(normal);
+		if (length == 0.0) {
+			continue;
+		}
+		normal /= length;
+		for (int k = 0; k < 3; ++k) {
+			quadrics[result[i + k]].add_plane(normal, -glm::dot(normal, p[0]), 0.5 * length);
+		}
+
+		for (int k = 0; k < 3; ++k) {
+			uint32_t a = result[i + k], b = result[i + (k + 1) % 3];
+			if (edges.count(edge_key(b, a))) {
+				continue;
+			}
+			glm::dvec3 edge = p[(k + 1) % 3] - p[k];
+			glm::dvec3 borderNormal = glm::cross(edge, normal);
+			double edgeLength = glm::length(borderNormal);
+			if (edgeLength == 0.0) {
+				continue;
+			}
+			borderNormal /= edgeLength;
+			double distance = -glm::dot(borderNormal, p[k]);
+			quadrics[a].add_plane(borderNormal, distance, borderWeight * edgeLength * edgeLength);
+			quadrics[b].add_plane(borderNormal, distance, borderWeight * edgeLength * edgeLength);
+		}
+	}
+
+	double maxError = double(targetError) * double(targetError);
+	std::vector<uint8_t> border(vertexCount), touched(vertexCount);
+	//the vertex each input vertex was merged into, through every pass
+	std::vector<uint32_t> merged(vertexCount);
+	std::iota(merged.begin(), merged.end(), 0);
+	std::vector<uint32_t> remap(vertexCount), offsets(vertexCount + 1), filled, adjacency;
+	std::vector<Collapse> collapses;
+
+	//each pass collapses the cheapest edges it can, at most one per vertex, then drops the triangles they closed
+	while (result.size() > targetIndexCount) {
+		size_t triangleCount = result.size() / 3;
+
+		std::fill(offsets.begin(), offsets.end(), 0);
+		for (uint32_t index : result) {
+			++offsets[index + 1];
+		}
+		for (size_t v = 0; v < vertexCount; ++v) {
+			offsets[v + 1] += offsets[v];
+		}
+		filled.assign(offsets.begin(), offsets.end() - 1);
+		adjacency.resize(result.size());
+		for (size_t i = 0; i < result.size(); ++i) {
+			adjacency[filled[result[i]]++] = static_cast<uint32_t>(i / 3);
+		}
+
+		std::fill(border.begin(), border.end(), 0);
+		for (size_t i = 0; i < result.size(); i += 3) {
+			for (int k = 0; k < 3; ++k) {
+				uint32_t a = result[i + k], b = result[i + (k + 1) % 3];
+				if (!edges.count(edge_key(b, a))) {
+					border[a] = border[b] = 1;
+				}
+			}
+		}
+
+		//border vertices only collapse along the border, or they would pinch the mesh
+		collapses.clear();
+		for (size_t i = 0; i < result.size(); i += 3) {
+			for (int k = 0; k < 3; ++k) {
+				uint32_t a = result[i + k], b = result[i + (k + 1) % 3];
+				bool borderEdge = !edges.count(edge_key(b, a));
+				//inner edges turn up once in each of their triangles
+				if (!borderEdge && a > b) {
+					continue;
+				}
+				uint32_t ends[2][2] = { { a, b }, { b, a } };
+				for (const auto& end : ends) {
+					if (locked[end[0]] || (border[end[0]] && !borderEdge)) {
+						continue;
+					}
+					Quadric quadric = quadrics[end[0]];
+					quadric.add(quadrics[end[1]]);
+					collapses.push_back({ end[0], end[1], quadric.error(position(end[1])) });
+				}
+			}
+		}
+		std::sort(collapses.begin(), collapses.end(), [](const Collapse& a, const Collapse& b) { return a.error < b.error; });
+
+		std::iota(remap.begin(), remap.end(), 0);
+		std::fill(touched.begin(), touched.end(), 0);
+		size_t trianglesToRemove = (result.size() - targetIndexCount + 2) / 3;
+		size_t removed = 0, applied = 0;
+		for (const Collapse& collapse : collapses) {
+			if (collapse.error > maxError || removed >= trianglesToRemove) {
+				break;
+			}
+			if (touched[collapse.from] || touched[collapse.to]) {
+				continue;
+			}
+
+			//no triangle left around the vertex may fold over once it moves
+			bool flips = false;
+			size_t closing = 0;
+			for (uint32_t i = offsets[collapse.from]; i < offsets[collapse.from + 1] && !flips; ++i) {
+				uint32_t triangle = adjacency[i];
+				uint32_t v[3] = { remap[result[3 * triangle]], remap[result[3 * triangle + 1]], remap[result[3 * triangle + 2]] };
+				if (v[0] == v[1] || v[1] == v[2] || v[0] == v[2]) {
+					continue;
+				}
+				if (v[0] == collapse.to || v[1] == collapse.to || v[2] == collapse.to) {
+					++closing;
+					continue;
+				}
+				glm::dvec3 p[3] = { position(v[0]), position(v[1]), position(v[2]) };
+				glm::dvec3 before = glm::cross(p[2] - p[0], p[1] - p[0]);
+				for (int k = 0; k < 3; ++k) {
+					if (v[k] == collapse.from) {
+						p[k] = position(collapse.to);
+					}
+				}
+				glm::dvec3 after = glm::cross(p[2] - p[0], p[1] - p[0]);
+				flips = glm::dot(before, after) <= 0.25 * glm::length(before) * glm::length(after);
+			}
+			if (flips) {
+				continue;
+			}
+
+			remap[collapse.from] = collapse.to;
+			quadrics[collapse.to].add(quadrics[collapse.from]);
+			touched[collapse.from] = touched[collapse.to] = 1;
+			removed += closing;
+			++applied;
+		}
+		if (!applied) {
+			break;
+		}
+		for (uint32_t& vertex : merged) {
+			vertex = remap[vertex];
+		}
+
+		size_t kept = 0;
+		for (size_t t = 0; t < triangleCount; ++t) {
+			uint32_t a = remap[result[3 * t]], b = remap[result[3 * t + 1]], c = remap[result[3 * t + 2]];
+			if (a != b && b != c && a != c) {
+				result[3 * kept] = a;
+				result[3 * kept + 1] = b;
+				result[3 * kept + 2] = c;
+				++kept;
+			}
+		}
+		result.resize(3 * kept);
+		find_edges();
+	}
+
+	if (resultError) {
+		*resultError = static_cast<float>(surface_distance(indices, result, merged, position));
+	}
+	return result;
+}
\ No newline at end of file
@@ -0,0 +1,20 @@
+#pragma once
+#include "config.h"
+
+namespace vkMesh {
+
+	/*
+		Simplify a mesh by collapsing edges, cheapest first by quadric error metrics, until it has at most
+		targetIndexCount indices or every collapse left has a quadric error past targetError.
+		A collapse merges a vertex into a neighbour without moving it, so the result indexes the same vertices.
+		Open borders only slide along themselves, and vertices sharing a position with another, on a seam, stay put.
+		\param positions the first vertex's position
+		\param positionComponents 2 or 3, a missing z is 0
+		\param stride floats from one vertex's position to the next
+		\param targetError the root mean squared distance a collapsed vertex's planes may end up from its new position, in the mesh's units
+		\param resultError when not null, receives the furthest any input vertex lies from the result's surface, measured once done
+		\returns the simplified indices
+	*/
+	std::vector<uint32_t> simplify(const std::vector<uint32_t>& indices, const float* positions, uint32_t positionComponents,
+		size_t stride, size_t vertexCount, size_t targetIndexCount, float targetError, float* resultError);
+}
\ No newline at end of file
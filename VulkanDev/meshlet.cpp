@@ -0,0 +1,97 @@
+#include "meshlet.h"
+
+namespace {
+	vkMesh::Meshlet make_meshlet(const std::vector<uint32_t>& indices, size_t first, size_t last,
+		const float* positions, uint32_t positionComponents, size_t stride) {
+
+		auto position = [&](uint32_t vertex) {
+			const float* p = positions + vertex * stride;
+			return glm::vec3(p[0], p[1], positionComponents > 2 ? p[2] : 0.0f);
+		};
+
+		vkMesh::Meshlet meshlet = {};
+		meshlet.firstIndex = static_cast<uint32_t>(3 * first);
+		meshlet.indexCount = static_cast<uint32_t>(3 * (last - first));
+
+		//a sphere around the box of the corners
+		glm::vec3 boxMin(std::numeric_limits<float>::max()), boxMax(-std::numeric_limits<float>::max());
+		for (size_t i = 3 * first; i < 3 * last; ++i) {
+			boxMin = glm::min(boxMin, position(indices[i]));
+			boxMax = glm::max(boxMax, position(indices[i]));
+		}
+		glm::vec3 center = 0.5f * (boxMin + boxMax);
+		float radius = 0.0f;
+		for (size_t i = 3 * first; i < 3 * last; ++i) {
+			radius = std::max(radius, glm::length(position(indices[i]) - center));
+		}
+		meshlet.sphere = glm::vec4(center, radius);
+
+		//front faces wind clockwise on screen, so c - a, b - a gives the normal facing the viewer
+		std::vector<glm::vec3> normals;
+		normals.reserve(last - first);
+		glm::vec3 axis(0.0f);
+		for (size_t t = first; t < last; ++t) {
+			glm::vec3 a = position(indices[3 * t]), b = position(indices[3 * t + 1]), c = position(indices[3 * t + 2]);
+			glm::vec3 normal = glm::cross(c - a, b - a);
+			float length = glm::length(normal);
+			if (length > 0.0f) {
+				normals.push_back(normal / length);
+				axis += normals.back();
+			}
+		}
+
+		//the cone holding every normal, nothing is culled by it if it's too wide
+		meshlet.cone = glm::vec4(0.0f, 0.0f, 0.0f, 2.0f);
+		float axisLength = glm::length(axis);
+		if (axisLength > 0.0f) {
+			axis /= axisLength;
+			float minDot = 1.0f;
+			for (const glm::vec3& normal : normals) {
+				minDot = std::min(minDot, glm::dot(normal, axis));
+			}
+			if (minDot > 0.1f) {
+				meshlet.cone = glm::vec4(axis, std::sqrt(1.0f - minDot * minDot));
+			}
+		}
+		return meshlet;
+	}
+}
+
+size_t vkMesh::build_meshlets(const std::vector<uint32_t>& indices, const float* positions, uint32_t positionComponents, size_t stride,
+	std::vector<Meshlet>& meshlets) {
+	size_t triangleCount = indices.size() / 3;
+	size_t firstMeshlet = meshlets.size();
+	if (triangleCount == 0) {
+		return 0;
+	}
+
+	//vertices are stamped with the meshlet which last used them
+	uint32_t vertexCount = 0;
+	for (uint32_t index : indices) {
+		vertexCount = std::max(vertexCount, index + 1);
+	}
+	std::vector<uint32_t> stamps(vertexCount, 0);
+	uint32_t stamp = 1;
+	uint32_t vertices = 0;
+	size_t first = 0;
+
+	for (size_t t = 0; t < triangleCount; ++t) {
+		uint32_t a = indices[3 * t], b = indices[3 * t + 1], c = indices[3 * t + 2];
+		auto new_vertices = [&]() {
+			return uint32_t(stamps[a] != stamp) + uint32_t(stamps[b] != stamp && b != a) + uint32_t(stamps[c] != stamp && c != a && c != b);
+		};
+
+		if (t > first && (vertices + new_vertices() > maxMeshletVertices || t - first + 1 > maxMeshletTriangles)) {
+			meshlets.push_back(make_meshlet(indices, first, t, positions, positionComponents, stride));
+			++stamp;
+			vertices = 0;
+			first = t;
+		}
+
+		vertices += new_vertices();
+		stamps[a] = stamps[b] = stamps[c] = stamp;
+	}
+	meshlets.push_back(make_meshlet(indices, first, triangleCount, positions, positionComponents, stride));
+
+	return meshlets.size() - firstMeshlet;
+}
\ No newline at end of file
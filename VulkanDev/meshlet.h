@@ -0,0 +1,37 @@
+#pragma once
+#include "config.h"
+
+namespace vkMesh {
+
+	constexpr uint32_t maxMeshletVertices = 64;
+	constexpr uint32_t maxMeshletTriangles = 124;
+
+	/**
+		A run of a mesh's triangles small enough to be culled on its own, the layout must match the one in culling.comp.
+		Bounds are in the mesh's space.
+	*/
+	struct Meshlet {
+		//xyz center, w radius
+		glm::vec4 sphere;
+		//xyz the average direction front faces face, w the cutoff, above 1 when the triangles face too many ways to cull
+		glm::vec4 cone;
+		//from the mesh's first index
+		uint32_t firstIndex;
+		uint32_t indexCount;
+		uint32_t reserved[2];
+	};
+
+	/*
+		Split a mesh into meshlets of consecutive triangles, starting a new one whenever the next triangle
+		would take it past maxMeshletVertices or maxMeshletTriangles. Triangles are kept in order,
+		so meshes optimized for the vertex cache give the tightest meshlets.
+		Front faces wind clockwise on screen, the cone is built from the normals facing the viewer.
+		\param positions the first vertex's position
+		\param positionComponents 2 or 3, a missing z is 0
+		\param stride floats from one vertex's position to the next
+		\param meshlets the mesh's meshlets are appended
+		\returns the number of meshlets appended
+	*/
+	size_t build_meshlets(const std::vector<uint32_t>& indices, const float* positions, uint32_t positionComponents, size_t stride,
+		std::vector<Meshlet>& meshlets);
+}
\ No newline at end of file
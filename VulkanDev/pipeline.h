@@ -15,7 +15,9 @@ namespace vkInit {
 		std::string fragmentFilePath;
 		vk::Extent2D swapchainExtent;
 		vk::Format swapchainImageFormat, depthFormat;
+		vk::ImageLayout colorFinalLayout;
 		std::vector<vk::DescriptorSetLayout> descriptorSetLayouts;
+		vkMesh::VertexLayout vertexLayout;
 	};
 
 
@@ -128,17 +130,19 @@ namespace vkInit {
 
 		\param device the logical device
 		\param swapchainImageFormat the image format chosen for the swapchain images
+		\param colorFinalLayout the layout the color buffer is left in (present or transfer source)
 		\returns the created renderpass
 	*/
-	vk::RenderPass make_renderpass(vk::Device device, vk::Format swapchainImageFormat, vk::Format depthFormat);
+	vk::RenderPass make_renderpass(vk::Device device, vk::Format swapchainImageFormat, vk::Format depthFormat, vk::ImageLayout colorFinalLayout);
 
 	/*
 		Make a color attachment description
 		
 		\param swapchainImageFormat the image format used by the swapchain
+		\param finalLayout the layout the image is transitioned to at the end of the renderpass
 		\returns a description of the corresponding color attachment
 	*/
-	vk::AttachmentDescription make_color_attachment(const vk::Format& swapchainImageFormat);
+	vk::AttachmentDescription make_color_attachment(const vk::Format& swapchainImageFormat, vk::ImageLayout finalLayout);
 
 	/*
 		\returns Make a color attachment refernce
@@ -190,8 +194,8 @@ namespace vkInit {
 		std::vector<vk::PipelineShaderStageCreateInfo> shaderStages;
 
 		//Vertex Input
-		vk::VertexInputBindingDescription bindingDescription = vkMesh::getPosColorBindingDescription();
-		std::array<vk::VertexInputAttributeDescription, 3> attributeDescriptions = vkMesh::getPosColorAttributeDescription();
+		vk::VertexInputBindingDescription bindingDescription = vkMesh::getPosColorBindingDescription(specification.vertexLayout);
+		std::array<vk::VertexInputAttributeDescription, 3> attributeDescriptions = vkMesh::getPosColorAttributeDescription(specification.vertexLayout);
 
 		vk::PipelineVertexInputStateCreateInfo vertexInputInfo = make_vertex_input_info(bindingDescription, attributeDescriptions);
 		pipelineInfo.pVertexInputState = &vertexInputInfo;
@@ -260,7 +264,7 @@ namespace vkInit {
 		//Renderpass
 		std::cout << "Create RenderPass" << std::endl;
 
-		vk::RenderPass renderpass = make_renderpass(specification.device, specification.swapchainImageFormat, specification.depthFormat);
+		vk::RenderPass renderpass = make_renderpass(specification.device, specification.swapchainImageFormat, specification.depthFormat, specification.colorFinalLayout);
 		pipelineInfo.renderPass = renderpass;
 		pipelineInfo.subpass = 0;
 
@@ -460,13 +464,13 @@ namespace vkInit {
 		\returns the created renderpass
 	*/
 
-	vk::RenderPass make_renderpass(vk::Device device, vk::Format swapchainImageFormat, vk::Format depthFormat) {
+	vk::RenderPass make_renderpass(vk::Device device, vk::Format swapchainImageFormat, vk::Format depthFormat, vk::ImageLayout colorFinalLayout) {
 
 		std::vector<vk::AttachmentDescription> attachments;
 		std::vector<vk::AttachmentReference> attachmentReferences;
 
 		//Color Buffer
-		attachments.push_back(make_color_attachment(swapchainImageFormat));
+		attachments.push_back(make_color_attachment(swapchainImageFormat, colorFinalLayout));
 		attachmentReferences.push_back(make_color_attachment_reference());
 
 		//Depth Buffer
@@ -489,7 +493,7 @@ namespace vkInit {
 	}
 
 
-	vk::AttachmentDescription make_color_attachment(const vk::Format& swapchainImageFormat) {
+	vk::AttachmentDescription make_color_attachment(const vk::Format& swapchainImageFormat, vk::ImageLayout finalLayout) {
 		vk::AttachmentDescription colorAttachment = {};
 		colorAttachment.flags = vk::AttachmentDescriptionFlags();
 		colorAttachment.format = swapchainImageFormat;
@@ -499,7 +503,7 @@ namespace vkInit {
 		colorAttachment.stencilLoadOp = vk::AttachmentLoadOp::eDontCare;
 		colorAttachment.stencilStoreOp = vk::AttachmentStoreOp::eDontCare;
 		colorAttachment.initialLayout = vk::ImageLayout::eUndefined;
-		colorAttachment.finalLayout = vk::ImageLayout::ePresentSrcKHR;
+		colorAttachment.finalLayout = finalLayout;
 
 		return colorAttachment;
 	}
@@ -558,4 +562,68 @@ namespace vkInit {
 
 		return renderpassInfo;
 	}
-}
+
+	/**
+		holds the data structures used to create a compute pipeline
+	*/
+	struct ComputePipelineInBundle {
+		vk::Device device;
+		std::string computeFilePath;
+		std::vector<vk::DescriptorSetLayout> descriptorSetLayouts;
+		//size of the compute stage's push constant block, 0 for none
+		uint32_t pushConstantSize;
+	};
+
+	struct ComputePipelineOutBundle {
+		vk::PipelineLayout layout;
+		vk::Pipeline pipeline;
+	};
+
+	/*
+		Make a compute pipeline along with its layout
+
+		\param specification the struct holding input data
+		\returns the bundle of data structures created
+	*/
+	ComputePipelineOutBundle create_compute_pipeline(ComputePipelineInBundle& specification) {
+		ComputePipelineOutBundle output;
+
+		vk::ShaderModule computeShader = vkUtils::createModule(specification.computeFilePath, specification.device, true);
+
+		vk::PushConstantRange pushConstantInfo;
+		pushConstantInfo.stageFlags = vk::ShaderStageFlagBits::eCompute;
+		pushConstantInfo.offset = 0;
+		pushConstantInfo.size = specification.pushConstantSize;
+
+		vk::PipelineLayoutCreateInfo layoutInfo;
+		layoutInfo.flags = vk::PipelineLayoutCreateFlags();
+		layoutInfo.setLayoutCount = static_cast<uint32_t>(specification.descriptorSetLayouts.size());
+		layoutInfo.pSetLayouts = specification.descriptorSetLayouts.data();
+		layoutInfo.pushConstantRangeCount = specification.pushConstantSize ? 1 : 0;
+		layoutInfo.pPushConstantRanges = &pushConstantInfo;
+
+		try {
+			output.layout = specification.device.createPipelineLayout(layoutInfo);
+		}
+		catch (vk::SystemError err) {
+			std::cout << "Failed to create compute pipeline layout!" << std::endl;
+		}
+
+		vk::ComputePipelineCreateInfo pipelineInfo;
+		pipelineInfo.flags = vk::PipelineCreateFlags();
+		pipelineInfo.stage = make_shader_info(computeShader, vk::ShaderStageFlagBits::eCompute);
+		pipelineInfo.layout = output.layout;
+		pipelineInfo.basePipelineHandle = nullptr;
+
+		try {
+			output.pipeline = specification.device.createComputePipeline(nullptr, pipelineInfo).value;
+		}
+		catch (vk::SystemError err) {
+			std::cout << "Failed to create compute pipeline" << std::endl;
+		}
+
+		specification.device.destroyShaderModule(computeShader);
+
+		return output;
+	}
+}
\ No newline at end of file
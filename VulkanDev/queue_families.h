@@ -4,24 +4,35 @@
 namespace vkUtil {
 
 	/**
-		Holds the indices of the graphics and presentation queue families.
+		Holds the indices of the graphics, presentation and transfer queue families.
 	*/
 	struct QueueFamilyIndices {
 		std::optional<uint32_t> graphicsFamily;
 		std::optional<uint32_t> presentFamily;
+		std::optional<uint32_t> transferFamily;
 
 		/**
 			\returns whether all of the Queue family indices have been set.
 		*/
 		bool isComplete() {
-			return graphicsFamily.has_value() && presentFamily.has_value();
+			return graphicsFamily.has_value() && presentFamily.has_value() && transferFamily.has_value();
+		}
+
+		/**
+			\returns whether uploads run on a different family to rendering, and so need ownership transfers.
+		*/
+		bool hasDedicatedTransfer() {
+			return transferFamily.has_value() && transferFamily != graphicsFamily;
 		}
 	};
 
 	/*
 		Find suitable queue family indices on the given physical device.
+		A transfer-only family is preferred for uploads, failing that one without graphics,
+		and otherwise uploads share the graphics family.
 
 		/param device the physical device to check
+		/param surface the window surface, or null when running headless
 		/param debug whether the system is running in debug mode
 		/returns a struct holding	the queue family indices
 	*/
@@ -37,32 +48,57 @@ namespace vkUtil {
 
 		for (vk::QueueFamilyProperties const queueFamily : queueFamilies)
 		{
-			if (queueFamily.queueFlags & vk::QueueFlagBits::eGraphics)
+			if (!indices.graphicsFamily.has_value() && (queueFamily.queueFlags & vk::QueueFlagBits::eGraphics))
 			{
 				indices.graphicsFamily = i;
-				indices.presentFamily = i;
 
 				if (debug) {
-					std::cout << "Queue Family " << i << " is suitable for graphics and presenting";
+					std::cout << "Queue Family " << i << " is suitable for graphics\n";
 				}
 			}
 
-			if (device.getSurfaceSupportKHR(i, surface))
+			//prefer presenting from the graphics family
+			if (surface && device.getSurfaceSupportKHR(i, surface))
 			{
-				indices.presentFamily = i;
+				if (!indices.presentFamily.has_value() || indices.graphicsFamily == static_cast<uint32_t>(i)) {
+					indices.presentFamily = i;
+				}
 
 				if (debug)
 				{
 					std::cout << "Queue Family " << i << " is suitable for presenting\n";
 				}
 			}
+			i++;
+		}
 
-			if (indices.isComplete()) {
-				break;
+		//headless engines have no surface, the graphics family stands in for presenting
+		if (!surface) {
+			indices.presentFamily = indices.graphicsFamily;
+		}
+
+		//lower score is better: dedicated transfer, then async compute, then anything which can copy
+		int bestScore = 3;
+		i = 0;
+		for (vk::QueueFamilyProperties const queueFamily : queueFamilies)
+		{
+			vk::QueueFlags flags = queueFamily.queueFlags;
+			//graphics and compute queues implicitly support transfer
+			bool canTransfer = static_cast<bool>(flags & (vk::QueueFlagBits::eTransfer | vk::QueueFlagBits::eGraphics | vk::QueueFlagBits::eCompute));
+			int score = !(flags & vk::QueueFlagBits::eGraphics) ? (!(flags & vk::QueueFlagBits::eCompute) ? 0 : 1) : 2;
+
+			if (canTransfer && score < bestScore)
+			{
+				bestScore = score;
+				indices.transferFamily = i;
 			}
 			i++;
 		}
 
+		if (debug && indices.transferFamily.has_value()) {
+			std::cout << "Queue Family " << indices.transferFamily.value() << " will be used for transfers\n";
+		}
+
 		return indices;
 	}
 }
\ No newline at end of file
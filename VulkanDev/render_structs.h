@@ -1,6 +1,10 @@
 #pragma once
 #include "config.h"
 
+namespace vkImage {
+	class Texture;
+}
+
 namespace vkUtil {
 	/**
 		Data structures used in rendering each individual object
@@ -9,4 +13,56 @@ namespace vkUtil {
 	struct ObjectData {
 		glm::mat4 model;
 	};
+
+	/**
+		An instanced draw of one mesh type
+	*/
+	struct DrawCommand {
+		MeshHandle mesh;
+		//which of the mesh's levels of detail is drawn
+		uint32_t lod;
+		uint32_t firstInstance;
+		uint32_t instanceCount;
+	};
+
+	/**
+		What a command buffer has bound, so that draws can skip binding it again
+	*/
+	struct BoundState {
+		vkImage::Texture* material{ nullptr };
+		bool indexBufferBound{ false };
+		vk::IndexType indexType{ vk::IndexType::eUint16 };
+	};
+
+	/**
+		Push constants of the culling shader
+	*/
+	struct CullConstants {
+		glm::vec4 planes[6];
+		//w unused, meshlets' normal cones are tested against it
+		glm::vec4 cameraPosition;
+		uint32_t instanceCount;
+		uint32_t drawCount;
+	};
+
+	/**
+		An indirect draw for GPU culling, a VkDrawIndexedIndirectCommand followed by what the
+		culling shader needs to fill it in. The layout must match the one in culling.comp.
+	*/
+	struct CullDraw {
+		vk::DrawIndexedIndirectCommand command;
+		//instances [command.firstInstance, command.firstInstance + rangeCount) belong to this draw
+		uint32_t rangeCount;
+		float radius;
+		//written next to each surviving instance for bindless materials
+		uint32_t materialId;
+		//set to 1 by the first instance to survive, so empty draws are skipped
+		uint32_t drawCount;
+		//meshlet culling only, surviving instances append a draw per surviving meshlet
+		//to [firstMeshletDraw, firstMeshletDraw + meshletDrawCount) of the meshlet draw buffer
+		uint32_t firstMeshlet;
+		uint32_t meshletCount;
+		uint32_t firstMeshletDraw;
+		uint32_t meshletDrawCount;
+	};
 }
\ No newline at end of file
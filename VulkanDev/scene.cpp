@@ -1,32 +1,239 @@
 #include "scene.h"
+#include "scene_file.h"
+#include <cstring>
 
 
-Scene::Scene() {
+Scene::Scene(const MeshRegistry& meshes) {
 
-	float x = -0.3f;
-	for (size_t z = -1.0f; z <= 1.0f; z+=0.2f)
-	{
-		for (float y = -1.0f; y < 1.0f; y += 0.2f) {
+	if (begin_range(meshes, "triangle")) {
+		float x = -0.3f;
+		for (float z = -1.0f; z <= 1.0f; z += 0.2f)
+		{
+			for (float y = -1.0f; y < 1.0f; y += 0.2f) {
 
-			trianglePositions.push_back(glm::vec3(x, y, z));
+				transforms.add(glm::vec3(x, y, z));
+				ranges.back().count++;
+			}
 		}
 	}
 	
 
-	x = 0.0f;
-	for (float z = -1.0f; z <= 1.0f; z += 0.2f) {
-		for (float y = -1.0f; y < 1.0f; y += 0.2f)
-		{
-			squarePositions.push_back(glm::vec3(x, y, z));
+	if (begin_range(meshes, "square")) {
+		float x = 0.0f;
+		for (float z = -1.0f; z <= 1.0f; z += 0.2f) {
+			for (float y = -1.0f; y < 1.0f; y += 0.2f)
+			{
+				transforms.add(glm::vec3(x, y, z));
+				ranges.back().count++;
+			}
 		}
 	}
 
 
-	x = 0.3f;
-	for (float z = -1.0f; z <= 1.0f; z += 0.2f) {
-		for (float y = -1.0f; y < 1.0f; y += 0.2f)
-		{
-			starPositions.push_back(glm::vec3(x, y, z));
+	if (begin_range(meshes, "star")) {
+		float x = 0.3f;
+		for (float z = -1.0f; z <= 1.0f; z += 0.2f) {
+			for (float y = -1.0f; y < 1.0f; y += 0.2f)
+			{
+				transforms.add(glm::vec3(x, y, z));
+				ranges.back().count++;
+			}
+		}
+	}
+}
+
+Scene::Scene(const MeshRegistry& meshes, size_t instanceCount) {
+	const char* meshNames[] = { "triangle", "square", "star" };
+	transforms.reserve(instanceCount);
+
+	for (size_t mesh = 0; mesh < 3; ++mesh) {
+		if (!begin_range(meshes, meshNames[mesh])) {
+			continue;
 		}
+
+		//a square slab of instances per mesh, side by side
+		size_t count = instanceCount / 3 + (mesh < instanceCount % 3 ? 1 : 0);
+		size_t side = std::max<size_t>(1, static_cast<size_t>(std::ceil(std::sqrt(static_cast<double>(count)))));
+		float spacing = 2.0f / static_cast<float>(side);
+		float x = -0.3f + 0.3f * static_cast<float>(mesh);
+		for (size_t i = 0; i < count; ++i) {
+			transforms.add(glm::vec3(x, -1.0f + spacing * static_cast<float>(i % side), -1.0f + spacing * static_cast<float>(i / side)));
+		}
+		ranges.back().count = static_cast<uint32_t>(count);
+	}
+}
+
+bool Scene::begin_range(const MeshRegistry& meshes, const char* name) {
+	MeshHandle mesh = meshes.find(name);
+	if (!meshes.contains(mesh)) {
+		std::cout << "The scene leaves out the unknown mesh " << name << std::endl;
+		return false;
+	}
+
+	InstanceRange range;
+	range.mesh = mesh;
+	range.first = static_cast<uint32_t>(transforms.size());
+	range.count = 0;
+	ranges.push_back(range);
+	return true;
+}
+
+void Scene::update_spatial_index(const MeshRegistry& meshes) {
+	if (spatialIndex.size() != transforms.size() || spatialIndex.refits_since_build() > transforms.size()) {
+		std::vector<float> meshRadii(transforms.size(), 0.0f);
+		for (const InstanceRange& range : ranges) {
+			float radius = meshes.contains(range.mesh) ? meshes.get(range.mesh).boundingRadius : 0.0f;
+			std::fill(meshRadii.begin() + range.first, meshRadii.begin() + range.first + range.count, radius);
+		}
+		spatialIndex.build(transforms, meshRadii);
+	}
+	else {
+		spatialIndex.update(transforms, spatialIndexVersion);
+	}
+	spatialIndexVersion = transforms.version();
+}
+
+const Scene::InstanceRange* Scene::find_range(uint32_t instance) const {
+	//ranges are laid out in order
+	auto after = std::upper_bound(ranges.begin(), ranges.end(), instance,
+		[](uint32_t instance, const InstanceRange& range) { return instance < range.first; });
+	if (after == ranges.begin()) {
+		return nullptr;
+	}
+	const InstanceRange& range = *(after - 1);
+	return instance - range.first < range.count ? &range : nullptr;
+}
+
+namespace {
+	uint64_t align_scene_offset(uint64_t offset) {
+		return (offset + sceneFileAlignment - 1) / sceneFileAlignment * sceneFileAlignment;
+	}
+}
+
+bool Scene::load(const char* filename, const MeshRegistry& meshes) {
+	vkUtils::MappedFile file;
+	if (!file.open(filename)) {
+		std::cout << "Failed to map scene file " << filename << std::endl;
+		return false;
+	}
+
+	SceneFileHeader header;
+	if (!vkUtils::read_file_header(file, filename, "scene file", sceneFileMagic, sceneFileVersion, sceneFileByteOrder, header)) {
+		return false;
+	}
+
+	uint64_t size = header.fileSize;
+	uint64_t instanceCount = header.instanceCount;
+	//instances are indexed with 31 bits in the spatial index
+	bool fits = instanceCount < 0x7FFFFFFF
+		&& vkUtils::blob_fits(header.rangesOffset, header.rangeCount, sizeof(SceneFileRange), size, sceneFileAlignment);
+	for (uint64_t offset : header.componentOffsets) {
+		fits = fits && vkUtils::blob_fits(offset, instanceCount, sizeof(float), size, sceneFileAlignment);
+	}
+	if (!fits) {
+		std::cout << filename << " has arrays outside of the file" << std::endl;
+		return false;
+	}
+
+	std::vector<InstanceRange> loadedRanges(header.rangeCount);
+	for (size_t i = 0; i < loadedRanges.size(); ++i) {
+		SceneFileRange fileRange;
+		memcpy(&fileRange, file.data() + header.rangesOffset + i * sizeof(SceneFileRange), sizeof(fileRange));
+		std::string name(fileRange.mesh, strnlen(fileRange.mesh, sizeof(fileRange.mesh)));
+
+		InstanceRange& range = loadedRanges[i];
+		range.mesh = meshes.find(name);
+		range.first = fileRange.first;
+		range.count = fileRange.count;
+		if (!meshes.contains(range.mesh)) {
+			std::cout << filename << " uses the unknown mesh " << name << std::endl;
+			return false;
+		}
+		if (uint64_t(range.first) + range.count > instanceCount || (i && range.first < uint64_t(loadedRanges[i - 1].first) + loadedRanges[i - 1].count)) {
+			std::cout << filename << " has instance ranges outside of the instances, overlapping or out of order" << std::endl;
+			return false;
+		}
+		if (meshes.get(range.mesh).materialId != fileRange.materialId) {
+			std::cout << "The mesh " << name << " in " << filename << " was written with material " << fileRange.materialId
+				<< ", it will be drawn with material " << meshes.get(range.mesh).materialId << std::endl;
+		}
+	}
+
+	float* components[TransformStore::componentCount];
+	for (size_t i = 0; i < TransformStore::componentCount; ++i) {
+		components[i] = reinterpret_cast<float*>(file.data() + header.componentOffsets[i]);
+	}
+	transforms.view(components, static_cast<size_t>(instanceCount));
+	ranges = std::move(loadedRanges);
+	//after the transforms have stopped pointing into any file mapped before
+	sceneFile = std::move(file);
+
+	//rebuilt over the new instances by its next update
+	spatialIndex = SpatialIndex();
+	spatialIndexVersion = 0;
+	return true;
+}
+
+bool Scene::save(const char* filename, const MeshRegistry& meshes) const {
+	if (!vkUtils::little_endian()) {
+		std::cout << "Scene files are little endian, they can't be written in place on this machine" << std::endl;
+		return false;
+	}
+
+	SceneFileHeader header = {};
+	memcpy(header.magic, sceneFileMagic, sizeof(header.magic));
+	header.formatVersion = sceneFileVersion;
+	header.byteOrder = sceneFileByteOrder;
+	header.instanceCount = transforms.size();
+	header.rangeCount = ranges.size();
+	header.rangesOffset = align_scene_offset(sizeof(SceneFileHeader));
+	uint64_t offset = align_scene_offset(header.rangesOffset + ranges.size() * sizeof(SceneFileRange));
+	for (uint64_t& componentOffset : header.componentOffsets) {
+		componentOffset = offset;
+		offset = align_scene_offset(offset + transforms.size() * sizeof(float));
+	}
+	header.fileSize = offset;
+
+	std::vector<SceneFileRange> fileRanges(ranges.size());
+	for (size_t i = 0; i < ranges.size(); ++i) {
+		const InstanceRange& range = ranges[i];
+		SceneFileRange& fileRange = fileRanges[i];
+		if (!meshes.contains(range.mesh) || meshes.name(range.mesh).size() >= sizeof(fileRange.mesh)) {
+			std::cout << "The mesh of instance range " << i << " can't be named in a scene file" << std::endl;
+			return false;
+		}
+		const std::string& name = meshes.name(range.mesh);
+		memcpy(fileRange.mesh, name.c_str(), name.size() + 1);
+		fileRange.first = range.first;
+		fileRange.count = range.count;
+		fileRange.materialId = meshes.get(range.mesh).materialId;
+	}
+
+	std::vector<vkUtils::FileBlob> blobs;
+	blobs.push_back({ 0, &header, sizeof(header) });
+	blobs.push_back({ header.rangesOffset, fileRanges.data(), fileRanges.size() * sizeof(SceneFileRange) });
+	std::array<const Column<float>*, TransformStore::componentCount> components = transforms.components();
+	for (size_t i = 0; i < components.size(); ++i) {
+		blobs.push_back({ header.componentOffsets[i], components[i]->data(), transforms.size() * sizeof(float) });
+	}
+	return vkUtils::write_blobs(filename, blobs, header.fileSize);
+}
+
+bool write_procedural_scene(const char* filename, size_t instanceCount) {
+	//in the order the engine registers them, their materials are their places in it
+	MeshRegistry meshes;
+	const char* meshNames[] = { "triangle", "square", "star" };
+	for (uint32_t i = 0; i < 3; ++i) {
+		MeshRange range = {};
+		range.materialId = i;
+		meshes.add(meshNames[i], range);
+	}
+
+	Scene* scene = instanceCount ? new Scene(meshes, instanceCount) : new Scene(meshes);
+	bool written = scene->save(filename, meshes);
+	if (written) {
+		std::cout << "Wrote " << scene->transforms.size() << " instances in " << scene->ranges.size() << " ranges to " << filename << std::endl;
 	}
+	delete scene;
+	return written;
 }
\ No newline at end of file
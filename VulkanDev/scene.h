@@ -1,13 +1,93 @@
 #pragma once
 #include "config.h"
+#include "transform_store.h"
+#include "mesh_registry.h"
+#include "spatial_index.h"
+#include "mapped_file.h"
 
 class Scene {
 public:
-	Scene();
+	/*
+		An empty scene, to load into
+	*/
+	Scene() = default;
 
-	std::vector<glm::vec3> trianglePositions;
+	/*
+		\param meshes where to find the meshes the scene is made of
+	*/
+	Scene(const MeshRegistry& meshes);
 
-	std::vector<glm::vec3> squarePositions;
+	/*
+		A grid of instances split evenly between the triangle, square and star meshes
+		\param instanceCount the number of instances
+	*/
+	Scene(const MeshRegistry& meshes, size_t instanceCount);
 
-	std::vector<glm::vec3> starPositions;
-};
\ No newline at end of file
+	Scene(const Scene&) = delete;
+	Scene& operator=(const Scene&) = delete;
+
+	/*
+		Replace the scene with a binary scene file, see scene_file.h. The file is mapped
+		and the transforms point straight into it, nothing is parsed or copied.
+		Moving instances writes to private copies of the mapped pages, never to the file.
+		\param meshes where to find the meshes the file names
+		\returns whether the file was loaded, the scene is unchanged otherwise
+	*/
+	bool load(const char* filename, const MeshRegistry& meshes);
+
+	/*
+		Write the scene as a binary scene file
+		\param meshes where to find the names of the scene's meshes
+		\returns whether the whole file was written
+	*/
+	bool save(const char* filename, const MeshRegistry& meshes) const;
+
+	/*
+		A run of instances of one mesh, contiguous in the transform store
+	*/
+	struct InstanceRange {
+		MeshHandle mesh;
+		uint32_t first;
+		uint32_t count;
+	};
+
+	TransformStore transforms;
+
+	//in draw order, this is also the layout of the model buffer
+	std::vector<InstanceRange> ranges;
+
+	//bounding spheres of every instance, for culling, picking and proximity queries
+	SpatialIndex spatialIndex;
+
+	/*
+		Bring the spatial index up to date with the transforms. It's rebuilt once instances have been added,
+		or once there have been as many refits as instances, and refit where instances moved otherwise.
+		\param meshes where to find the radii of the ranges' meshes
+	*/
+	void update_spatial_index(const MeshRegistry& meshes);
+
+	/*
+		\returns the range holding an instance, or nullptr
+	*/
+	const InstanceRange* find_range(uint32_t instance) const;
+
+private:
+	//transform store version the spatial index is up to date with
+	uint64_t spatialIndexVersion{ 0 };
+
+	//the loaded scene file, which the transforms point into
+	vkUtils::MappedFile sceneFile;
+
+	/*
+		Start a range of instances of a mesh
+		\param name the mesh's name
+		\returns whether the mesh was found, no range is started otherwise
+	*/
+	bool begin_range(const MeshRegistry& meshes, const char* name);
+};
+
+/*
+	Write a procedural scene of the given size, registering the meshes by name only, so no device is needed.
+	\returns whether the whole file was written
+*/
+bool write_procedural_scene(const char* filename, size_t instanceCount);
\ No newline at end of file
@@ -0,0 +1,47 @@
+#pragma once
+#include "config.h"
+#include "transform_store.h"
+
+/*
+	Binary scene files are little endian and laid out to be used in place once mapped:
+
+	SceneFileHeader
+	SceneFileRange[rangeCount], from rangesOffset, disjoint and in ascending order of first
+	float[instanceCount] per transform component in TransformStore order, from componentOffsets
+
+	Every offset is from the start of the file and a multiple of sceneFileAlignment.
+*/
+
+constexpr char sceneFileMagic[8] = "VDSCENE";
+//bumped whenever the layout changes, files of any other version are refused
+constexpr uint32_t sceneFileVersion = 1;
+//reads back as written only on a machine of the same byte order
+constexpr uint32_t sceneFileByteOrder = 0x01020304;
+constexpr uint64_t sceneFileAlignment = 64;
+
+struct SceneFileHeader {
+	char magic[8];
+	uint32_t formatVersion;
+	uint32_t byteOrder;
+	uint64_t fileSize;
+	uint64_t instanceCount;
+	uint64_t rangeCount;
+	uint64_t rangesOffset;
+	uint64_t componentOffsets[TransformStore::componentCount];
+};
+
+/*
+	A Scene::InstanceRange, with its mesh by name
+*/
+struct SceneFileRange {
+	//null terminated, looked up in the mesh registry when loading
+	char mesh[48];
+	uint32_t first;
+	uint32_t count;
+	//the material the mesh was drawn with when the scene was written
+	uint32_t materialId;
+	uint32_t reserved;
+};
+
+static_assert(sizeof(SceneFileHeader) == 128, "scene file header layout changed");
+static_assert(sizeof(SceneFileRange) == 64, "scene file range layout changed");
\ No newline at end of file
@@ -1,2 +1,5 @@
 D:\VulkanSDK\1.3.239.0\Bin\glslc.exe shader.vert -o vertex.spv
-D:\VulkanSDK\1.3.239.0\Bin\glslc.exe shader.frag -o fragment.spv
\ No newline at end of file
+D:\VulkanSDK\1.3.239.0\Bin\glslc.exe shader.frag -o fragment.spv
+D:\VulkanSDK\1.3.239.0\Bin\glslc.exe culling.comp -o culling.spv
+D:\VulkanSDK\1.3.239.0\Bin\glslc.exe -DMESHLETS culling.comp -o culling_meshlets.spv
+D:\VulkanSDK\1.3.239.0\Bin\glslc.exe shader_bindless.frag -o fragment_bindless.spv
\ No newline at end of file
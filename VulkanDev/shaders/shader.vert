@@ -14,11 +14,19 @@ layout(std140, binding = 1) readonly buffer storageBuffer {
 	mat4 model[];
 } ObjectData;
 
+//instances which survived culling, compacted per draw, each with its material
+layout(std430, binding = 2) readonly buffer visibleBuffer {
+	uvec2 entry[];
+} VisibleData;
+
 layout(location = 0) out vec3 fragColor;
 layout(location = 1) out vec2 fragTexCoord;
+layout(location = 2) flat out uint fragMaterial;
 
 void main() {
-	gl_Position = cameraData.viewProjection * ObjectData.model[gl_InstanceIndex] * vec4(vertexPosition, 0.0, 1.0);
+	uvec2 visible = VisibleData.entry[gl_InstanceIndex];
+	gl_Position = cameraData.viewProjection * ObjectData.model[visible.x] * vec4(vertexPosition, 0.0, 1.0);
 	fragColor = vertexColor;
 	fragTexCoord = vertexTexCoord;
+	fragMaterial = visible.y;
 }
\ No newline at end of file
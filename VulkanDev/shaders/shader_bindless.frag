@@ -0,0 +1,15 @@
+#version 450
+#extension GL_EXT_nonuniform_qualifier : require
+
+layout(location = 0) in vec3 fragColor;
+layout(location = 1) in vec2 fragTexCoord;
+layout(location = 2) flat in uint fragMaterial;
+
+//every material, indexed by the id the vertex shader passes along
+layout(set = 1, binding = 0) uniform sampler2D materials[];
+
+layout(location = 0) out vec4 outColor;
+
+void main() {
+	outColor = vec4(fragColor, 1.0) * texture(materials[nonuniformEXT(fragMaterial)], fragTexCoord);
+}
\ No newline at end of file
@@ -0,0 +1,619 @@
+#include "spatial_index.h"
+#include <cfloat>
+
+//nodes are four wide, so AVX2 builds use the SSE kernels too
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define SPATIAL_KERNEL_SSE
+#elif defined(__ARM_NEON) || defined(_M_ARM64)
+#include <arm_neon.h>
+#define SPATIAL_KERNEL_NEON
+#endif
+
+namespace {
+	//deep enough for a median split tree over 2^32 instances
+	constexpr size_t stackSize = 128;
+
+	inline float largest_scale(const TransformStore& transforms, size_t i) {
+		return std::max(std::abs(transforms.scaleX[i]), std::max(std::abs(transforms.scaleY[i]), std::abs(transforms.scaleZ[i])));
+	}
+
+	//the same test cull_spheres makes
+	inline bool sphere_visible(const Frustum& frustum, const glm::vec4& sphere) {
+		for (const glm::vec4& plane : frustum.planes) {
+			if (plane.x * sphere.x + plane.y * sphere.y + plane.z * sphere.z + plane.w < -sphere.w) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	/*
+		\returns the distance along the ray to where it enters the sphere, 0 if it starts inside, negative for a miss
+	*/
+	inline float ray_sphere(glm::vec3 origin, glm::vec3 direction, const glm::vec4& sphere) {
+		glm::vec3 offset = origin - glm::vec3(sphere);
+		float c = glm::dot(offset, offset) - sphere.w * sphere.w;
+		if (c <= 0.0f) {
+			return 0.0f;
+		}
+		float a = glm::dot(direction, direction);
+		float b = glm::dot(direction, offset);
+		float discriminant = b * b - a * c;
+		if (discriminant < 0.0f || b > 0.0f) {
+			return -1.0f;
+		}
+		return (-b - std::sqrt(discriminant)) / a;
+	}
+
+#if defined(SPATIAL_KERNEL_SSE)
+
+	/*
+		Test a node's four children against the frustum.
+		\param visible receives a bit per child not outside any plane
+		\param inside receives a bit per child entirely inside every plane
+	*/
+	inline void frustum_test(const SpatialIndex::Node& node, const Frustum& frustum, unsigned int& visible, unsigned int& inside) {
+		const __m128 minX = _mm_load_ps(node.minX), minY = _mm_load_ps(node.minY), minZ = _mm_load_ps(node.minZ);
+		const __m128 maxX = _mm_load_ps(node.maxX), maxY = _mm_load_ps(node.maxY), maxZ = _mm_load_ps(node.maxZ);
+		const __m128 zero = _mm_setzero_ps();
+
+		__m128 outside = zero;
+		__m128 contained = _mm_castsi128_ps(_mm_set1_epi32(-1));
+		for (const glm::vec4& plane : frustum.planes) {
+			//the corner furthest along the normal decides whether a box is outside, the nearest whether it's inside
+			__m128 px = plane.x >= 0.0f ? maxX : minX, nx = plane.x >= 0.0f ? minX : maxX;
+			__m128 py = plane.y >= 0.0f ? maxY : minY, ny = plane.y >= 0.0f ? minY : maxY;
+			__m128 pz = plane.z >= 0.0f ? maxZ : minZ, nz = plane.z >= 0.0f ? minZ : maxZ;
+			__m128 a = _mm_set1_ps(plane.x), b = _mm_set1_ps(plane.y), c = _mm_set1_ps(plane.z), d = _mm_set1_ps(plane.w);
+
+			__m128 outerDistance = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(a, px), _mm_mul_ps(b, py)), _mm_mul_ps(c, pz)), d);
+			__m128 innerDistance = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(a, nx), _mm_mul_ps(b, ny)), _mm_mul_ps(c, nz)), d);
+			outside = _mm_or_ps(outside, _mm_cmplt_ps(outerDistance, zero));
+			contained = _mm_and_ps(contained, _mm_cmpge_ps(innerDistance, zero));
+		}
+		visible = ~static_cast<unsigned int>(_mm_movemask_ps(outside)) & 0xF;
+		inside = static_cast<unsigned int>(_mm_movemask_ps(contained));
+	}
+
+	/*
+		\returns a bit per child whose box is within the sphere's radius of its center
+	*/
+	inline unsigned int sphere_test(const SpatialIndex::Node& node, glm::vec3 center, float radius) {
+		const __m128 zero = _mm_setzero_ps();
+		__m128 cx = _mm_set1_ps(center.x), cy = _mm_set1_ps(center.y), cz = _mm_set1_ps(center.z);
+		__m128 dx = _mm_max_ps(_mm_max_ps(_mm_sub_ps(_mm_load_ps(node.minX), cx), _mm_sub_ps(cx, _mm_load_ps(node.maxX))), zero);
+		__m128 dy = _mm_max_ps(_mm_max_ps(_mm_sub_ps(_mm_load_ps(node.minY), cy), _mm_sub_ps(cy, _mm_load_ps(node.maxY))), zero);
+		__m128 dz = _mm_max_ps(_mm_max_ps(_mm_sub_ps(_mm_load_ps(node.minZ), cz), _mm_sub_ps(cz, _mm_load_ps(node.maxZ))), zero);
+		__m128 distanceSquared = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz));
+		return static_cast<unsigned int>(_mm_movemask_ps(_mm_cmple_ps(distanceSquared, _mm_set1_ps(radius * radius))));
+	}
+
+	/*
+		Slab test of the ray against a node's four child boxes.
+		\param entry receives the distance along the ray to each box, 0 when the ray starts inside
+		\returns a bit per child the ray hits within maxDistance
+	*/
+	inline unsigned int ray_test(const SpatialIndex::Node& node, glm::vec3 origin, glm::vec3 inverseDirection, float maxDistance, float* entry) {
+		__m128 ox = _mm_set1_ps(origin.x), oy = _mm_set1_ps(origin.y), oz = _mm_set1_ps(origin.z);
+		__m128 ix = _mm_set1_ps(inverseDirection.x), iy = _mm_set1_ps(inverseDirection.y), iz = _mm_set1_ps(inverseDirection.z);
+		__m128 x0 = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(node.minX), ox), ix), x1 = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(node.maxX), ox), ix);
+		__m128 y0 = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(node.minY), oy), iy), y1 = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(node.maxY), oy), iy);
+		__m128 z0 = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(node.minZ), oz), iz), z1 = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(node.maxZ), oz), iz);
+
+		__m128 entryDistance = _mm_max_ps(_mm_max_ps(_mm_min_ps(x0, x1), _mm_min_ps(y0, y1)), _mm_max_ps(_mm_min_ps(z0, z1), _mm_setzero_ps()));
+		__m128 exitDistance = _mm_min_ps(_mm_min_ps(_mm_max_ps(x0, x1), _mm_max_ps(y0, y1)), _mm_min_ps(_mm_max_ps(z0, z1), _mm_set1_ps(maxDistance)));
+		_mm_storeu_ps(entry, entryDistance);
+		return static_cast<unsigned int>(_mm_movemask_ps(_mm_cmple_ps(entryDistance, exitDistance)));
+	}
+
+#elif defined(SPATIAL_KERNEL_NEON)
+
+	//lane k contributes bit k
+	inline unsigned int lane_mask(uint32x4_t lanes) {
+		const uint32_t laneBitValues[4] = { 1, 2, 4, 8 };
+		uint32x4_t bits = vandq_u32(lanes, vld1q_u32(laneBitValues));
+		uint32x2_t pairs = vadd_u32(vget_low_u32(bits), vget_high_u32(bits));
+		return vget_lane_u32(vpadd_u32(pairs, pairs), 0);
+	}
+
+	inline void frustum_test(const SpatialIndex::Node& node, const Frustum& frustum, unsigned int& visible, unsigned int& inside) {
+		const float32x4_t minX = vld1q_f32(node.minX), minY = vld1q_f32(node.minY), minZ = vld1q_f32(node.minZ);
+		const float32x4_t maxX = vld1q_f32(node.maxX), maxY = vld1q_f32(node.maxY), maxZ = vld1q_f32(node.maxZ);
+		const float32x4_t zero = vdupq_n_f32(0.0f);
+
+		uint32x4_t outside = vdupq_n_u32(0);
+		uint32x4_t contained = vdupq_n_u32(0xFFFFFFFF);
+		for (const glm::vec4& plane : frustum.planes) {
+			float32x4_t px = plane.x >= 0.0f ? maxX : minX, nx = plane.x >= 0.0f ? minX : maxX;
+			float32x4_t py = plane.y >= 0.0f ? maxY : minY, ny = plane.y >= 0.0f ? minY : maxY;
+			float32x4_t pz = plane.z >= 0.0f ? maxZ : minZ, nz = plane.z >= 0.0f ? minZ : maxZ;
+
+			float32x4_t outerDistance = vaddq_f32(vaddq_f32(vaddq_f32(vmulq_n_f32(px, plane.x), vmulq_n_f32(py, plane.y)), vmulq_n_f32(pz, plane.z)), vdupq_n_f32(plane.w));
+			float32x4_t innerDistance = vaddq_f32(vaddq_f32(vaddq_f32(vmulq_n_f32(nx, plane.x), vmulq_n_f32(ny, plane.y)), vmulq_n_f32(nz, plane.z)), vdupq_n_f32(plane.w));
+			outside = vorrq_u32(outside, vcltq_f32(outerDistance, zero));
+			contained = vandq_u32(contained, vcgeq_f32(innerDistance, zero));
+		}
+		visible = ~lane_mask(outside) & 0xF;
+		inside = lane_mask(contained);
+	}
+
+	inline unsigned int sphere_test(const SpatialIndex::Node& node, glm::vec3 center, float radius) {
+		const float32x4_t zero = vdupq_n_f32(0.0f);
+		float32x4_t cx = vdupq_n_f32(center.x), cy = vdupq_n_f32(center.y), cz = vdupq_n_f32(center.z);
+		float32x4_t dx = vmaxq_f32(vmaxq_f32(vsubq_f32(vld1q_f32(node.minX), cx), vsubq_f32(cx, vld1q_f32(node.maxX))), zero);
+		float32x4_t dy = vmaxq_f32(vmaxq_f32(vsubq_f32(vld1q_f32(node.minY), cy), vsubq_f32(cy, vld1q_f32(node.maxY))), zero);
+		float32x4_t dz = vmaxq_f32(vmaxq_f32(vsubq_f32(vld1q_f32(node.minZ), cz), vsubq_f32(cz, vld1q_f32(node.maxZ))), zero);
+		float32x4_t distanceSquared = vaddq_f32(vaddq_f32(vmulq_f32(dx, dx), vmulq_f32(dy, dy)), vmulq_f32(dz, dz));
+		return lane_mask(vcleq_f32(distanceSquared, vdupq_n_f32(radius * radius)));
+	}
+
+	inline unsigned int ray_test(const SpatialIndex::Node& node, glm::vec3 origin, glm::vec3 inverseDirection, float maxDistance, float* entry) {
+		float32x4_t ox = vdupq_n_f32(origin.x), oy = vdupq_n_f32(origin.y), oz = vdupq_n_f32(origin.z);
+		float32x4_t x0 = vmulq_n_f32(vsubq_f32(vld1q_f32(node.minX), ox), inverseDirection.x), x1 = vmulq_n_f32(vsubq_f32(vld1q_f32(node.maxX), ox), inverseDirection.x);
+		float32x4_t y0 = vmulq_n_f32(vsubq_f32(vld1q_f32(node.minY), oy), inverseDirection.y), y1 = vmulq_n_f32(vsubq_f32(vld1q_f32(node.maxY), oy), inverseDirection.y);
+		float32x4_t z0 = vmulq_n_f32(vsubq_f32(vld1q_f32(node.minZ), oz), inverseDirection.z), z1 = vmulq_n_f32(vsubq_f32(vld1q_f32(node.maxZ), oz), inverseDirection.z);
+
+		float32x4_t entryDistance = vmaxq_f32(vmaxq_f32(vminq_f32(x0, x1), vminq_f32(y0, y1)), vmaxq_f32(vminq_f32(z0, z1), vdupq_n_f32(0.0f)));
+		float32x4_t exitDistance = vminq_f32(vminq_f32(vmaxq_f32(x0, x1), vmaxq_f32(y0, y1)), vminq_f32(vmaxq_f32(z0, z1), vdupq_n_f32(maxDistance)));
+		vst1q_f32(entry, entryDistance);
+		return lane_mask(vcleq_f32(entryDistance, exitDistance));
+	}
+
+#else
+
+	inline void frustum_test(const SpatialIndex::Node& node, const Frustum& frustum, unsigned int& visible, unsigned int& inside) {
+		visible = 0;
+		inside = 0;
+		for (int k = 0; k < 4; ++k) {
+			bool outside = false, contained = true;
+			for (const glm::vec4& plane : frustum.planes) {
+				float px = plane.x >= 0.0f ? node.maxX[k] : node.minX[k], nx = plane.x >= 0.0f ? node.minX[k] : node.maxX[k];
+				float py = plane.y >= 0.0f ? node.maxY[k] : node.minY[k], ny = plane.y >= 0.0f ? node.minY[k] : node.maxY[k];
+				float pz = plane.z >= 0.0f ? node.maxZ[k] : node.minZ[k], nz = plane.z >= 0.0f ? node.minZ[k] : node.maxZ[k];
+				outside = outside || plane.x * px + plane.y * py + plane.z * pz + plane.w < 0.0f;
+				contained = contained && plane.x * nx + plane.y * ny + plane.z * nz + plane.w >= 0.0f;
+			}
+			visible |= outside ? 0u : 1u << k;
+			inside |= contained ? 1u << k : 0u;
+		}
+	}
+
+	inline unsigned int sphere_test(const SpatialIndex::Node& node, glm::vec3 center, float radius) {
+		unsigned int mask = 0;
+		for (int k = 0; k < 4; ++k) {
+			float dx = std::max(std::max(node.minX[k] - center.x, center.x - node.maxX[k]), 0.0f);
+			float dy = std::max(std::max(node.minY[k] - center.y, center.y - node.maxY[k]), 0.0f);
+			float dz = std::max(std::max(node.minZ[k] - center.z, center.z - node.maxZ[k]), 0.0f);
+			mask |= (dx * dx + dy * dy + dz * dz <= radius * radius) ? 1u << k : 0u;
+		}
+		return mask;
+	}
+
+	inline unsigned int ray_test(const SpatialIndex::Node& node, glm::vec3 origin, glm::vec3 inverseDirection, float maxDistance, float* entry) {
+		unsigned int mask = 0;
+		for (int k = 0; k < 4; ++k) {
+			float x0 = (node.minX[k] - origin.x) * inverseDirection.x, x1 = (node.maxX[k] - origin.x) * inverseDirection.x;
+			float y0 = (node.minY[k] - origin.y) * inverseDirection.y, y1 = (node.maxY[k] - origin.y) * inverseDirection.y;
+			float z0 = (node.minZ[k] - origin.z) * inverseDirection.z, z1 = (node.maxZ[k] - origin.z) * inverseDirection.z;
+			float entryDistance = std::max(std::max(std::min(x0, x1), std::min(y0, y1)), std::max(std::min(z0, z1), 0.0f));
+			float exitDistance = std::min(std::min(std::max(x0, x1), std::max(y0, y1)), std::min(std::max(z0, z1), maxDistance));
+			entry[k] = entryDistance;
+			mask |= (entryDistance <= exitDistance) ? 1u << k : 0u;
+		}
+		return mask;
+	}
+
+#endif
+}
+
+void SpatialIndex::build(const TransformStore& transforms, const std::vector<float>& meshRadii) {
+	size_t instanceCount = transforms.size();
+	this->meshRadii = meshRadii;
+	this->meshRadii.resize(instanceCount, 0.0f);
+
+	spheres.resize(instanceCount);
+	for (size_t i = 0; i < instanceCount; ++i) {
+		update_sphere(transforms, i);
+	}
+
+	instanceNodes.assign(instanceCount, 0);
+	instanceSlots.assign(instanceCount, 0);
+	nodes.clear();
+	refits = 0;
+	if (instanceCount == 0) {
+		return;
+	}
+
+	buildEntries.resize(instanceCount);
+	for (size_t i = 0; i < instanceCount; ++i) {
+		buildEntries[i].center = glm::vec3(spheres[i]);
+		buildEntries[i].instance = static_cast<uint32_t>(i);
+	}
+
+	//a full four-wide tree with one instance per slot has about a third as many nodes as instances
+	nodes.reserve(instanceCount / 3 + 1);
+	build_node(0, instanceCount, noParent, 0);
+}
+
+size_t SpatialIndex::update(const TransformStore& transforms, uint64_t since) {
+	transforms.changed_blocks(since, changedBlocks);
+
+	size_t instanceCount = spheres.size();
+	changedInstances.clear();
+	for (uint32_t block : changedBlocks) {
+		size_t last = std::min(instanceCount, (block + 1) * TransformStore::blockSize);
+		for (size_t i = block * TransformStore::blockSize; i < last; ++i) {
+			if (transforms.instanceVersions[i] <= since) {
+				continue;
+			}
+			update_sphere(transforms, i);
+			write_instance_box(static_cast<uint32_t>(i));
+			changedInstances.push_back(static_cast<uint32_t>(i));
+		}
+	}
+
+	//walking up from every instance only pays while few have moved, past that one pass over the nodes is cheaper
+	if (changedInstances.size() * 16 > nodes.size()) {
+		refit_nodes();
+	}
+	else {
+		for (uint32_t instance : changedInstances) {
+			refit_instance(instance);
+		}
+	}
+
+	refits += changedInstances.size();
+	return changedInstances.size();
+}
+
+size_t SpatialIndex::size() const {
+	return spheres.size();
+}
+
+size_t SpatialIndex::refits_since_build() const {
+	return refits;
+}
+
+void SpatialIndex::partition(size_t count, std::vector<int32_t>& parts) const {
+	parts.clear();
+	if (nodes.empty()) {
+		return;
+	}
+	parts.push_back(0);
+
+	//keep opening the biggest node until there are enough parts
+	while (parts.size() < count) {
+		size_t biggest = parts.size();
+		for (size_t i = 0; i < parts.size(); ++i) {
+			if (parts[i] >= 0 && (biggest == parts.size() || nodes[parts[i]].instanceCount > nodes[parts[biggest]].instanceCount)) {
+				biggest = i;
+			}
+		}
+		if (biggest == parts.size()) {
+			return;
+		}
+
+		const Node& node = nodes[parts[biggest]];
+		parts.erase(parts.begin() + biggest);
+		for (int32_t child : node.child) {
+			if (child != emptyChild) {
+				parts.push_back(child);
+			}
+		}
+	}
+}
+
+size_t SpatialIndex::part_size(int32_t part) const {
+	return part < 0 ? 1 : nodes[part].instanceCount;
+}
+
+size_t SpatialIndex::query_frustum(const Frustum& frustum, int32_t part, uint32_t* out) const {
+	if (part < 0) {
+		uint32_t instance = ~part;
+		out[0] = instance;
+		return sphere_visible(frustum, spheres[instance]) ? 1 : 0;
+	}
+
+	size_t count = 0;
+	int32_t stack[stackSize];
+	size_t stackTop = 0;
+	stack[stackTop++] = part;
+	while (stackTop) {
+		const Node& node = nodes[stack[--stackTop]];
+		unsigned int visible, inside;
+		frustum_test(node, frustum, visible, inside);
+
+		for (int k = 0; k < 4; ++k) {
+			int32_t child = node.child[k];
+			if (child == emptyChild || !(visible & (1u << k))) {
+				continue;
+			}
+			if (inside & (1u << k)) {
+				count += collect(child, out + count);
+			}
+			else if (child < 0) {
+				uint32_t instance = ~child;
+				out[count] = instance;
+				count += sphere_visible(frustum, spheres[instance]) ? 1 : 0;
+			}
+			else {
+				stack[stackTop++] = child;
+			}
+		}
+	}
+	return count;
+}
+
+void SpatialIndex::query_sphere(glm::vec3 center, float radius, std::vector<uint32_t>& out) const {
+	out.clear();
+	if (nodes.empty()) {
+		return;
+	}
+
+	int32_t stack[stackSize];
+	size_t stackTop = 0;
+	stack[stackTop++] = 0;
+	while (stackTop) {
+		const Node& node = nodes[stack[--stackTop]];
+		unsigned int overlapping = sphere_test(node, center, radius);
+
+		for (int k = 0; k < 4; ++k) {
+			int32_t child = node.child[k];
+			if (child == emptyChild || !(overlapping & (1u << k))) {
+				continue;
+			}
+			if (child >= 0) {
+				stack[stackTop++] = child;
+				continue;
+			}
+			uint32_t instance = ~child;
+			float reach = radius + spheres[instance].w;
+			glm::vec3 offset = glm::vec3(spheres[instance]) - center;
+			if (glm::dot(offset, offset) <= reach * reach) {
+				out.push_back(instance);
+			}
+		}
+	}
+}
+
+bool SpatialIndex::raycast(glm::vec3 origin, glm::vec3 direction, float maxDistance, RayHit& hit) const {
+	if (nodes.empty()) {
+		return false;
+	}
+
+	//axis aligned rays would divide by zero, nudging them keeps every slab distance finite
+	glm::vec3 inverseDirection;
+	for (int axis = 0; axis < 3; ++axis) {
+		float component = std::abs(direction[axis]) < 1e-30f ? 1e-30f : direction[axis];
+		inverseDirection[axis] = 1.0f / component;
+	}
+
+	float best = maxDistance;
+	bool found = false;
+
+	struct Entry {
+		int32_t node;
+		float distance;
+	};
+	Entry stack[stackSize];
+	size_t stackTop = 0;
+	stack[stackTop++] = { 0, 0.0f };
+	while (stackTop) {
+		Entry entry = stack[--stackTop];
+		//something nearer was hit since this node was pushed
+		if (entry.distance > best) {
+			continue;
+		}
+
+		const Node& node = nodes[entry.node];
+		float distances[4];
+		unsigned int hits = ray_test(node, origin, inverseDirection, best, distances);
+
+		for (int k = 0; k < 4; ++k) {
+			int32_t child = node.child[k];
+			if (child == emptyChild || !(hits & (1u << k))) {
+				continue;
+			}
+			if (child >= 0) {
+				stack[stackTop++] = { child, distances[k] };
+				continue;
+			}
+			uint32_t instance = ~child;
+			float distance = ray_sphere(origin, direction, spheres[instance]);
+			if (distance >= 0.0f && distance <= best) {
+				best = distance;
+				hit.instance = instance;
+				hit.distance = distance;
+				found = true;
+			}
+		}
+	}
+	return found;
+}
+
+void SpatialIndex::update_sphere(const TransformStore& transforms, size_t instance) {
+	spheres[instance] = glm::vec4(transforms.positionX[instance], transforms.positionY[instance], transforms.positionZ[instance],
+		meshRadii[instance] * largest_scale(transforms, instance));
+}
+
+/*
+	Build the node over buildEntries[first, last), which holds at least two instances
+	\returns the index of the node
+*/
+uint32_t SpatialIndex::build_node(size_t first, size_t last, uint32_t parent, uint32_t parentSlot) {
+	uint32_t index = static_cast<uint32_t>(nodes.size());
+	nodes.emplace_back();
+	{
+		Node& node = nodes[index];
+		for (int k = 0; k < 4; ++k) {
+			set_child_box(node, k, glm::vec3(FLT_MAX), glm::vec3(-FLT_MAX));
+			node.child[k] = emptyChild;
+		}
+		node.parent = parent;
+		node.parentSlot = parentSlot;
+		node.instanceCount = static_cast<uint32_t>(last - first);
+	}
+
+	//four groups, one instance each or split twice at the median
+	size_t bounds[5];
+	if (last - first <= 4) {
+		for (size_t k = 0; k < 5; ++k) {
+			bounds[k] = std::min(first + k, last);
+		}
+	}
+	else {
+		size_t middle = split(first, last);
+		bounds[0] = first;
+		bounds[1] = split(first, middle);
+		bounds[2] = middle;
+		bounds[3] = split(middle, last);
+		bounds[4] = last;
+	}
+
+	for (uint32_t k = 0; k < 4; ++k) {
+		glm::vec3 boxMin, boxMax;
+		int32_t child;
+		if (bounds[k + 1] - bounds[k] == 0) {
+			continue;
+		}
+		else if (bounds[k + 1] - bounds[k] == 1) {
+			uint32_t instance = buildEntries[bounds[k]].instance;
+			instanceNodes[instance] = index;
+			instanceSlots[instance] = static_cast<uint8_t>(k);
+			instance_box(instance, boxMin, boxMax);
+			child = ~static_cast<int32_t>(instance);
+		}
+		else {
+			uint32_t childNode = build_node(bounds[k], bounds[k + 1], index, k);
+			node_bounds(nodes[childNode], boxMin, boxMax);
+			child = static_cast<int32_t>(childNode);
+		}
+		//building children may have moved the node
+		set_child_box(nodes[index], k, boxMin, boxMax);
+		nodes[index].child[k] = child;
+	}
+	return index;
+}
+
+/*
+	Partially sort buildEntries[first, last) about its median along the widest axis of the sphere centers
+	\returns the median
+*/
+size_t SpatialIndex::split(size_t first, size_t last) {
+	glm::vec3 low(FLT_MAX), high(-FLT_MAX);
+	for (size_t i = first; i < last; ++i) {
+		low = glm::min(low, buildEntries[i].center);
+		high = glm::max(high, buildEntries[i].center);
+	}
+	glm::vec3 extent = high - low;
+	int axis = (extent.x >= extent.y && extent.x >= extent.z) ? 0 : (extent.y >= extent.z ? 1 : 2);
+
+	size_t middle = first + (last - first) / 2;
+	std::nth_element(buildEntries.begin() + first, buildEntries.begin() + middle, buildEntries.begin() + last,
+		[axis](const BuildEntry& a, const BuildEntry& b) { return a.center[axis] < b.center[axis]; });
+	return middle;
+}
+
+void SpatialIndex::set_child_box(Node& node, int slot, glm::vec3 boxMin, glm::vec3 boxMax) const {
+	node.minX[slot] = boxMin.x;
+	node.minY[slot] = boxMin.y;
+	node.minZ[slot] = boxMin.z;
+	node.maxX[slot] = boxMax.x;
+	node.maxY[slot] = boxMax.y;
+	node.maxZ[slot] = boxMax.z;
+}
+
+void SpatialIndex::node_bounds(const Node& node, glm::vec3& boxMin, glm::vec3& boxMax) const {
+	//unused slots hold inverted boxes, which never widen the union
+	boxMin = glm::vec3(std::min(std::min(node.minX[0], node.minX[1]), std::min(node.minX[2], node.minX[3])),
+		std::min(std::min(node.minY[0], node.minY[1]), std::min(node.minY[2], node.minY[3])),
+		std::min(std::min(node.minZ[0], node.minZ[1]), std::min(node.minZ[2], node.minZ[3])));
+	boxMax = glm::vec3(std::max(std::max(node.maxX[0], node.maxX[1]), std::max(node.maxX[2], node.maxX[3])),
+		std::max(std::max(node.maxY[0], node.maxY[1]), std::max(node.maxY[2], node.maxY[3])),
+		std::max(std::max(node.maxZ[0], node.maxZ[1]), std::max(node.maxZ[2], node.maxZ[3])));
+}
+
+void SpatialIndex::instance_box(uint32_t instance, glm::vec3& boxMin, glm::vec3& boxMax) const {
+	const glm::vec4& sphere = spheres[instance];
+	//padded a little, so that rounding never has a box reject a sphere the exact test keeps
+	float magnitude = std::max(std::max(std::abs(sphere.x), std::abs(sphere.y)), std::max(std::abs(sphere.z), sphere.w));
+	float extent = sphere.w + magnitude * 1e-5f + 1e-6f;
+	boxMin = glm::vec3(sphere) - extent;
+	boxMax = glm::vec3(sphere) + extent;
+}
+
+void SpatialIndex::write_instance_box(uint32_t instance) {
+	glm::vec3 boxMin, boxMax;
+	instance_box(instance, boxMin, boxMax);
+	set_child_box(nodes[instanceNodes[instance]], instanceSlots[instance], boxMin, boxMax);
+}
+
+/*
+	Widen or shrink the ancestors of an instance whose box was rewritten, until one doesn't change
+*/
+void SpatialIndex::refit_instance(uint32_t instance) {
+	uint32_t index = instanceNodes[instance];
+	while (nodes[index].parent != noParent) {
+		const Node& node = nodes[index];
+		glm::vec3 boxMin, boxMax;
+		node_bounds(node, boxMin, boxMax);
+
+		Node& parent = nodes[node.parent];
+		int slot = static_cast<int>(node.parentSlot);
+		if (parent.minX[slot] == boxMin.x && parent.minY[slot] == boxMin.y && parent.minZ[slot] == boxMin.z
+			&& parent.maxX[slot] == boxMax.x && parent.maxY[slot] == boxMax.y && parent.maxZ[slot] == boxMax.z) {
+			return;
+		}
+		set_child_box(parent, slot, boxMin, boxMax);
+		index = node.parent;
+	}
+}
+
+/*
+	Recompute the box of every node from its children, which come after their parents
+	so walking backwards meets them first. Instance boxes are written as instances change.
+*/
+void SpatialIndex::refit_nodes() {
+	for (size_t i = nodes.size(); i-- > 0;) {
+		Node& node = nodes[i];
+		for (int k = 0; k < 4; ++k) {
+			int32_t child = node.child[k];
+			if (child >= 0) {
+				glm::vec3 boxMin, boxMax;
+				node_bounds(nodes[child], boxMin, boxMax);
+				set_child_box(node, k, boxMin, boxMax);
+			}
+		}
+	}
+}
+
+/*
+	Write every instance of a part, untested
+*/
+size_t SpatialIndex::collect(int32_t part, uint32_t* out) const {
+	if (part < 0) {
+		out[0] = ~part;
+		return 1;
+	}
+
+	size_t count = 0;
+	int32_t stack[stackSize];
+	size_t stackTop = 0;
+	stack[stackTop++] = part;
+	while (stackTop) {
+		const Node& node = nodes[stack[--stackTop]];
+		for (int32_t child : node.child) {
+			if (child == emptyChild) {
+				continue;
+			}
+			if (child < 0) {
+				out[count++] = ~child;
+			}
+			else {
+				stack[stackTop++] = child;
+			}
+		}
+	}
+	return count;
+}
\ No newline at end of file
@@ -0,0 +1,121 @@
+#pragma once
+#include "config.h"
+#include "transform_store.h"
+#include "culling.h"
+
+/**
+	A four-wide bounding volume hierarchy over the bounding spheres of the instances in a transform store.
+	Every node keeps the boxes of its four children side by side, so queries test all four at once.
+	Moving instances are refit in place, walking up from the instance until a box stops changing,
+	and the tree is rebuilt from scratch once refits have had the chance to loosen it.
+*/
+class SpatialIndex {
+public:
+	/*
+		Four child boxes as a structure of arrays. A child is a node when it's at least 0,
+		instance i when it's ~i, and unused when it's emptyChild, with an inverted box no test passes.
+	*/
+	struct alignas(16) Node {
+		float minX[4], minY[4], minZ[4];
+		float maxX[4], maxY[4], maxZ[4];
+		int32_t child[4];
+		uint32_t parent;
+		uint32_t parentSlot;
+		//instances in the subtree
+		uint32_t instanceCount;
+	};
+
+	static constexpr int32_t emptyChild = INT32_MIN;
+	static constexpr uint32_t noParent = 0xFFFFFFFF;
+
+	struct RayHit {
+		uint32_t instance;
+		float distance;
+	};
+
+	//root first, every child comes after its parent
+	std::vector<Node> nodes;
+
+	/*
+		Build the tree over every instance.
+		\param transforms the instances, their spheres are centered on their positions
+		\param meshRadii per instance, the radius of its mesh's bounding sphere, scaled by the instance's largest scale
+	*/
+	void build(const TransformStore& transforms, const std::vector<float>& meshRadii);
+
+	/*
+		Refit the instances changed after a version. The store must hold the instances the tree was built over.
+		\param since the version the tree is up to date with
+		\returns the number of instances refit
+	*/
+	size_t update(const TransformStore& transforms, uint64_t since);
+
+	size_t size() const;
+
+	/*
+		\returns the instances refit since the last build
+	*/
+	size_t refits_since_build() const;
+
+	/*
+		Split the tree into at least count independent parts where it has enough instances, for querying in parallel.
+		\param parts cleared, then filled with children, node or instance, which together hold every instance once
+	*/
+	void partition(size_t count, std::vector<int32_t>& parts) const;
+
+	/*
+		\returns the number of instances in a part
+	*/
+	size_t part_size(int32_t part) const;
+
+	/*
+		Collect the instances of a part whose bounding spheres aren't outside the frustum,
+		the same instances cull_spheres keeps. Subtrees entirely inside are taken without testing them.
+		\param out receives the instance indices, in no particular order, needs room for part_size(part)
+		\returns the number of instances written
+	*/
+	size_t query_frustum(const Frustum& frustum, int32_t part, uint32_t* out) const;
+
+	/*
+		\param out cleared, then filled with every instance whose bounding sphere overlaps the sphere
+	*/
+	void query_sphere(glm::vec3 center, float radius, std::vector<uint32_t>& out) const;
+
+	/*
+		Find the nearest bounding sphere along a ray.
+		\param direction need not be normalized, distances are in units of its length
+		\param hit receives the instance and the distance to where the ray enters its sphere, 0 when it starts inside
+		\returns whether anything was hit within maxDistance
+	*/
+	bool raycast(glm::vec3 origin, glm::vec3 direction, float maxDistance, RayHit& hit) const;
+
+private:
+	//the bounding sphere of every instance, as of its last refit
+	std::vector<glm::vec4> spheres;
+	std::vector<float> meshRadii;
+	//the node and slot holding each instance
+	std::vector<uint32_t> instanceNodes;
+	std::vector<uint8_t> instanceSlots;
+
+	//instances are partitioned by their centers, kept next to them
+	struct BuildEntry {
+		glm::vec3 center;
+		uint32_t instance;
+	};
+	std::vector<BuildEntry> buildEntries;
+
+	std::vector<uint32_t> changedBlocks;
+	std::vector<uint32_t> changedInstances;
+	size_t refits{ 0 };
+
+	void update_sphere(const TransformStore& transforms, size_t instance);
+	uint32_t build_node(size_t first, size_t last, uint32_t parent, uint32_t parentSlot);
+	size_t split(size_t first, size_t last);
+	void set_child_box(Node& node, int slot, glm::vec3 boxMin, glm::vec3 boxMax) const;
+	void node_bounds(const Node& node, glm::vec3& boxMin, glm::vec3& boxMax) const;
+	void instance_box(uint32_t instance, glm::vec3& boxMin, glm::vec3& boxMax) const;
+	void write_instance_box(uint32_t instance);
+	void refit_instance(uint32_t instance);
+	void refit_nodes();
+	size_t collect(int32_t part, uint32_t* out) const;
+};
\ No newline at end of file
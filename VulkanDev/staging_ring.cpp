@@ -0,0 +1,87 @@
+#include "staging_ring.h"
+#include "memory.h"
+
+void vkUtils::StagingRing::init(vk::Device logicalDevice, vk::PhysicalDevice physicalDevice, MemoryAllocator* allocator, Timeline* timeline, vk::DeviceSize capacity, bool debug) {
+	this->logicalDevice = logicalDevice;
+	this->allocator = allocator;
+	this->timeline = timeline;
+	this->debug = debug;
+
+	BufferInputChunk input;
+	input.logicalDevice = logicalDevice;
+	input.physicalDevice = physicalDevice;
+	input.size = capacity;
+	input.usage = vk::BufferUsageFlagBits::eTransferSrc;
+	input.memoryProperties = vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent;
+	input.allocator = allocator;
+	buffer = createBuffer(input);
+
+	mappedPointer = static_cast<char*>(buffer.allocation.mappedPointer);
+	size = capacity;
+	head = tail = closedHead = 0;
+
+	if (debug) {
+		std::cout << "Made a " << (size >> 10) << " KiB staging ring" << std::endl;
+	}
+}
+
+void vkUtils::StagingRing::destroy() {
+	destroyBuffer(logicalDevice, allocator, buffer);
+	inFlight.clear();
+}
+
+vk::DeviceSize vkUtils::StagingRing::capacity() const {
+	return size;
+}
+
+void vkUtils::StagingRing::reclaim() {
+	while (!inFlight.empty() && inFlight.front().second <= timeline->completed()) {
+		tail = inFlight.front().first;
+		inFlight.pop_front();
+	}
+}
+
+bool vkUtils::StagingRing::reserve(vk::DeviceSize rangeSize, vk::DeviceSize alignment, StagingRange& range) {
+	if (rangeSize > size) {
+		return false;
+	}
+
+	reclaim();
+	if (head == tail) {
+		//nothing is in use, start over from the beginning
+		head = tail = closedHead = 0;
+	}
+
+	//pad up to the alignment, or all the way to the start when the range won't fit before the end
+	vk::DeviceSize offset = head % size;
+	vk::DeviceSize padding = (alignment - offset % alignment) % alignment;
+	if (offset + padding + rangeSize > size) {
+		padding = size - offset;
+	}
+	vk::DeviceSize needed = padding + rangeSize;
+
+	while (head + needed - tail > size) {
+		if (inFlight.empty()) {
+			//everything in the way belongs to ranges nobody has submitted yet
+			return false;
+		}
+		timeline->wait(inFlight.front().second);
+		reclaim();
+	}
+
+	head += needed;
+
+	range.buffer = buffer.buffer;
+	range.offset = (head - rangeSize) % size;
+	range.size = rangeSize;
+	range.writeLocation = mappedPointer + range.offset;
+	return true;
+}
+
+void vkUtils::StagingRing::close(uint64_t timelineValue) {
+	if (head == closedHead) {
+		return;
+	}
+	inFlight.push_back(std::make_pair(head, timelineValue));
+	closedHead = head;
+}
\ No newline at end of file
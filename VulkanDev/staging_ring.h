@@ -0,0 +1,84 @@
+#pragma once
+#include "config.h"
+#include "timeline.h"
+#include <deque>
+
+namespace vkUtils {
+
+	/*
+		A reserved piece of the staging ring
+	*/
+	struct StagingRange {
+		vk::Buffer buffer;
+		vk::DeviceSize offset;
+		vk::DeviceSize size;
+		//persistently mapped, write the data here before recording the copy
+		void* writeLocation;
+	};
+
+	/**
+		One persistently mapped, host visible buffer which every upload stages through.
+		Ranges are handed out in order and wrap around at the end. Reserved ranges are open until
+		close tags them with the timeline value of the submission reading them, and their space
+		comes back once that value has been signalled.
+	*/
+	class StagingRing {
+	public:
+		/*
+			\param logicalDevice the logical device
+			\param physicalDevice the physical device
+			\param allocator for the ring's memory
+			\param timeline the timeline which closed ranges are tagged with
+			\param capacity size of the ring in bytes
+			\param debug whether the system is running in debug mode
+		*/
+		void init(vk::Device logicalDevice, vk::PhysicalDevice physicalDevice, MemoryAllocator* allocator, Timeline* timeline, vk::DeviceSize capacity, bool debug);
+
+		/*
+			Free the ring, everything staged through it must have retired.
+		*/
+		void destroy();
+
+		/*
+			\returns the size of the ring in bytes, no single range can be bigger
+		*/
+		vk::DeviceSize capacity() const;
+
+		/*
+			Reserve a range, waiting for the GPU to retire closed ranges if the ring is full.
+			\param size the size of the range
+			\param alignment required alignment of the range's offset
+			\param range written on success
+			\returns false if the space is held by ranges which are still open
+		*/
+		bool reserve(vk::DeviceSize size, vk::DeviceSize alignment, StagingRange& range);
+
+		/*
+			Tag every open range with the timeline value of the submission which reads them.
+		*/
+		void close(uint64_t timelineValue);
+
+	private:
+		vk::Device logicalDevice;
+		MemoryAllocator* allocator;
+		Timeline* timeline;
+		bool debug;
+
+		Buffer buffer;
+		char* mappedPointer;
+		vk::DeviceSize size;
+
+		//running byte counts, the physical offset is head % size
+		vk::DeviceSize head{ 0 };
+		vk::DeviceSize tail{ 0 };
+		vk::DeviceSize closedHead{ 0 };
+
+		//end of each closed region, with the value which retires it
+		std::deque<std::pair<vk::DeviceSize, uint64_t>> inFlight;
+
+		/*
+			Move the tail past every region which the GPU has finished with
+		*/
+		void reclaim();
+	};
+}
\ No newline at end of file
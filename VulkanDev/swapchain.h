@@ -3,6 +3,7 @@
 #include "logging.h"
 #include "queue_families.h"
 #include "frame.h"
+#include "image.h"
 
 
 namespace vkInit {
@@ -276,4 +277,48 @@ namespace vkInit {
 
 		return bundle;
 	}
+
+	/**
+		Create device-owned color targets for rendering without a surface.
+		\param logicalDevice the logical device
+		\param physicalDevice the physical device
+		\param width the requested width
+		\param height the requested height
+		\param allocator sub-allocates the targets' memory
+		\param imageCount the number of targets to make
+		\param debug whether the system is running in debug mode
+		\returns a bundle shaped like a swapchain's, with a null swapchain handle
+	*/
+	SwapChainBundle create_offscreen_targets(vk::Device logicalDevice, vk::PhysicalDevice physicalDevice, int width, int height, vkUtils::MemoryAllocator* allocator, uint32_t imageCount, bool debug) {
+		SwapChainBundle bundle{};
+		bundle.swapChain = nullptr;
+		bundle.format = vk::Format::eR8G8B8A8Unorm;
+		bundle.extent = vk::Extent2D(static_cast<uint32_t>(width), static_cast<uint32_t>(height));
+		bundle.frames.resize(imageCount);
+
+		vkImage::ImageInputChunk imageInfo;
+		imageInfo.logicalDevice = logicalDevice;
+		imageInfo.physicalDevice = physicalDevice;
+		imageInfo.width = width;
+		imageInfo.height = height;
+		imageInfo.tilling = vk::ImageTiling::eOptimal;
+		//transfer source so that results can be read back
+		imageInfo.usage = vk::ImageUsageFlagBits::eColorAttachment | vk::ImageUsageFlagBits::eTransferSrc;
+		imageInfo.memoryProperties = vk::MemoryPropertyFlagBits::eDeviceLocal;
+		imageInfo.format = bundle.format;
+		imageInfo.allocator = allocator;
+
+		for (uint32_t i = 0; i < imageCount; i++)
+		{
+			bundle.frames[i].image = vkImage::make_image(imageInfo);
+			bundle.frames[i].imageAllocation = vkImage::make_image_memory(imageInfo, bundle.frames[i].image);
+			bundle.frames[i].imageView = vkImage::make_image_view(logicalDevice, bundle.frames[i].image, bundle.format, vk::ImageAspectFlagBits::eColor);
+
+			if (debug) {
+				std::cout << "Made offscreen target " << i << ", width: " << width << ", height: " << height << '\n';
+			}
+		}
+
+		return bundle;
+	}
 }
\ No newline at end of file
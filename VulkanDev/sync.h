@@ -21,6 +21,30 @@ namespace vkInit {
 		}
 	}
 
+	/**
+		Make a timeline semaphore, its payload is a 64 bit counter rather than a binary state.
+		\param device the logical device
+		\param initialValue the starting value of the counter
+		\returns the created semaphore
+	*/
+	vk::Semaphore make_timeline_semaphore(vk::Device device, uint64_t initialValue) {
+		vk::SemaphoreTypeCreateInfo typeInfo = {};
+		typeInfo.semaphoreType = vk::SemaphoreType::eTimeline;
+		typeInfo.initialValue = initialValue;
+
+		vk::SemaphoreCreateInfo semaphoreInfo = {};
+		semaphoreInfo.flags = vk::SemaphoreCreateFlags();
+		semaphoreInfo.pNext = &typeInfo;
+		try {
+			return device.createSemaphore(semaphoreInfo);
+		}
+		catch (vk::SystemError err) {
+
+			std::cout << "Failed to create timeline semaphore " << std::endl;
+			return nullptr;
+		}
+	}
+
 	/**
 		Make a fence.
 		\param device the logical device
@@ -0,0 +1,81 @@
+#include "timeline.h"
+
+void vkUtils::Timeline::init(vk::Device logicalDevice, vk::Semaphore timelineSemaphore) {
+	this->logicalDevice = logicalDevice;
+	semaphore = timelineSemaphore;
+	submittedValue = 0;
+	completedValue = 0;
+}
+
+uint64_t vkUtils::Timeline::next() const {
+	return submittedValue + 1;
+}
+
+void vkUtils::Timeline::mark_submitted(uint64_t value) {
+	submittedValue = std::max(submittedValue, value);
+}
+
+uint64_t vkUtils::Timeline::last_submitted() const {
+	return submittedValue;
+}
+
+uint64_t vkUtils::Timeline::completed() {
+	completedValue = logicalDevice.getSemaphoreCounterValue(semaphore);
+	return completedValue;
+}
+
+void vkUtils::Timeline::wait(uint64_t value) {
+	//cached first, so most waits don't touch the driver at all
+	if (value <= completedValue || value <= completed()) {
+		return;
+	}
+
+	/*
+	typedef struct VkSemaphoreWaitInfo {
+		VkStructureType         sType;
+		const void*             pNext;
+		VkSemaphoreWaitFlags    flags;
+		uint32_t                semaphoreCount;
+		const VkSemaphore*      pSemaphores;
+		const uint64_t*         pValues;
+	} VkSemaphoreWaitInfo;
+	*/
+	vk::SemaphoreWaitInfo waitInfo;
+	waitInfo.semaphoreCount = 1;
+	waitInfo.pSemaphores = &semaphore;
+	waitInfo.pValues = &value;
+
+	try {
+		if (logicalDevice.waitSemaphores(waitInfo, UINT64_MAX) == vk::Result::eSuccess) {
+			completedValue = std::max(completedValue, value);
+		}
+	}
+	catch (vk::SystemError err) {
+		std::cout << "Failed to wait on timeline value " << value << std::endl;
+	}
+}
+
+void vkUtils::Timeline::defer(std::function<void()> deletion) {
+	deletionQueue.emplace_back(submittedValue, std::move(deletion));
+}
+
+void vkUtils::Timeline::collect() {
+	if (deletionQueue.empty()) {
+		return;
+	}
+
+	uint64_t retired = completed();
+	while (!deletionQueue.empty() && deletionQueue.front().first <= retired)
+	{
+		deletionQueue.front().second();
+		deletionQueue.pop_front();
+	}
+}
+
+void vkUtils::Timeline::destroy() {
+	wait(submittedValue);
+	collect();
+
+	logicalDevice.destroySemaphore(semaphore);
+	semaphore = nullptr;
+}
\ No newline at end of file
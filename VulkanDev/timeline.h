@@ -0,0 +1,72 @@
+#pragma once
+#include "config.h"
+#include <deque>
+#include <functional>
+
+namespace vkUtils {
+
+	/**
+		Frame pacing built on a single timeline semaphore.
+		Every submit signals the next value of a monotonically increasing counter,
+		so "is the work tagged N done" is one comparison against the semaphore's value.
+	*/
+	class Timeline {
+	public:
+		vk::Semaphore semaphore;
+
+		/*
+			\param logicalDevice the logical device
+			\param timelineSemaphore a semaphore of type timeline, ownership is taken
+		*/
+		void init(vk::Device logicalDevice, vk::Semaphore timelineSemaphore);
+
+		/*
+			\returns the value the next submission should signal, nothing is reserved until it's marked submitted
+		*/
+		uint64_t next() const;
+
+		/*
+			Record that a submission signalling the given value went through.
+			Only values which were actually submitted are waited on, so a failed submit can't leave anything hanging.
+		*/
+		void mark_submitted(uint64_t value);
+
+		/*
+			\returns the value of the most recent successful submission
+		*/
+		uint64_t last_submitted() const;
+
+		/*
+			Query the semaphore's counter.
+			\returns the highest value the GPU has signalled so far
+		*/
+		uint64_t completed();
+
+		/*
+			Block until the GPU has signalled the given value, returns immediately if it already has.
+		*/
+		void wait(uint64_t value);
+
+		/*
+			Queue work to run once everything submitted so far has retired,
+			eg. destroying a resource which might still be in use.
+		*/
+		void defer(std::function<void()> deletion);
+
+		/*
+			Run the deferred work whose values have retired.
+		*/
+		void collect();
+
+		/*
+			Wait for all work, run the remaining deferred work and destroy the semaphore.
+		*/
+		void destroy();
+
+	private:
+		vk::Device logicalDevice;
+		uint64_t submittedValue{ 0 };
+		uint64_t completedValue{ 0 };
+		std::deque<std::pair<uint64_t, std::function<void()>>> deletionQueue;
+	};
+}
\ No newline at end of file
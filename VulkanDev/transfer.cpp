@@ -0,0 +1,350 @@
+#include "transfer.h"
+
+namespace {
+	//covers texel size and the usual optimal copy offset alignment
+	constexpr vk::DeviceSize stagingAlignment = 16;
+}
+
+vkUtils::UploadBatch::UploadBatch(TransferSystem* transfer) {
+	this->transfer = transfer;
+}
+
+vkUtils::StagingRange vkUtils::UploadBatch::reserve(vk::DeviceSize size) {
+	StagingRange range;
+	while (!transfer->stagingRing.reserve(size, stagingAlignment, range)) {
+		//the ring is full of our own data, send it off so that it can be recycled
+		transfer->submit(*this);
+	}
+	return range;
+}
+
+void vkUtils::UploadBatch::copy_buffer(const StagingRange& src, Buffer dstBuffer, vk::DeviceSize dstOffset, vk::PipelineStageFlags dstStage, vk::AccessFlags dstAccess, bool last) {
+	buffers.push_back({ src.buffer, src.offset, dstBuffer, dstOffset, src.size, dstStage, dstAccess, last });
+}
+
+void vkUtils::UploadBatch::copy_image(const StagingRange& src, vk::Image image, int width, int height, int firstRow, int rowCount, bool first, bool last) {
+	images.push_back({ src.buffer, src.offset, image, width, height, firstRow, rowCount, first, last });
+}
+
+void vkUtils::UploadBatch::stage_buffer(const void* data, vk::DeviceSize size, Buffer dstBuffer, vk::PipelineStageFlags dstStage, vk::AccessFlags dstAccess) {
+	//half the ring at most, so the next piece can be written while this one is copied
+	vk::DeviceSize pieceSize = transfer->stagingRing.capacity() / 2;
+
+	for (vk::DeviceSize done = 0; done < size;) {
+		vk::DeviceSize piece = std::min(pieceSize, size - done);
+		StagingRange range = reserve(piece);
+		memcpy(range.writeLocation, static_cast<const char*>(data) + done, piece);
+		done += piece;
+		copy_buffer(range, dstBuffer, done - piece, dstStage, dstAccess, done == size);
+	}
+}
+
+void vkUtils::UploadBatch::stage_image(const void* pixels, vk::Image image, int width, int height) {
+	vk::DeviceSize rowPitch = static_cast<vk::DeviceSize>(width) * 4;
+	vk::DeviceSize bandRows = transfer->stagingRing.capacity() / 2 / rowPitch;
+	if (bandRows == 0) {
+		std::cout << "Image rows of " << rowPitch << " bytes don't fit the staging ring" << std::endl;
+		return;
+	}
+
+	for (int row = 0; row < height;) {
+		int rows = static_cast<int>(std::min<vk::DeviceSize>(bandRows, height - row));
+		StagingRange range = reserve(rows * rowPitch);
+		memcpy(range.writeLocation, static_cast<const char*>(pixels) + row * rowPitch, range.size);
+		copy_image(range, image, width, height, row, rows, row == 0, row + rows == height);
+		row += rows;
+	}
+}
+
+uint64_t vkUtils::UploadBatch::submit() {
+	return transfer->submit(*this);
+}
+
+bool vkUtils::UploadBatch::empty() const {
+	return buffers.empty() && images.empty();
+}
+
+vk::DeviceSize vkUtils::UploadBatch::capacity() const {
+	return transfer->stagingRing.capacity();
+}
+
+vkUtils::TransferSystem::TransferSystem(TransferSystemInputChunk input) {
+	logicalDevice = input.logicalDevice;
+	queue = input.transferQueue;
+	transferFamily = input.transferFamily;
+	graphicsFamily = input.graphicsFamily;
+	debug = input.debug;
+
+	timeline.init(logicalDevice, input.timelineSemaphore);
+	stagingRing.init(logicalDevice, input.physicalDevice, input.allocator, &timeline, input.stagingSize, debug);
+
+	vk::CommandPoolCreateInfo poolInfo;
+	poolInfo.flags = vk::CommandPoolCreateFlags() | vk::CommandPoolCreateFlagBits::eTransient;
+	poolInfo.queueFamilyIndex = transferFamily;
+
+	try {
+		commandPool = logicalDevice.createCommandPool(poolInfo);
+	}
+	catch (vk::SystemError err) {
+		if (debug) {
+			std::cout << "Failed to create transfer Command Pool" << std::endl;
+		}
+	}
+
+	if (debug) {
+		std::cout << "Uploads run on queue family " << transferFamily
+			<< (dedicated() ? ", with ownership transfers" : ", shared with graphics") << std::endl;
+	}
+}
+
+vkUtils::TransferSystem::~TransferSystem() {
+	//waits for the last uploads and runs the deferred deletions
+	timeline.destroy();
+	stagingRing.destroy();
+
+	logicalDevice.destroyCommandPool(commandPool);
+}
+
+bool vkUtils::TransferSystem::dedicated() const {
+	return transferFamily != graphicsFamily;
+}
+
+vk::CommandBuffer vkUtils::TransferSystem::begin() {
+	//recycle what has finished
+	timeline.collect();
+
+	vk::CommandBufferAllocateInfo allocInfo = {};
+	allocInfo.commandPool = commandPool;
+	allocInfo.level = vk::CommandBufferLevel::ePrimary;
+	allocInfo.commandBufferCount = 1;
+	vk::CommandBuffer commandBuffer = logicalDevice.allocateCommandBuffers(allocInfo)[0];
+
+	vk::CommandBufferBeginInfo beginInfo;
+	beginInfo.flags = vk::CommandBufferUsageFlagBits::eOneTimeSubmit;
+	commandBuffer.begin(beginInfo);
+
+	return commandBuffer;
+}
+
+uint64_t vkUtils::TransferSystem::finish(vk::CommandBuffer commandBuffer) {
+	commandBuffer.end();
+
+	uint64_t signalValue = timeline.next();
+
+	vk::TimelineSemaphoreSubmitInfo timelineInfo = {};
+	timelineInfo.signalSemaphoreValueCount = 1;
+	timelineInfo.pSignalSemaphoreValues = &signalValue;
+
+	vk::SubmitInfo submitInfo;
+	submitInfo.pNext = &timelineInfo;
+	submitInfo.commandBufferCount = 1;
+	submitInfo.pCommandBuffers = &commandBuffer;
+	submitInfo.signalSemaphoreCount = 1;
+	submitInfo.pSignalSemaphores = &timeline.semaphore;
+
+	try {
+		queue.submit(submitInfo, nullptr);
+		timeline.mark_submitted(signalValue);
+	}
+	catch (vk::SystemError err) {
+		if (debug) {
+			std::cout << "Failed to submit upload" << std::endl;
+		}
+		//nothing reads the staged data, its space comes back once the earlier uploads retire
+		stagingRing.close(timeline.last_submitted());
+		logicalDevice.freeCommandBuffers(commandPool, commandBuffer);
+		return 0;
+	}
+
+	unacquiredValue = signalValue;
+	stagingRing.close(signalValue);
+
+	//the command buffer can go once the copies have retired
+	vk::Device device = logicalDevice;
+	vk::CommandPool pool = commandPool;
+	timeline.defer([device, pool, commandBuffer]() {
+		device.freeCommandBuffers(pool, commandBuffer);
+	});
+
+	return signalValue;
+}
+
+uint64_t vkUtils::TransferSystem::submit(UploadBatch& batch) {
+	if (batch.empty()) {
+		return 0;
+	}
+
+	vk::CommandBuffer commandBuffer = begin();
+	size_t bufferAcquires = pendingBufferAcquires.size();
+	size_t imageAcquires = pendingImageAcquires.size();
+
+	vk::ImageSubresourceRange access;
+	access.aspectMask = vk::ImageAspectFlagBits::eColor;
+	access.baseMipLevel = 0;
+	access.levelCount = 1;
+	access.baseArrayLayer = 0;
+	access.layerCount = 1;
+
+	/*
+	typedef struct VkImageMemoryBarrier {
+		VkStructureType            sType;
+		const void* pNext;
+		VkAccessFlags              srcAccessMask;
+		VkAccessFlags              dstAccessMask;
+		VkImageLayout              oldLayout;
+		VkImageLayout              newLayout;
+		uint32_t                   srcQueueFamilyIndex;
+		uint32_t                   dstQueueFamilyIndex;
+		VkImage                    image;
+		VkImageSubresourceRange    subresourceRange;
+	} VkImageMemoryBarrier;
+	*/
+	vk::ImageMemoryBarrier toTransfer;
+	toTransfer.oldLayout = vk::ImageLayout::eUndefined;
+	toTransfer.newLayout = vk::ImageLayout::eTransferDstOptimal;
+	toTransfer.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	toTransfer.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	toTransfer.subresourceRange = access;
+	toTransfer.srcAccessMask = vk::AccessFlags();
+	toTransfer.dstAccessMask = vk::AccessFlagBits::eTransferWrite;
+
+	//every image starting its upload moves to transfer_dst_optimal under one barrier
+	std::vector<vk::ImageMemoryBarrier> toTransferBarriers;
+	for (const ImageUploadJob& job : batch.images) {
+		if (job.first) {
+			toTransfer.image = job.image;
+			toTransferBarriers.push_back(toTransfer);
+		}
+	}
+	if (!toTransferBarriers.empty()) {
+		commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTopOfPipe, vk::PipelineStageFlagBits::eTransfer, vk::DependencyFlags(), nullptr, nullptr, toTransferBarriers);
+	}
+
+	//then all the copies, back to back
+	std::vector<vk::BufferMemoryBarrier> bufferBarriers;
+	for (const BufferUploadJob& job : batch.buffers) {
+		vk::BufferCopy copyRegion;
+		copyRegion.srcOffset = job.srcOffset;
+		copyRegion.dstOffset = job.dstOffset;
+		copyRegion.size = job.size;
+		commandBuffer.copyBuffer(job.srcBuffer, job.dstBuffer.buffer, 1, &copyRegion);
+
+		if (job.last && dedicated()) {
+			/*
+			typedef struct VkBufferMemoryBarrier {
+				VkStructureType    sType;
+				const void*        pNext;
+				VkAccessFlags      srcAccessMask;
+				VkAccessFlags      dstAccessMask;
+				uint32_t           srcQueueFamilyIndex;
+				uint32_t           dstQueueFamilyIndex;
+				VkBuffer           buffer;
+				VkDeviceSize       offset;
+				VkDeviceSize       size;
+			} VkBufferMemoryBarrier;
+			*/
+			vk::BufferMemoryBarrier release;
+			release.srcAccessMask = vk::AccessFlagBits::eTransferWrite;
+			release.dstAccessMask = vk::AccessFlags();
+			release.srcQueueFamilyIndex = transferFamily;
+			release.dstQueueFamilyIndex = graphicsFamily;
+			release.buffer = job.dstBuffer.buffer;
+			release.offset = 0;
+			release.size = VK_WHOLE_SIZE;
+			bufferBarriers.push_back(release);
+
+			//the matching acquire, recorded later on the graphics queue
+			vk::BufferMemoryBarrier acquire = release;
+			acquire.srcAccessMask = vk::AccessFlags();
+			acquire.dstAccessMask = job.dstAccess;
+			pendingBufferAcquires.push_back(acquire);
+			pendingAcquireStages |= job.dstStage;
+		}
+	}
+
+	std::vector<vk::ImageMemoryBarrier> imageBarriers;
+	for (const ImageUploadJob& job : batch.images) {
+		/*
+		typedef struct VkBufferImageCopy {
+			VkDeviceSize                bufferOffset;
+			uint32_t                    bufferRowLength;
+			uint32_t                    bufferImageHeight;
+			VkImageSubresourceLayers    imageSubresource;
+			VkOffset3D                  imageOffset;
+			VkExtent3D                  imageExtent;
+		} VkBufferImageCopy;
+		*/
+		vk::BufferImageCopy copy;
+		copy.bufferOffset = job.srcOffset;
+		copy.bufferRowLength = 0;
+		copy.bufferImageHeight = 0;
+		copy.imageSubresource.aspectMask = vk::ImageAspectFlagBits::eColor;
+		copy.imageSubresource.mipLevel = 0;
+		copy.imageSubresource.baseArrayLayer = 0;
+		copy.imageSubresource.layerCount = 1;
+		copy.imageOffset = vk::Offset3D(0, job.firstRow, 0);
+		copy.imageExtent = vk::Extent3D(job.width, job.rowCount, 1);
+		commandBuffer.copyBufferToImage(job.srcBuffer, job.image, vk::ImageLayout::eTransferDstOptimal, copy);
+
+		if (!job.last) {
+			continue;
+		}
+
+		//the layout transition happens once, as part of the ownership transfer when there is one
+		vk::ImageMemoryBarrier toShader = toTransfer;
+		toShader.image = job.image;
+		toShader.oldLayout = vk::ImageLayout::eTransferDstOptimal;
+		toShader.newLayout = vk::ImageLayout::eShaderReadOnlyOptimal;
+		toShader.srcAccessMask = vk::AccessFlagBits::eTransferWrite;
+
+		if (dedicated()) {
+			toShader.dstAccessMask = vk::AccessFlags();
+			toShader.srcQueueFamilyIndex = transferFamily;
+			toShader.dstQueueFamilyIndex = graphicsFamily;
+
+			vk::ImageMemoryBarrier acquire = toShader;
+			acquire.srcAccessMask = vk::AccessFlags();
+			acquire.dstAccessMask = vk::AccessFlagBits::eShaderRead;
+			pendingImageAcquires.push_back(acquire);
+			pendingAcquireStages |= vk::PipelineStageFlagBits::eFragmentShader;
+		}
+		else {
+			toShader.dstAccessMask = vk::AccessFlagBits::eShaderRead;
+		}
+		imageBarriers.push_back(toShader);
+	}
+
+	//and one barrier to hand everything over
+	if (!bufferBarriers.empty() || !imageBarriers.empty()) {
+		vk::PipelineStageFlags dstStage = dedicated() ?
+			vk::PipelineStageFlags(vk::PipelineStageFlagBits::eBottomOfPipe) : vk::PipelineStageFlags(vk::PipelineStageFlagBits::eFragmentShader);
+		commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, dstStage, vk::DependencyFlags(), nullptr, bufferBarriers, imageBarriers);
+	}
+
+	batch.buffers.clear();
+	batch.images.clear();
+
+	uint64_t token = finish(commandBuffer);
+	if (!token) {
+		//nothing was released, so there is nothing to acquire
+		pendingBufferAcquires.resize(bufferAcquires);
+		pendingImageAcquires.resize(imageAcquires);
+	}
+	return token;
+}
+
+uint64_t vkUtils::TransferSystem::record_acquires(vk::CommandBuffer commandBuffer) {
+	timeline.collect();
+
+	if (!pendingBufferAcquires.empty() || !pendingImageAcquires.empty()) {
+		//source stage matches the stage the submission waits on the upload timeline at
+		commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eAllCommands, pendingAcquireStages, vk::DependencyFlags(), nullptr, pendingBufferAcquires, pendingImageAcquires);
+		pendingBufferAcquires.clear();
+		pendingImageAcquires.clear();
+		pendingAcquireStages = vk::PipelineStageFlags();
+	}
+
+	uint64_t waitValue = unacquiredValue;
+	unacquiredValue = 0;
+	return waitValue;
+}
\ No newline at end of file
@@ -0,0 +1,158 @@
+#pragma once
+#include "config.h"
+#include "timeline.h"
+#include "staging_ring.h"
+
+namespace vkUtils {
+
+	class TransferSystem;
+
+	/*
+		A copy from the staging ring into a buffer
+	*/
+	struct BufferUploadJob {
+		vk::Buffer srcBuffer;
+		vk::DeviceSize srcOffset;
+		Buffer dstBuffer;
+		vk::DeviceSize dstOffset;
+		vk::DeviceSize size;
+		vk::PipelineStageFlags dstStage;
+		vk::AccessFlags dstAccess;
+		//the final piece of the buffer's upload, which hands the buffer over
+		bool last;
+	};
+
+	/*
+		A copy from the staging ring into a band of rows of a 2D color image, which is left shader readable
+	*/
+	struct ImageUploadJob {
+		vk::Buffer srcBuffer;
+		vk::DeviceSize srcOffset;
+		vk::Image image;
+		int width, height;
+		int firstRow, rowCount;
+		//the first piece moves the image to transfer_dst_optimal, the last hands it over
+		bool first, last;
+	};
+
+	/**
+		Any number of uploads, recorded into a single command buffer with merged barriers and submitted once.
+		Data is staged through the transfer system's ring. If the ring fills up with this batch's own data,
+		what has been collected so far is submitted early so that the space can be recycled,
+		which is why only one batch should be staging at a time.
+	*/
+	class UploadBatch {
+	public:
+		std::vector<BufferUploadJob> buffers;
+		std::vector<ImageUploadJob> images;
+
+		UploadBatch(TransferSystem* transfer);
+
+		/*
+			Reserve staging space for data the caller writes and then copies with copy_buffer or copy_image.
+			\param size must not be more than the capacity of the staging ring
+		*/
+		StagingRange reserve(vk::DeviceSize size);
+
+		void copy_buffer(const StagingRange& src, Buffer dstBuffer, vk::DeviceSize dstOffset, vk::PipelineStageFlags dstStage, vk::AccessFlags dstAccess, bool last);
+		void copy_image(const StagingRange& src, vk::Image image, int width, int height, int firstRow, int rowCount, bool first, bool last);
+
+		/*
+			Stage and copy data of any size into a buffer, in pieces if it doesn't fit the ring.
+		*/
+		void stage_buffer(const void* data, vk::DeviceSize size, Buffer dstBuffer, vk::PipelineStageFlags dstStage, vk::AccessFlags dstAccess);
+
+		/*
+			Stage and copy rgba8 pixels of any size into an image, in bands of rows if they don't fit the ring.
+		*/
+		void stage_image(const void* pixels, vk::Image image, int width, int height);
+
+		/*
+			Submit whatever is left in the batch.
+			\returns the token of the final submission, 0 if there was nothing to submit
+		*/
+		uint64_t submit();
+
+		bool empty() const;
+
+		/*
+			\returns the size of the staging ring, the most a single reservation can take
+		*/
+		vk::DeviceSize capacity() const;
+
+	private:
+		TransferSystem* transfer;
+	};
+
+	/*
+		For making the transfer system
+	*/
+	struct TransferSystemInputChunk {
+		vk::Device logicalDevice;
+		vk::PhysicalDevice physicalDevice;
+		vk::Queue transferQueue;
+		uint32_t transferFamily;
+		uint32_t graphicsFamily;
+		vk::Semaphore timelineSemaphore;
+		MemoryAllocator* allocator;
+		vk::DeviceSize stagingSize;
+		bool debug;
+	};
+
+	/**
+		Uploads resources asynchronously on the transfer queue.
+		When uploads run on their own queue family, every upload releases ownership of its
+		destination and the renderer acquires it through record_acquires.
+		Each submission returns a token: the upload timeline value signalled once it has finished.
+	*/
+	class TransferSystem {
+	public:
+		Timeline timeline;
+		StagingRing stagingRing;
+
+		TransferSystem(TransferSystemInputChunk input);
+		~TransferSystem();
+
+		/*
+			Record and submit every upload in the batch, clearing it.
+			\param batch the uploads to submit
+			\returns the token of the batch, 0 if the batch was empty
+		*/
+		uint64_t submit(UploadBatch& batch);
+
+		/*
+			Record the acquire half of pending ownership transfers into a graphics command buffer,
+			this must be outside of a renderpass.
+			\returns the upload timeline value the graphics submission must wait for, 0 if there is none
+		*/
+		uint64_t record_acquires(vk::CommandBuffer commandBuffer);
+
+	private:
+		vk::Device logicalDevice;
+		vk::Queue queue;
+		uint32_t transferFamily, graphicsFamily;
+		bool debug;
+		vk::CommandPool commandPool;
+
+		//acquire barriers waiting to be recorded on the graphics queue
+		std::vector<vk::BufferMemoryBarrier> pendingBufferAcquires;
+		std::vector<vk::ImageMemoryBarrier> pendingImageAcquires;
+		vk::PipelineStageFlags pendingAcquireStages;
+
+		//latest upload which no graphics submission has waited for yet
+		uint64_t unacquiredValue{ 0 };
+
+		/*
+			\returns whether uploads need queue family ownership transfers
+		*/
+		bool dedicated() const;
+
+		vk::CommandBuffer begin();
+
+		/*
+			Submit a recorded upload, closing the staging ranges it reads
+			\returns the upload's token, 0 if the submit failed
+		*/
+		uint64_t finish(vk::CommandBuffer commandBuffer);
+	};
+}
\ No newline at end of file
@@ -0,0 +1,482 @@
+#include "transform_store.h"
+#include <chrono>
+#include <cstring>
+#include <random>
+
+//the AVX2 kernel uses FMA, which MSVC's /arch:AVX2 implies and GCC and Clang enable separately
+#if defined(__AVX2__) && (defined(__FMA__) || defined(_MSC_VER))
+#include <immintrin.h>
+#define TRANSFORM_KERNEL_AVX2
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define TRANSFORM_KERNEL_SSE
+#elif defined(__ARM_NEON) || defined(_M_ARM64)
+#include <arm_neon.h>
+#define TRANSFORM_KERNEL_NEON
+#endif
+
+size_t TransformStore::add(glm::vec3 position, glm::quat rotation, glm::vec3 scale) {
+	positionX.push_back(position.x);
+	positionY.push_back(position.y);
+	positionZ.push_back(position.z);
+	rotationX.push_back(rotation.x);
+	rotationY.push_back(rotation.y);
+	rotationZ.push_back(rotation.z);
+	rotationW.push_back(rotation.w);
+	scaleX.push_back(scale.x);
+	scaleY.push_back(scale.y);
+	scaleZ.push_back(scale.z);
+
+	size_t index = positionX.size() - 1;
+	instanceVersions.push_back(0);
+	if (index / blockSize >= blockVersions.size()) {
+		blockVersions.push_back(0);
+	}
+	mark_changed(index);
+	return index;
+}
+
+size_t TransformStore::size() const {
+	return positionX.size();
+}
+
+void TransformStore::reserve(size_t count) {
+	for (Column<float>* component : { &positionX, &positionY, &positionZ,
+		&rotationX, &rotationY, &rotationZ, &rotationW, &scaleX, &scaleY, &scaleZ }) {
+		component->reserve(count);
+	}
+	instanceVersions.reserve(count);
+	blockVersions.reserve((count + blockSize - 1) / blockSize);
+}
+
+void TransformStore::view(float* const* components, size_t count) {
+	Column<float>* columns[] = { &positionX, &positionY, &positionZ,
+		&rotationX, &rotationY, &rotationZ, &rotationW, &scaleX, &scaleY, &scaleZ };
+	for (size_t i = 0; i < componentCount; ++i) {
+		columns[i]->view(components[i], count);
+	}
+
+	//everything arrives as a single change
+	++currentVersion;
+	instanceVersions.assign(count, currentVersion);
+	blockVersions.assign((count + blockSize - 1) / blockSize, currentVersion);
+}
+
+std::array<const Column<float>*, TransformStore::componentCount> TransformStore::components() const {
+	return { &positionX, &positionY, &positionZ, &rotationX, &rotationY, &rotationZ, &rotationW, &scaleX, &scaleY, &scaleZ };
+}
+
+void TransformStore::set_position(size_t index, glm::vec3 position) {
+	positionX[index] = position.x;
+	positionY[index] = position.y;
+	positionZ[index] = position.z;
+	mark_changed(index);
+}
+
+void TransformStore::set_rotation(size_t index, glm::quat rotation) {
+	rotationX[index] = rotation.x;
+	rotationY[index] = rotation.y;
+	rotationZ[index] = rotation.z;
+	rotationW[index] = rotation.w;
+	mark_changed(index);
+}
+
+void TransformStore::set_scale(size_t index, glm::vec3 scale) {
+	scaleX[index] = scale.x;
+	scaleY[index] = scale.y;
+	scaleZ[index] = scale.z;
+	mark_changed(index);
+}
+
+void TransformStore::mark_changed(size_t index) {
+	//every change gets its own version, so a reader at any version can tell what it missed
+	instanceVersions[index] = ++currentVersion;
+	blockVersions[index / blockSize] = currentVersion;
+}
+
+uint64_t TransformStore::version() const {
+	return currentVersion;
+}
+
+void TransformStore::changed_blocks(uint64_t since, std::vector<uint32_t>& blocks) const {
+	blocks.clear();
+	for (size_t block = 0; block < blockVersions.size(); ++block) {
+		if (blockVersions[block] > since) {
+			blocks.push_back(static_cast<uint32_t>(block));
+		}
+	}
+}
+
+size_t TransformStore::write_changed_world_matrices(glm::mat4* out, uint64_t since, const uint32_t* blocks, size_t blockCount) const {
+	size_t written = 0;
+	size_t runFirst = 0, runLast = 0;
+	for (size_t i = 0; i < blockCount; ++i) {
+		size_t first = blocks[i] * blockSize;
+		size_t last = std::min(size(), first + blockSize);
+		for (size_t instance = first; instance < last; ++instance) {
+			if (instanceVersions[instance] <= since) {
+				continue;
+			}
+			//changed instances are written in runs, which can span blocks
+			if (instance != runLast) {
+				write_world_matrices(out, runFirst, runLast);
+				written += runLast - runFirst;
+				runFirst = instance;
+			}
+			runLast = instance + 1;
+		}
+	}
+	write_world_matrices(out, runFirst, runLast);
+	written += runLast - runFirst;
+	return written;
+}
+
+void TransformStore::write_world_matrices_scalar(glm::mat4* out, size_t first, size_t last) const {
+	for (size_t i = first; i < last; ++i) {
+		float x = rotationX[i], y = rotationY[i], z = rotationZ[i], w = rotationW[i];
+		float xx = x * x, yy = y * y, zz = z * z;
+		float xy = x * y, xz = x * z, yz = y * z;
+		float wx = w * x, wy = w * y, wz = w * z;
+
+		//columns of the rotation, each scaled by its axis
+		float* m = &out[i][0][0];
+		m[0] = (1.0f - 2.0f * (yy + zz)) * scaleX[i];
+		m[1] = 2.0f * (xy + wz) * scaleX[i];
+		m[2] = 2.0f * (xz - wy) * scaleX[i];
+		m[3] = 0.0f;
+		m[4] = 2.0f * (xy - wz) * scaleY[i];
+		m[5] = (1.0f - 2.0f * (xx + zz)) * scaleY[i];
+		m[6] = 2.0f * (yz + wx) * scaleY[i];
+		m[7] = 0.0f;
+		m[8] = 2.0f * (xz + wy) * scaleZ[i];
+		m[9] = 2.0f * (yz - wx) * scaleZ[i];
+		m[10] = (1.0f - 2.0f * (xx + yy)) * scaleZ[i];
+		m[11] = 0.0f;
+		m[12] = positionX[i];
+		m[13] = positionY[i];
+		m[14] = positionZ[i];
+		m[15] = 1.0f;
+	}
+}
+
+#if defined(TRANSFORM_KERNEL_AVX2)
+
+namespace {
+	/*
+		Transpose the 4x4 blocks in each 128 bit half, so lane k of a..d becomes
+		one column of instance k (low half) and instance k + 4 (high half)
+	*/
+	inline void store_columns(float* out, size_t column, __m256 a, __m256 b, __m256 c, __m256 d) {
+		__m256 t0 = _mm256_unpacklo_ps(a, b);
+		__m256 t1 = _mm256_unpacklo_ps(c, d);
+		__m256 t2 = _mm256_unpackhi_ps(a, b);
+		__m256 t3 = _mm256_unpackhi_ps(c, d);
+		__m256 r0 = _mm256_shuffle_ps(t0, t1, _MM_SHUFFLE(1, 0, 1, 0));
+		__m256 r1 = _mm256_shuffle_ps(t0, t1, _MM_SHUFFLE(3, 2, 3, 2));
+		__m256 r2 = _mm256_shuffle_ps(t2, t3, _MM_SHUFFLE(1, 0, 1, 0));
+		__m256 r3 = _mm256_shuffle_ps(t2, t3, _MM_SHUFFLE(3, 2, 3, 2));
+
+		//every matrix is 64 bytes, streaming keeps write-combined memory out of the cache
+		float* base = out + column * 4;
+		_mm_stream_ps(base + 0 * 16, _mm256_castps256_ps128(r0));
+		_mm_stream_ps(base + 1 * 16, _mm256_castps256_ps128(r1));
+		_mm_stream_ps(base + 2 * 16, _mm256_castps256_ps128(r2));
+		_mm_stream_ps(base + 3 * 16, _mm256_castps256_ps128(r3));
+		_mm_stream_ps(base + 4 * 16, _mm256_extractf128_ps(r0, 1));
+		_mm_stream_ps(base + 5 * 16, _mm256_extractf128_ps(r1, 1));
+		_mm_stream_ps(base + 6 * 16, _mm256_extractf128_ps(r2, 1));
+		_mm_stream_ps(base + 7 * 16, _mm256_extractf128_ps(r3, 1));
+	}
+}
+
+void TransformStore::write_world_matrices(glm::mat4* out, size_t first, size_t last) const {
+	//streaming stores need 16 byte alignment, which device memory always has
+	size_t i = first;
+	if (reinterpret_cast<uintptr_t>(out) % 16 == 0) {
+		const __m256 one = _mm256_set1_ps(1.0f);
+		const __m256 two = _mm256_set1_ps(2.0f);
+		const __m256 zero = _mm256_setzero_ps();
+
+		for (; i + 8 <= last; i += 8) {
+			__m256 x = _mm256_loadu_ps(&rotationX[i]);
+			__m256 y = _mm256_loadu_ps(&rotationY[i]);
+			__m256 z = _mm256_loadu_ps(&rotationZ[i]);
+			__m256 w = _mm256_loadu_ps(&rotationW[i]);
+			__m256 sx = _mm256_loadu_ps(&scaleX[i]);
+			__m256 sy = _mm256_loadu_ps(&scaleY[i]);
+			__m256 sz = _mm256_loadu_ps(&scaleZ[i]);
+
+			__m256 xx = _mm256_mul_ps(x, x), yy = _mm256_mul_ps(y, y), zz = _mm256_mul_ps(z, z);
+			__m256 xy = _mm256_mul_ps(x, y), xz = _mm256_mul_ps(x, z), yz = _mm256_mul_ps(y, z);
+			__m256 wx = _mm256_mul_ps(w, x), wy = _mm256_mul_ps(w, y), wz = _mm256_mul_ps(w, z);
+
+			float* m = &out[i][0][0];
+			store_columns(m, 0,
+				_mm256_mul_ps(_mm256_fnmadd_ps(two, _mm256_add_ps(yy, zz), one), sx),
+				_mm256_mul_ps(_mm256_mul_ps(two, _mm256_add_ps(xy, wz)), sx),
+				_mm256_mul_ps(_mm256_mul_ps(two, _mm256_sub_ps(xz, wy)), sx),
+				zero);
+			store_columns(m, 1,
+				_mm256_mul_ps(_mm256_mul_ps(two, _mm256_sub_ps(xy, wz)), sy),
+				_mm256_mul_ps(_mm256_fnmadd_ps(two, _mm256_add_ps(xx, zz), one), sy),
+				_mm256_mul_ps(_mm256_mul_ps(two, _mm256_add_ps(yz, wx)), sy),
+				zero);
+			store_columns(m, 2,
+				_mm256_mul_ps(_mm256_mul_ps(two, _mm256_add_ps(xz, wy)), sz),
+				_mm256_mul_ps(_mm256_mul_ps(two, _mm256_sub_ps(yz, wx)), sz),
+				_mm256_mul_ps(_mm256_fnmadd_ps(two, _mm256_add_ps(xx, yy), one), sz),
+				zero);
+			store_columns(m, 3,
+				_mm256_loadu_ps(&positionX[i]),
+				_mm256_loadu_ps(&positionY[i]),
+				_mm256_loadu_ps(&positionZ[i]),
+				one);
+		}
+		_mm_sfence();
+	}
+	write_world_matrices_scalar(out, i, last);
+}
+
+const char* TransformStore::kernel_name() {
+	return "AVX2";
+}
+
+#elif defined(TRANSFORM_KERNEL_SSE)
+
+namespace {
+	/*
+		Transpose so lane k of a..d becomes one column of instance k
+	*/
+	inline void store_columns(float* out, size_t column, __m128 a, __m128 b, __m128 c, __m128 d) {
+		_MM_TRANSPOSE4_PS(a, b, c, d);
+
+		//every matrix is 64 bytes, streaming keeps write-combined memory out of the cache
+		float* base = out + column * 4;
+		_mm_stream_ps(base + 0 * 16, a);
+		_mm_stream_ps(base + 1 * 16, b);
+		_mm_stream_ps(base + 2 * 16, c);
+		_mm_stream_ps(base + 3 * 16, d);
+	}
+}
+
+void TransformStore::write_world_matrices(glm::mat4* out, size_t first, size_t last) const {
+	//streaming stores need 16 byte alignment, which device memory always has
+	size_t i = first;
+	if (reinterpret_cast<uintptr_t>(out) % 16 == 0) {
+		const __m128 one = _mm_set1_ps(1.0f);
+		const __m128 two = _mm_set1_ps(2.0f);
+		const __m128 zero = _mm_setzero_ps();
+
+		for (; i + 4 <= last; i += 4) {
+			__m128 x = _mm_loadu_ps(&rotationX[i]);
+			__m128 y = _mm_loadu_ps(&rotationY[i]);
+			__m128 z = _mm_loadu_ps(&rotationZ[i]);
+			__m128 w = _mm_loadu_ps(&rotationW[i]);
+			__m128 sx = _mm_loadu_ps(&scaleX[i]);
+			__m128 sy = _mm_loadu_ps(&scaleY[i]);
+			__m128 sz = _mm_loadu_ps(&scaleZ[i]);
+
+			__m128 xx = _mm_mul_ps(x, x), yy = _mm_mul_ps(y, y), zz = _mm_mul_ps(z, z);
+			__m128 xy = _mm_mul_ps(x, y), xz = _mm_mul_ps(x, z), yz = _mm_mul_ps(y, z);
+			__m128 wx = _mm_mul_ps(w, x), wy = _mm_mul_ps(w, y), wz = _mm_mul_ps(w, z);
+
+			float* m = &out[i][0][0];
+			store_columns(m, 0,
+				_mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(yy, zz))), sx),
+				_mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(xy, wz)), sx),
+				_mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(xz, wy)), sx),
+				zero);
+			store_columns(m, 1,
+				_mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(xy, wz)), sy),
+				_mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, zz))), sy),
+				_mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(yz, wx)), sy),
+				zero);
+			store_columns(m, 2,
+				_mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(xz, wy)), sz),
+				_mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(yz, wx)), sz),
+				_mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, yy))), sz),
+				zero);
+			store_columns(m, 3,
+				_mm_loadu_ps(&positionX[i]),
+				_mm_loadu_ps(&positionY[i]),
+				_mm_loadu_ps(&positionZ[i]),
+				one);
+		}
+		_mm_sfence();
+	}
+	write_world_matrices_scalar(out, i, last);
+}
+
+const char* TransformStore::kernel_name() {
+	return "SSE";
+}
+
+#elif defined(TRANSFORM_KERNEL_NEON)
+
+namespace {
+	/*
+		Transpose so lane k of a..d becomes one column of instance k
+	*/
+	inline void store_columns(float* out, size_t column, float32x4_t a, float32x4_t b, float32x4_t c, float32x4_t d) {
+		float32x4x2_t ac = vzipq_f32(a, c);
+		float32x4x2_t bd = vzipq_f32(b, d);
+		float32x4x2_t low = vzipq_f32(ac.val[0], bd.val[0]);
+		float32x4x2_t high = vzipq_f32(ac.val[1], bd.val[1]);
+
+		float* base = out + column * 4;
+		vst1q_f32(base + 0 * 16, low.val[0]);
+		vst1q_f32(base + 1 * 16, low.val[1]);
+		vst1q_f32(base + 2 * 16, high.val[0]);
+		vst1q_f32(base + 3 * 16, high.val[1]);
+	}
+}
+
+void TransformStore::write_world_matrices(glm::mat4* out, size_t first, size_t last) const {
+	const float32x4_t one = vdupq_n_f32(1.0f);
+	const float32x4_t two = vdupq_n_f32(2.0f);
+	const float32x4_t zero = vdupq_n_f32(0.0f);
+
+	size_t i = first;
+	for (; i + 4 <= last; i += 4) {
+		float32x4_t x = vld1q_f32(&rotationX[i]);
+		float32x4_t y = vld1q_f32(&rotationY[i]);
+		float32x4_t z = vld1q_f32(&rotationZ[i]);
+		float32x4_t w = vld1q_f32(&rotationW[i]);
+		float32x4_t sx = vld1q_f32(&scaleX[i]);
+		float32x4_t sy = vld1q_f32(&scaleY[i]);
+		float32x4_t sz = vld1q_f32(&scaleZ[i]);
+
+		float32x4_t xx = vmulq_f32(x, x), yy = vmulq_f32(y, y), zz = vmulq_f32(z, z);
+		float32x4_t xy = vmulq_f32(x, y), xz = vmulq_f32(x, z), yz = vmulq_f32(y, z);
+		float32x4_t wx = vmulq_f32(w, x), wy = vmulq_f32(w, y), wz = vmulq_f32(w, z);
+
+		float* m = &out[i][0][0];
+		store_columns(m, 0,
+			vmulq_f32(vmlsq_f32(one, two, vaddq_f32(yy, zz)), sx),
+			vmulq_f32(vmulq_f32(two, vaddq_f32(xy, wz)), sx),
+			vmulq_f32(vmulq_f32(two, vsubq_f32(xz, wy)), sx),
+			zero);
+		store_columns(m, 1,
+			vmulq_f32(vmulq_f32(two, vsubq_f32(xy, wz)), sy),
+			vmulq_f32(vmlsq_f32(one, two, vaddq_f32(xx, zz)), sy),
+			vmulq_f32(vmulq_f32(two, vaddq_f32(yz, wx)), sy),
+			zero);
+		store_columns(m, 2,
+			vmulq_f32(vmulq_f32(two, vaddq_f32(xz, wy)), sz),
+			vmulq_f32(vmulq_f32(two, vsubq_f32(yz, wx)), sz),
+			vmulq_f32(vmlsq_f32(one, two, vaddq_f32(xx, yy)), sz),
+			zero);
+		store_columns(m, 3,
+			vld1q_f32(&positionX[i]),
+			vld1q_f32(&positionY[i]),
+			vld1q_f32(&positionZ[i]),
+			one);
+	}
+	write_world_matrices_scalar(out, i, last);
+}
+
+const char* TransformStore::kernel_name() {
+	return "NEON";
+}
+
+#else
+
+void TransformStore::write_world_matrices(glm::mat4* out, size_t first, size_t last) const {
+	write_world_matrices_scalar(out, first, last);
+}
+
+const char* TransformStore::kernel_name() {
+	return "scalar";
+}
+
+#endif
+
+void benchmark_transforms(size_t instanceCount) {
+	using clock = std::chrono::steady_clock;
+
+	if (instanceCount == 0) {
+		std::cout << "No instances, nothing to benchmark" << std::endl;
+		return;
+	}
+
+	std::mt19937 generator(12);
+	std::uniform_real_distribution<float> distribution(-1.0f, 1.0f);
+
+	TransformStore store;
+	store.reserve(instanceCount);
+	std::vector<glm::vec3> positions;
+	positions.reserve(instanceCount);
+	for (size_t i = 0; i < instanceCount; ++i) {
+		glm::vec3 position(distribution(generator), distribution(generator), distribution(generator));
+		glm::quat rotation = glm::normalize(glm::quat(distribution(generator), distribution(generator), distribution(generator), distribution(generator)));
+		positions.push_back(position);
+		store.add(position, rotation, glm::vec3(1.0f + distribution(generator)));
+	}
+
+	//stands in for the mapped instance buffer
+	std::vector<glm::mat4> staged(instanceCount);
+	std::vector<glm::mat4> destination(instanceCount);
+	std::vector<glm::mat4> reference(instanceCount);
+
+	const int repeats = 10;
+	auto time = [&](auto&& job) {
+		double best = 1e30;
+		for (int r = 0; r < repeats; ++r) {
+			clock::time_point start = clock::now();
+			job();
+			best = std::min(best, std::chrono::duration<double, std::milli>(clock::now() - start).count());
+		}
+		return best;
+	};
+
+	//what prepare_frame used to do: translate into a vector, then copy the lot
+	double glmTime = time([&]() {
+		for (size_t i = 0; i < instanceCount; ++i) {
+			staged[i] = glm::translate(glm::mat4(1.0f), positions[i]);
+		}
+		memcpy(destination.data(), staged.data(), instanceCount * sizeof(glm::mat4));
+	});
+	double scalarTime = time([&]() { store.write_world_matrices_scalar(reference.data(), 0, instanceCount); });
+	double simdTime = time([&]() { store.write_world_matrices(destination.data(), 0, instanceCount); });
+
+	float maxError = 0.0f;
+	for (size_t i = 0; i < instanceCount; ++i) {
+		for (int c = 0; c < 4; ++c) {
+			for (int r = 0; r < 4; ++r) {
+				maxError = std::max(maxError, std::abs(reference[i][c][r] - destination[i][c][r]));
+			}
+		}
+	}
+
+	//a mostly static scene, where one instance in a hundred moves per frame
+	std::vector<uint32_t> blocks;
+	size_t moving = std::max<size_t>(1, instanceCount / 100);
+	std::uniform_int_distribution<size_t> pick(0, instanceCount - 1);
+	size_t changedWritten = 0;
+	double changedTime = time([&]() {
+		uint64_t since = store.version();
+		for (size_t i = 0; i < moving; ++i) {
+			size_t index = pick(generator);
+			store.set_position(index, glm::vec3(distribution(generator), distribution(generator), distribution(generator)));
+		}
+		store.changed_blocks(since, blocks);
+		changedWritten = store.write_changed_world_matrices(destination.data(), since, blocks.data(), blocks.size());
+	});
+	store.write_world_matrices_scalar(reference.data(), 0, instanceCount);
+	float changedError = 0.0f;
+	for (size_t i = 0; i < instanceCount; ++i) {
+		for (int c = 0; c < 4; ++c) {
+			for (int r = 0; r < 4; ++r) {
+				changedError = std::max(changedError, std::abs(reference[i][c][r] - destination[i][c][r]));
+			}
+		}
+	}
+
+	std::cout << "Transforms for " << instanceCount << " instances, best of " << repeats << ":\n"
+		<< "  glm translate + memcpy: " << glmTime << " ms (translation only)\n"
+		<< "  scalar TRS:             " << scalarTime << " ms\n"
+		<< "  " << TransformStore::kernel_name() << " TRS:" << std::string(std::max(0, 19 - static_cast<int>(strlen(TransformStore::kernel_name()))), ' ')
+		<< simdTime << " ms, max difference from scalar " << maxError << "\n"
+		<< "  1% moved, changes only: " << changedTime << " ms, " << changedWritten * sizeof(glm::mat4) << " of "
+		<< instanceCount * sizeof(glm::mat4) << " bytes written, max difference " << changedError << std::endl;
+}
\ No newline at end of file
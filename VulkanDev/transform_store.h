@@ -0,0 +1,188 @@
+#pragma once
+#include "config.h"
+#include <glm/gtc/quaternion.hpp>
+#include <array>
+
+/**
+	One array of a structure of arrays. It either owns its storage or views memory owned elsewhere,
+	like a mapped file, and growing a view copies it into storage of its own first.
+*/
+template<typename T>
+class Column {
+public:
+	Column() = default;
+	Column(Column&&) = default;
+	Column& operator=(Column&&) = default;
+
+	Column(const Column& other) {
+		*this = other;
+	}
+
+	Column& operator=(const Column& other) {
+		storage = other.storage;
+		items = other.viewing ? other.items : storage.data();
+		count = other.count;
+		viewing = other.viewing;
+		return *this;
+	}
+
+	T& operator[](size_t i) {
+		return items[i];
+	}
+
+	const T& operator[](size_t i) const {
+		return items[i];
+	}
+
+	T* data() {
+		return items;
+	}
+
+	const T* data() const {
+		return items;
+	}
+
+	size_t size() const {
+		return count;
+	}
+
+	void push_back(const T& value) {
+		own();
+		storage.push_back(value);
+		sync();
+	}
+
+	void reserve(size_t capacity) {
+		own();
+		storage.reserve(capacity);
+		sync();
+	}
+
+	/*
+		Use size items at data in place of the column's own storage, which is freed
+	*/
+	void view(T* data, size_t size) {
+		storage = std::vector<T>();
+		items = data;
+		count = size;
+		viewing = true;
+	}
+
+private:
+	std::vector<T> storage;
+	T* items{ nullptr };
+	size_t count{ 0 };
+	bool viewing{ false };
+
+	void own() {
+		if (viewing) {
+			storage.assign(items, items + count);
+			viewing = false;
+		}
+	}
+
+	void sync() {
+		items = storage.data();
+		count = storage.size();
+	}
+};
+
+/**
+	Instance transforms kept as a structure of arrays, one array per component,
+	so that world matrices can be built several instances at a time.
+	Every change is stamped with a version number, per instance and per block of instances,
+	so each copy of the world matrices only needs rewriting where it changed since it was last written.
+	Write through the setters, or call mark_changed after writing the arrays directly.
+*/
+class TransformStore {
+public:
+	//instances per dirty-tracking block, 4 KiB of world matrices
+	static constexpr size_t blockSize = 64;
+
+	//position xyz, rotation xyzw and scale xyz, the order view and scene files use
+	static constexpr size_t componentCount = 10;
+
+	Column<float> positionX, positionY, positionZ;
+	Column<float> rotationX, rotationY, rotationZ, rotationW;
+	Column<float> scaleX, scaleY, scaleZ;
+
+	//version of the latest change to each instance, and to anything in each block
+	std::vector<uint64_t> instanceVersions;
+	std::vector<uint64_t> blockVersions;
+
+	/*
+		\returns the index of the new instance
+	*/
+	size_t add(glm::vec3 position, glm::quat rotation = glm::quat(1.0f, 0.0f, 0.0f, 0.0f), glm::vec3 scale = glm::vec3(1.0f));
+
+	size_t size() const;
+
+	void reserve(size_t count);
+
+	/*
+		Point every component at memory owned elsewhere, like a mapped scene file, replacing what the store held.
+		The memory must outlive the store's use of it and is written to by the setters,
+		adding instances copies the components into the store's own storage first.
+		Every instance counts as changed.
+		\param components one array of count floats per component, in componentCount order
+	*/
+	void view(float* const* components, size_t count);
+
+	/*
+		\returns the arrays of every component, in componentCount order
+	*/
+	std::array<const Column<float>*, componentCount> components() const;
+
+	void set_position(size_t index, glm::vec3 position);
+	void set_rotation(size_t index, glm::quat rotation);
+	void set_scale(size_t index, glm::vec3 scale);
+
+	void mark_changed(size_t index);
+
+	/*
+		\returns the version of the latest change, never 0 once anything has been added
+	*/
+	uint64_t version() const;
+
+	/*
+		Collect the blocks changed after a version, in ascending order.
+		\param since the version the caller's copy is up to date with, 0 for all blocks
+		\param blocks cleared, then filled with block indices
+	*/
+	void changed_blocks(uint64_t since, std::vector<uint32_t>& blocks) const;
+
+	/*
+		Rebuild the world matrices of the instances changed after a version, within some blocks.
+		\param out the copy to update, indexed like the store
+		\param since the version out is up to date with
+		\param blocks blocks from changed_blocks, in ascending order
+		\param blockCount the number of blocks
+		\returns the number of matrices written
+	*/
+	size_t write_changed_world_matrices(glm::mat4* out, uint64_t since, const uint32_t* blocks, size_t blockCount) const;
+
+	/*
+		Build translation * rotation * scale for instances [first, last) into out[first, last),
+		with the widest SIMD kernel the build targets. out is usually mapped device memory.
+	*/
+	void write_world_matrices(glm::mat4* out, size_t first, size_t last) const;
+
+	/*
+		The same as write_world_matrices, one instance at a time.
+	*/
+	void write_world_matrices_scalar(glm::mat4* out, size_t first, size_t last) const;
+
+	/*
+		\returns the name of the kernel write_world_matrices uses
+	*/
+	static const char* kernel_name();
+
+private:
+	uint64_t currentVersion{ 0 };
+};
+
+/*
+	Time the old glm translate loop against the scalar and SIMD kernels, and print the results.
+	\param instanceCount the number of transforms to build
+*/
+void benchmark_transforms(size_t instanceCount);
\ No newline at end of file
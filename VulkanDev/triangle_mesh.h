@@ -7,10 +7,11 @@
 */
 class TriangleMesh {
 public:
-	TriangleMesh(vk::Device logicalDevice, vk::PhysicalDevice phyiscalDevice);
+	TriangleMesh(vk::Device logicalDevice, vk::PhysicalDevice phyiscalDevice, vkUtils::MemoryAllocator* allocator);
 	~TriangleMesh();
 	Buffer vertexBuffer;
 
 private:
 	vk::Device logicalDevice;
+	vkUtils::MemoryAllocator* allocator;
 };
\ No newline at end of file
@@ -0,0 +1,170 @@
+#include "vertex_layout.h"
+#include <glm/gtc/packing.hpp>
+#include <cstring>
+
+namespace {
+	uint32_t component_size(vkMesh::AttributeFormat format) {
+		switch (format) {
+		case vkMesh::AttributeFormat::float32:
+			return 4;
+		case vkMesh::AttributeFormat::unorm8:
+			return 1;
+		default:
+			return 2;
+		}
+	}
+
+	uint32_t stored_components(vkMesh::AttributeFormat format, uint32_t components) {
+		//three component formats other than float32 are rarely supported for vertex fetch
+		if (components == 3 && format != vkMesh::AttributeFormat::float32) {
+			return 4;
+		}
+		return components;
+	}
+
+	uint32_t attribute_size(vkMesh::AttributeFormat format, uint32_t components) {
+		return component_size(format) * stored_components(format, components);
+	}
+
+	vk::Format attribute_format(vkMesh::AttributeFormat format, uint32_t components) {
+		switch (format) {
+		case vkMesh::AttributeFormat::float32:
+			return components == 2 ? vk::Format::eR32G32Sfloat : vk::Format::eR32G32B32Sfloat;
+		case vkMesh::AttributeFormat::float16:
+			return components == 2 ? vk::Format::eR16G16Sfloat : vk::Format::eR16G16B16A16Sfloat;
+		case vkMesh::AttributeFormat::snorm16:
+			return components == 2 ? vk::Format::eR16G16Snorm : vk::Format::eR16G16B16A16Snorm;
+		case vkMesh::AttributeFormat::unorm16:
+			return components == 2 ? vk::Format::eR16G16Unorm : vk::Format::eR16G16B16A16Unorm;
+		default:
+			return components == 2 ? vk::Format::eR8G8Unorm : vk::Format::eR8G8B8A8Unorm;
+		}
+	}
+
+	/*
+		Write the components of an attribute, padding components are written as 1.
+		\returns where the next attribute goes
+	*/
+	uint8_t* encode_attribute(vkMesh::AttributeFormat format, const float* values, uint32_t components, uint8_t* out) {
+		uint32_t stored = stored_components(format, components);
+		for (uint32_t i = 0; i < stored; ++i) {
+			float value = i < components ? values[i] : 1.0f;
+			switch (format) {
+			case vkMesh::AttributeFormat::float32:
+				memcpy(out, &value, 4);
+				out += 4;
+				break;
+			case vkMesh::AttributeFormat::float16: {
+				uint16_t half = glm::packHalf1x16(value);
+				memcpy(out, &half, 2);
+				out += 2;
+				break;
+			}
+			case vkMesh::AttributeFormat::snorm16: {
+				uint16_t snorm = glm::packSnorm1x16(value);
+				memcpy(out, &snorm, 2);
+				out += 2;
+				break;
+			}
+			case vkMesh::AttributeFormat::unorm16: {
+				uint16_t unorm = glm::packUnorm1x16(value);
+				memcpy(out, &unorm, 2);
+				out += 2;
+				break;
+			}
+			case vkMesh::AttributeFormat::unorm8:
+				*out++ = glm::packUnorm1x8(value);
+				break;
+			}
+		}
+		return out;
+	}
+
+	bool parse_format(const std::string& name, vkMesh::AttributeFormat& format) {
+		const std::pair<const char*, vkMesh::AttributeFormat> formats[] = {
+			{ "float32", vkMesh::AttributeFormat::float32 },
+			{ "float16", vkMesh::AttributeFormat::float16 },
+			{ "snorm16", vkMesh::AttributeFormat::snorm16 },
+			{ "unorm16", vkMesh::AttributeFormat::unorm16 },
+			{ "unorm8", vkMesh::AttributeFormat::unorm8 }
+		};
+		for (const auto& candidate : formats) {
+			if (name == candidate.first) {
+				format = candidate.second;
+				return true;
+			}
+		}
+		return false;
+	}
+}
+
+vkMesh::VertexLayout vkMesh::VertexLayout::full_precision() {
+	VertexLayout layout;
+	layout.position = AttributeFormat::float32;
+	layout.color = AttributeFormat::float32;
+	layout.texCoord = AttributeFormat::float32;
+	return layout;
+}
+
+bool vkMesh::VertexLayout::parse(const std::string& text, VertexLayout& layout) {
+	if (text == "full") {
+		layout = full_precision();
+		return true;
+	}
+
+	std::stringstream stream(text);
+	std::string names[3];
+	VertexLayout parsed;
+	bool named = std::getline(stream, names[0], ',') && std::getline(stream, names[1], ',') && std::getline(stream, names[2], ',')
+		&& stream.eof()
+		&& parse_format(names[0], parsed.position) && parse_format(names[1], parsed.color) && parse_format(names[2], parsed.texCoord);
+	if (!named || !parsed.valid()) {
+		return false;
+	}
+	layout = parsed;
+	return true;
+}
+
+bool vkMesh::VertexLayout::valid() const {
+	return position != AttributeFormat::unorm16 && position != AttributeFormat::unorm8
+		&& (color == AttributeFormat::float32 || color == AttributeFormat::float16 || color == AttributeFormat::unorm8)
+		&& (texCoord == AttributeFormat::float32 || texCoord == AttributeFormat::float16 || texCoord == AttributeFormat::unorm16);
+}
+
+uint32_t vkMesh::VertexLayout::stride() const {
+	return tex_coord_offset() + attribute_size(texCoord, 2);
+}
+
+uint32_t vkMesh::VertexLayout::position_offset() const {
+	return 0;
+}
+
+uint32_t vkMesh::VertexLayout::color_offset() const {
+	return position_offset() + attribute_size(position, 2);
+}
+
+uint32_t vkMesh::VertexLayout::tex_coord_offset() const {
+	return color_offset() + attribute_size(color, 3);
+}
+
+vk::Format vkMesh::VertexLayout::position_format() const {
+	return attribute_format(position, 2);
+}
+
+vk::Format vkMesh::VertexLayout::color_format() const {
+	return attribute_format(color, 3);
+}
+
+vk::Format vkMesh::VertexLayout::tex_coord_format() const {
+	return attribute_format(texCoord, 2);
+}
+
+uint32_t vkMesh::VertexLayout::key() const {
+	return static_cast<uint32_t>(position) | static_cast<uint32_t>(color) << 8 | static_cast<uint32_t>(texCoord) << 16;
+}
+
+void vkMesh::VertexLayout::encode(const float* vertex, uint8_t* out) const {
+	out = encode_attribute(position, vertex, 2, out);
+	out = encode_attribute(color, vertex + 2, 3, out);
+	encode_attribute(texCoord, vertex + 5, 2, out);
+}
\ No newline at end of file
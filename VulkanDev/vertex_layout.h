@@ -0,0 +1,71 @@
+#pragma once
+#include "config.h"
+
+namespace vkMesh {
+
+	/*
+		How one attribute is stored, vertex fetch turns every one of them back into floats.
+		Three component attributes are padded to four components unless they're float32.
+	*/
+	enum class AttributeFormat : uint8_t {
+		float32,
+		float16,
+		//[-1, 1]
+		snorm16,
+		//[0, 1]
+		unorm16,
+		//[0, 1]
+		unorm8
+	};
+
+	/**
+		The storage of the (vec2 pos, vec3 color, vec2 texCoord) vertex format.
+		Meshes are consumed as floats and quantized to the layout as they're appended.
+	*/
+	struct VertexLayout {
+		//float32, float16 or snorm16, snorm16 is only for meshes within [-1, 1] since nothing rescales them
+		AttributeFormat position{ AttributeFormat::float16 };
+		//float32, float16 or unorm8
+		AttributeFormat color{ AttributeFormat::unorm8 };
+		//float32, float16 or unorm16
+		AttributeFormat texCoord{ AttributeFormat::float16 };
+
+		/*
+			\returns the layout with every attribute at full float precision, 28 bytes a vertex
+		*/
+		static VertexLayout full_precision();
+
+		/*
+			Read a layout written as its position, color and texCoord formats separated by commas,
+			like "float16,unorm8,float16", or "full" for full_precision.
+			\returns whether the text named a valid layout, the layout is only written if it did
+		*/
+		static bool parse(const std::string& text, VertexLayout& layout);
+
+		/*
+			\returns whether every attribute's format is one it can be stored in
+		*/
+		bool valid() const;
+
+		uint32_t stride() const;
+		uint32_t position_offset() const;
+		uint32_t color_offset() const;
+		uint32_t tex_coord_offset() const;
+
+		vk::Format position_format() const;
+		vk::Format color_format() const;
+		vk::Format tex_coord_format() const;
+
+		/*
+			\returns the three formats in one number, equal only for equal layouts
+		*/
+		uint32_t key() const;
+
+		/*
+			Quantize one vertex, values outside of a normalized format's range are clamped.
+			\param vertex the vertex as 7 floats
+			\param out receives stride() bytes
+		*/
+		void encode(const float* vertex, uint8_t* out) const;
+	};
+}
\ No newline at end of file
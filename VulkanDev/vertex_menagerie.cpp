@@ -1,88 +1,466 @@
 #include "vertex_menagerie.h"
+#include "mesh_archive.h"
+#include "mesh_optimizer.h"
+#include "mesh_simplifier.h"
+#include <cstring>
 
-VertexMenagerie::VertexMenagerie() {
+namespace {
+	uint64_t align_archive_offset(uint64_t offset) {
+		return (offset + meshArchiveAlignment - 1) / meshArchiveAlignment * meshArchiveAlignment;
+	}
+
+	/*
+		\returns the largest of count indices from first, 0 when there are none
+	*/
+	template <typename Index>
+	uint64_t max_index(const uint8_t* indices, uint64_t first, uint64_t count) {
+		const Index* begin = reinterpret_cast<const Index*>(indices) + first;
+		return count ? *std::max_element(begin, begin + count) : 0;
+	}
+}
+
+VertexMenagerie::VertexMenagerie(const vkMesh::VertexLayout& layout, bool optimizeMeshes, bool debug) {
 	indexOffset = 0;
+	this->layout = layout;
+	this->optimizeMeshes = optimizeMeshes;
+	this->debugMode = debug;
 }
 
-void VertexMenagerie::consume(meshTypes type, std::vector<float>& vertexData, std::vector<uint32_t>& indexData) {
+MeshRange VertexMenagerie::consume(std::vector<float>& vertexData, std::vector<uint32_t>& indexData) {
 
-	int indexCount = static_cast<int>(indexData.size());
-	int vertexCount = static_cast<int>(vertexData.size() / 7);
-	int lastIndex = static_cast<int>(indexLump.size());
+	if (optimizeMeshes) {
+		size_t inputVertices = vertexData.size() / floatsPerVertex;
+		vkMesh::VertexCacheStats before = vkMesh::analyze_vertex_cache(indexData, inputVertices, vertexCacheSize);
 
-	firstIndices.insert(std::make_pair(type, lastIndex));
-	indexCounts.insert(std::make_pair(type, indexCount));
+		//triangles for the vertex cache, then its clusters for overdraw, then vertices in the order they're used
+		std::vector<uint32_t> clusters;
+		vkMesh::optimize_vertex_cache(indexData, inputVertices, vertexCacheSize, &clusters);
+		vkMesh::optimize_overdraw(indexData, clusters, vertexData.data(), 2, floatsPerVertex);
+		size_t outputVertices = vkMesh::optimize_vertex_fetch(vertexData, floatsPerVertex, indexData);
 
-	for (float attribute :vertexData)
-	{
-		vertexlump.push_back(attribute);
+		vkMesh::VertexCacheStats after = vkMesh::analyze_vertex_cache(indexData, outputVertices, vertexCacheSize);
+		std::cout << "Optimized " << indexData.size() / 3 << " triangles, ACMR " << before.acmr << " -> " << after.acmr
+			<< ", ATVR " << before.atvr << " -> " << after.atvr << std::endl;
 	}
 
-	for (uint32_t index : indexData)
-	{
-		indexLump.push_back(index + indexOffset);
+	int vertexCount = static_cast<int>(vertexData.size() / floatsPerVertex);
+
+	//meshlets are cut from the final triangle order, bounded at full precision
+	uint32_t firstMeshlet = static_cast<uint32_t>(meshletLump.size());
+	uint32_t meshletCount = static_cast<uint32_t>(vkMesh::build_meshlets(indexData, vertexData.data(), 2, floatsPerVertex, meshletLump));
+
+	//16-bit indices whenever the mesh's vertices can all be reached with them
+	uint32_t maxIndex = indexData.empty() ? 0 : *std::max_element(indexData.begin(), indexData.end());
+
+	MeshRange range = {};
+	range.indexType = maxIndex <= 0xFFFF ? vk::IndexType::eUint16 : vk::IndexType::eUint32;
+	range.firstIndex = static_cast<uint32_t>(range.indexType == vk::IndexType::eUint16 ? index16Lump.size() : index32Lump.size());
+	range.indexCount = static_cast<uint32_t>(indexData.size());
+	//indices stay relative to the mesh, its first vertex is the draw's base vertex
+	range.vertexOffset = indexOffset;
+	range.material = nullptr;
+	range.materialId = 0;
+	range.firstMeshlet = firstMeshlet;
+	range.meshletCount = meshletCount;
+
+	//vertices start with a 2D position
+	range.boundingRadius = 0.0f;
+	for (int i = 0; i < vertexCount; ++i) {
+		range.boundingRadius = std::max(range.boundingRadius,
+			glm::length(glm::vec2(vertexData[floatsPerVertex * i], vertexData[floatsPerVertex * i + 1])));
+	}
+
+	//each level is simplified from the full mesh, so its error is against what it stands in for
+	std::vector<uint32_t> lodIndices = indexData;
+	range.lodCount = 1;
+	range.lods[0] = { range.firstIndex, range.indexCount, 0.0f };
+	while (range.lodCount < maxMeshLods) {
+		size_t previousCount = range.lods[range.lodCount - 1].indexCount;
+		float error = 0.0f;
+		std::vector<uint32_t> lod = vkMesh::simplify(indexData, vertexData.data(), 2, floatsPerVertex, vertexCount,
+			previousCount / 6 * 3, lodMaxError * range.boundingRadius, &error);
+		//a level which barely saves anything isn't worth its indices
+		if (lod.empty() || 10 * lod.size() > 9 * previousCount) {
+			break;
+		}
+		if (optimizeMeshes) {
+			vkMesh::optimize_vertex_cache(lod, vertexCount, vertexCacheSize, nullptr);
+		}
+		range.lods[range.lodCount++] = { range.firstIndex + static_cast<uint32_t>(lodIndices.size()), static_cast<uint32_t>(lod.size()), error };
+		lodIndices.insert(lodIndices.end(), lod.begin(), lod.end());
+	}
+	if (debugMode && range.lodCount > 1) {
+		std::cout << range.lodCount << " levels of detail, of";
+		for (uint32_t i = 0; i < range.lodCount; ++i) {
+			std::cout << " " << range.lods[i].indexCount / 3;
+		}
+		std::cout << " triangles" << std::endl;
+	}
+
+	if (layout.position == vkMesh::AttributeFormat::snorm16) {
+		for (int i = 0; i < 2 * vertexCount; ++i) {
+			if (std::abs(vertexData[floatsPerVertex * (i / 2) + i % 2]) > 1.0f) {
+				std::cout << "snorm16 vertices clamp positions to [-1, 1], use a float layout for bigger meshes" << std::endl;
+				break;
+			}
+		}
+	}
+
+	size_t firstByte = vertexlump.size();
+	vertexlump.resize(firstByte + static_cast<size_t>(vertexCount) * layout.stride());
+	for (int i = 0; i < vertexCount; ++i) {
+		layout.encode(&vertexData[floatsPerVertex * i], &vertexlump[firstByte + static_cast<size_t>(i) * layout.stride()]);
+	}
+
+	if (range.indexType == vk::IndexType::eUint16) {
+		index16Lump.insert(index16Lump.end(), lodIndices.begin(), lodIndices.end());
+	}
+	else {
+		index32Lump.insert(index32Lump.end(), lodIndices.begin(), lodIndices.end());
 	}
 
 	indexOffset += vertexCount;
+
+	return range;
+}
+
+bool VertexMenagerie::load_archive(const char* filename, std::vector<std::string>& names, std::vector<MeshRange>& ranges) {
+	if (!vertexlump.empty() || !index16Lump.empty() || !index32Lump.empty() || !meshletLump.empty() || archive.data()) {
+		std::cout << "Mesh archives can't be loaded alongside other meshes" << std::endl;
+		return false;
+	}
+
+	vkUtils::MappedFile file;
+	if (!file.open(filename)) {
+		std::cout << "Failed to map mesh archive " << filename << std::endl;
+		return false;
+	}
+
+	MeshArchiveHeader header;
+	if (!vkUtils::read_file_header(file, filename, "mesh archive", meshArchiveMagic, meshArchiveVersion, meshArchiveByteOrder, header)) {
+		return false;
+	}
+	if (header.vertexLayout != layout.key() || header.vertexStride != layout.stride()) {
+		std::cout << filename << " was written with another vertex layout" << std::endl;
+		return false;
+	}
+
+	uint64_t size = header.fileSize;
+	bool fits = vkUtils::blob_fits(header.meshesOffset, header.meshCount, sizeof(MeshArchiveEntry), size, meshArchiveAlignment)
+		&& vkUtils::blob_fits(header.verticesOffset, header.vertexCount, header.vertexStride, size, meshArchiveAlignment)
+		&& vkUtils::blob_fits(header.indices16Offset, header.index16Count, sizeof(uint16_t), size, meshArchiveAlignment)
+		&& vkUtils::blob_fits(header.indices32Offset, header.index32Count, sizeof(uint32_t), size, meshArchiveAlignment)
+		&& vkUtils::blob_fits(header.meshletsOffset, header.meshletCount, sizeof(vkMesh::Meshlet), size, meshArchiveAlignment);
+	if (!fits) {
+		std::cout << filename << " has blobs outside of the file" << std::endl;
+		return false;
+	}
+	if (header.vertexCount == 0 || header.index16Count + header.index32Count == 0) {
+		std::cout << filename << " has no vertices or no indices" << std::endl;
+		return false;
+	}
+
+	std::vector<std::string> archiveNames(header.meshCount);
+	std::vector<MeshRange> archiveRanges(header.meshCount);
+	for (size_t i = 0; i < archiveRanges.size(); ++i) {
+		MeshArchiveEntry entry;
+		memcpy(&entry, file.data() + header.meshesOffset + i * sizeof(MeshArchiveEntry), sizeof(entry));
+		archiveNames[i].assign(entry.name, strnlen(entry.name, sizeof(entry.name)));
+
+		uint64_t indexCount = entry.indexSize == sizeof(uint16_t) ? header.index16Count : header.index32Count;
+		bool indexed = (entry.indexSize == sizeof(uint16_t) || entry.indexSize == sizeof(uint32_t))
+			&& uint64_t(entry.firstIndex) + entry.indexCount <= indexCount
+			&& entry.vertexOffset >= 0 && uint64_t(entry.vertexOffset) <= header.vertexCount
+			&& uint64_t(entry.firstMeshlet) + entry.meshletCount <= header.meshletCount
+			&& entry.lodCount >= 1 && entry.lodCount <= maxMeshLods;
+		indexed = indexed && entry.lods[0].firstIndex == entry.firstIndex && entry.lods[0].indexCount == entry.indexCount;
+		for (uint32_t lod = 0; indexed && lod < entry.lodCount; ++lod) {
+			indexed = uint64_t(entry.lods[lod].firstIndex) + entry.lods[lod].indexCount <= indexCount;
+		}
+		if (!indexed) {
+			std::cout << "The mesh " << archiveNames[i] << " in " << filename << " has indices outside of the archive" << std::endl;
+			return false;
+		}
+
+		//every index is read once here, so that no draw of the mesh reaches past the vertices
+		bool inVertices = true;
+		for (uint32_t lod = 0; inVertices && lod < entry.lodCount; ++lod) {
+			const MeshLod& level = entry.lods[lod];
+			if (level.indexCount == 0) {
+				continue;
+			}
+			uint64_t maxIndex = entry.indexSize == sizeof(uint16_t) ?
+				max_index<uint16_t>(file.data() + header.indices16Offset, level.firstIndex, level.indexCount) :
+				max_index<uint32_t>(file.data() + header.indices32Offset, level.firstIndex, level.indexCount);
+			inVertices = uint64_t(entry.vertexOffset) + maxIndex < header.vertexCount;
+		}
+		if (!inVertices) {
+			std::cout << "The mesh " << archiveNames[i] << " in " << filename << " has indices past the archive's vertices" << std::endl;
+			return false;
+		}
+
+		//meshlets are runs of whole triangles in the full mesh's indices
+		const vkMesh::Meshlet* meshlets = reinterpret_cast<const vkMesh::Meshlet*>(file.data() + header.meshletsOffset) + entry.firstMeshlet;
+		for (uint32_t j = 0; j < entry.meshletCount; ++j) {
+			if (meshlets[j].indexCount % 3 != 0 || uint64_t(meshlets[j].firstIndex) + meshlets[j].indexCount > entry.indexCount) {
+				std::cout << "The mesh " << archiveNames[i] << " in " << filename << " has meshlets outside of its indices" << std::endl;
+				return false;
+			}
+		}
+
+		MeshRange& range = archiveRanges[i];
+		range.indexType = entry.indexSize == sizeof(uint16_t) ? vk::IndexType::eUint16 : vk::IndexType::eUint32;
+		range.firstIndex = entry.firstIndex;
+		range.indexCount = entry.indexCount;
+		range.vertexOffset = entry.vertexOffset;
+		range.boundingRadius = entry.boundingRadius;
+		range.material = nullptr;
+		range.materialId = entry.materialId;
+		range.firstMeshlet = entry.firstMeshlet;
+		range.meshletCount = entry.meshletCount;
+		range.lodCount = entry.lodCount;
+		std::copy(entry.lods, entry.lods + maxMeshLods, range.lods);
+	}
+
+	archiveVertices = file.data() + header.verticesOffset;
+	archiveVertexBytes = header.vertexCount * header.vertexStride;
+	archiveIndices16 = file.data() + header.indices16Offset;
+	archiveIndex16Bytes = header.index16Count * sizeof(uint16_t);
+	archiveIndices32 = file.data() + header.indices32Offset;
+	archiveIndex32Bytes = header.index32Count * sizeof(uint32_t);
+	archiveMeshlets = file.data() + header.meshletsOffset;
+	archiveMeshletBytes = header.meshletCount * sizeof(vkMesh::Meshlet);
+	archive = std::move(file);
+
+	names.insert(names.end(), archiveNames.begin(), archiveNames.end());
+	ranges.insert(ranges.end(), archiveRanges.begin(), archiveRanges.end());
+	return true;
+}
+
+bool VertexMenagerie::write_archive(const char* filename, const std::vector<std::string>& names, const std::vector<MeshRange>& ranges) const {
+	if (!vkUtils::little_endian()) {
+		std::cout << "Mesh archives are little endian, they can't be written in place on this machine" << std::endl;
+		return false;
+	}
+
+	MeshArchiveHeader header = {};
+	memcpy(header.magic, meshArchiveMagic, sizeof(header.magic));
+	header.formatVersion = meshArchiveVersion;
+	header.byteOrder = meshArchiveByteOrder;
+	header.vertexStride = layout.stride();
+	header.vertexLayout = layout.key();
+	header.meshCount = static_cast<uint32_t>(ranges.size());
+	header.vertexCount = vertexlump.size() / layout.stride();
+	header.index16Count = index16Lump.size();
+	header.index32Count = index32Lump.size();
+	header.meshletCount = meshletLump.size();
+	header.meshesOffset = align_archive_offset(sizeof(MeshArchiveHeader));
+	header.verticesOffset = align_archive_offset(header.meshesOffset + ranges.size() * sizeof(MeshArchiveEntry));
+	header.indices16Offset = align_archive_offset(header.verticesOffset + header.vertexCount * header.vertexStride);
+	header.indices32Offset = align_archive_offset(header.indices16Offset + header.index16Count * sizeof(uint16_t));
+	header.meshletsOffset = align_archive_offset(header.indices32Offset + header.index32Count * sizeof(uint32_t));
+	header.fileSize = align_archive_offset(header.meshletsOffset + header.meshletCount * sizeof(vkMesh::Meshlet));
+
+	std::vector<MeshArchiveEntry> entries(ranges.size());
+	for (size_t i = 0; i < ranges.size(); ++i) {
+		MeshArchiveEntry& entry = entries[i];
+		if (i >= names.size() || names[i].size() >= sizeof(entry.name)) {
+			std::cout << "Mesh " << i << " can't be named in a mesh archive" << std::endl;
+			return false;
+		}
+		memcpy(entry.name, names[i].c_str(), names[i].size() + 1);
+		entry.indexSize = ranges[i].indexType == vk::IndexType::eUint16 ? sizeof(uint16_t) : sizeof(uint32_t);
+		entry.firstIndex = ranges[i].firstIndex;
+		entry.indexCount = ranges[i].indexCount;
+		entry.vertexOffset = ranges[i].vertexOffset;
+		entry.boundingRadius = ranges[i].boundingRadius;
+		entry.materialId = ranges[i].materialId;
+		entry.firstMeshlet = ranges[i].firstMeshlet;
+		entry.meshletCount = ranges[i].meshletCount;
+		entry.lodCount = ranges[i].lodCount;
+		std::copy(ranges[i].lods, ranges[i].lods + maxMeshLods, entry.lods);
+	}
+
+	std::vector<vkUtils::FileBlob> blobs;
+	blobs.push_back({ 0, &header, sizeof(header) });
+	blobs.push_back({ header.meshesOffset, entries.data(), entries.size() * sizeof(MeshArchiveEntry) });
+	blobs.push_back({ header.verticesOffset, vertexlump.data(), vertexlump.size() });
+	blobs.push_back({ header.indices16Offset, index16Lump.data(), index16Lump.size() * sizeof(uint16_t) });
+	blobs.push_back({ header.indices32Offset, index32Lump.data(), index32Lump.size() * sizeof(uint32_t) });
+	blobs.push_back({ header.meshletsOffset, meshletLump.data(), meshletLump.size() * sizeof(vkMesh::Meshlet) });
+	return vkUtils::write_blobs(filename, blobs, header.fileSize);
 }
 
 void VertexMenagerie::finalize(vertexBufferFinalizationChunk finalizationChunk) {
 	this->logicDevice = finalizationChunk.logicalDevice;
+	this->allocator = finalizationChunk.allocator;
+
+	//an archive's blobs are staged straight from the mapping
+	const void* vertexData = vertexlump.data();
+	vk::DeviceSize vertexBytes = vertexlump.size();
+	const void* index16Data = index16Lump.data();
+	vk::DeviceSize index16Bytes = sizeof(uint16_t) * index16Lump.size();
+	const void* index32Data = index32Lump.data();
+	vk::DeviceSize index32Bytes = sizeof(uint32_t) * index32Lump.size();
+	const void* meshletData = meshletLump.data();
+	meshletBufferSize = sizeof(vkMesh::Meshlet) * meshletLump.size();
+	if (archive.data()) {
+		vertexData = archiveVertices;
+		vertexBytes = archiveVertexBytes;
+		index16Data = archiveIndices16;
+		index16Bytes = archiveIndex16Bytes;
+		index32Data = archiveIndices32;
+		index32Bytes = archiveIndex32Bytes;
+		meshletData = archiveMeshlets;
+		meshletBufferSize = archiveMeshletBytes;
+	}
 
 	BufferInputChunk inputChunk;
 	inputChunk.logicalDevice = finalizationChunk.logicalDevice;
 	inputChunk.physicalDevice = finalizationChunk.physicalDevice;
-	inputChunk.size = sizeof(float) * vertexlump.size();
-	inputChunk.usage = vk::BufferUsageFlagBits::eTransferSrc;
-	inputChunk.memoryProperties = vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent;
-	Buffer stagingBuffer = vkUtils::createBuffer(inputChunk);
-
-	void* memoryLocation = logicDevice.mapMemory(stagingBuffer.bufferMemory, 0, inputChunk.size);
-	memcpy(memoryLocation, vertexlump.data(), inputChunk.size);
-	logicDevice.unmapMemory(stagingBuffer.bufferMemory);
-
+	inputChunk.allocator = allocator;
+	inputChunk.size = vertexBytes;
 	inputChunk.usage = vk::BufferUsageFlagBits::eTransferDst | vk::BufferUsageFlagBits::eVertexBuffer;
 	inputChunk.memoryProperties = vk::MemoryPropertyFlagBits::eDeviceLocal;
-
 	vertexBuffer = vkUtils::createBuffer(inputChunk);
 
-	vkUtils::copyBuffer(stagingBuffer, vertexBuffer, inputChunk.size, finalizationChunk.queue, finalizationChunk.commandBuffer);
+	//stage the vertices through the ring
+	finalizationChunk.uploadBatch->stage_buffer(vertexData, inputChunk.size, vertexBuffer,
+		vk::PipelineStageFlagBits::eVertexInput, vk::AccessFlagBits::eVertexAttributeRead);
 
-	logicDevice.destroyBuffer(stagingBuffer.buffer);
-	logicDevice.freeMemory(stagingBuffer.bufferMemory);
+	//and the indices, half the size for most meshes
+	index16Buffer = make_index_buffer(finalizationChunk, index16Data, index16Bytes);
+	index32Buffer = make_index_buffer(finalizationChunk, index32Data, index32Bytes);
 
-	//make a staging buffer for indices
-	inputChunk.size = sizeof(uint32_t) * indexLump.size();
-	inputChunk.usage = vk::BufferUsageFlagBits::eTransferSrc;
-	inputChunk.memoryProperties = vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent;
-	stagingBuffer = vkUtils::createBuffer(inputChunk);
+	if (meshletBufferSize) {
+		inputChunk.size = meshletBufferSize;
+		inputChunk.usage = vk::BufferUsageFlagBits::eTransferDst | vk::BufferUsageFlagBits::eStorageBuffer;
+		meshletBuffer = vkUtils::createBuffer(inputChunk);
+		finalizationChunk.uploadBatch->stage_buffer(meshletData, meshletBufferSize, meshletBuffer,
+			vk::PipelineStageFlagBits::eComputeShader, vk::AccessFlagBits::eShaderRead);
+	}
 
-	//fill it with index data
-	memoryLocation = logicDevice.mapMemory(stagingBuffer.bufferMemory, 0, inputChunk.size);
-	memcpy(memoryLocation, indexLump.data(), inputChunk.size);
-	logicDevice.unmapMemory(stagingBuffer.bufferMemory);
+	//staging copied everything into the ring
+	std::vector<uint8_t>().swap(vertexlump);
+	std::vector<uint16_t>().swap(index16Lump);
+	std::vector<uint32_t>().swap(index32Lump);
+	std::vector<vkMesh::Meshlet>().swap(meshletLump);
+	archive.close();
+	archiveVertices = archiveIndices16 = archiveIndices32 = archiveMeshlets = nullptr;
+}
 
-	//make the index buffer
+Buffer VertexMenagerie::make_index_buffer(vertexBufferFinalizationChunk& finalizationChunk, const void* indexData, vk::DeviceSize indexBytes) {
+	Buffer indexBuffer = {};
+	if (indexBytes == 0) {
+		return indexBuffer;
+	}
+
+	BufferInputChunk inputChunk;
+	inputChunk.logicalDevice = finalizationChunk.logicalDevice;
+	inputChunk.physicalDevice = finalizationChunk.physicalDevice;
+	inputChunk.allocator = allocator;
+	inputChunk.size = indexBytes;
 	inputChunk.usage = vk::BufferUsageFlagBits::eTransferDst | vk::BufferUsageFlagBits::eIndexBuffer;
 	inputChunk.memoryProperties = vk::MemoryPropertyFlagBits::eDeviceLocal;
 	indexBuffer = vkUtils::createBuffer(inputChunk);
 
-	//copy to it
-	vkUtils::copyBuffer(stagingBuffer, indexBuffer, inputChunk.size, finalizationChunk.queue, finalizationChunk.commandBuffer);
-
-	//destroy staging buffer
-	logicDevice.destroyBuffer(stagingBuffer.buffer);
-	logicDevice.freeMemory(stagingBuffer.bufferMemory);
+	finalizationChunk.uploadBatch->stage_buffer(indexData, indexBytes, indexBuffer,
+		vk::PipelineStageFlagBits::eVertexInput, vk::AccessFlagBits::eIndexRead);
+	return indexBuffer;
+}
 
+const Buffer& VertexMenagerie::index_buffer(vk::IndexType indexType) const {
+	return indexType == vk::IndexType::eUint16 ? index16Buffer : index32Buffer;
 }
 
 VertexMenagerie::~VertexMenagerie() {
+	//nothing was made if the meshes were never finalized
+	if (!allocator) {
+		return;
+	}
 
 	//destroy vertex buffer
-	logicDevice.destroyBuffer(vertexBuffer.buffer);
-	logicDevice.freeMemory(vertexBuffer.bufferMemory);
+	vkUtils::destroyBuffer(logicDevice, allocator, vertexBuffer);
+
+	//destroy the index buffers, either may not have been needed
+	if (index16Buffer.buffer) {
+		vkUtils::destroyBuffer(logicDevice, allocator, index16Buffer);
+	}
+	if (index32Buffer.buffer) {
+		vkUtils::destroyBuffer(logicDevice, allocator, index32Buffer);
+	}
+	if (meshletBuffer.buffer) {
+		vkUtils::destroyBuffer(logicDevice, allocator, meshletBuffer);
+	}
+}
+
+void consume_default_meshes(VertexMenagerie& meshes, std::vector<std::string>& names, std::vector<MeshRange>& ranges) {
+	size_t first = ranges.size();
 
-	//destroy index buffer
-	logicDevice.destroyBuffer(indexBuffer.buffer);
-	logicDevice.freeMemory(indexBuffer.bufferMemory);
+	std::vector<float> vertices = { {
+			 0.0f, -0.1f, 0.0f, 1.0f, 0.0f, 0.5f, 0.0f, //0
+			 0.1f,  0.1f, 0.0f, 1.0f, 0.0f, 1.0f, 1.0f, //1
+			-0.1f,  0.1f, 0.0f, 1.0f, 0.0f, 0.0f, 1.0f  //2
+		} };
+	std::vector<uint32_t> indices = { {
+			0,1,2
+	} };
+
+	names.push_back("triangle");
+	ranges.push_back(meshes.consume(vertices, indices));
+
+	vertices = { {
+		-0.1f,  0.1f, 1.0f, 0.0f, 0.0f, 0.0f, 1.0f, //0
+		-0.1f, -0.1f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, //1
+		 0.1f, -0.1f, 1.0f, 0.0f, 0.0f, 1.0f, 0.0f, //2
+		 0.1f,  0.1f, 1.0f, 0.0f, 0.0f, 1.0f, 1.0f, //3
+	} };
+	indices = { {
+			0,1,2,
+			2,3,0
+	} };
+	names.push_back("square");
+	ranges.push_back(meshes.consume(vertices, indices));
+
+	vertices = { {
+		 -0.1f, -0.05f, 1.0f, 1.0f, 1.0f, 0.0f, 0.25f, //0
+		-0.04f, -0.05f, 1.0f, 1.0f, 1.0f, 0.3f, 0.25f, //1
+		-0.06f,   0.0f, 1.0f, 1.0f, 1.0f, 0.2f,  0.5f, //2
+		  0.0f,  -0.1f, 1.0f, 1.0f, 1.0f, 0.5f,  0.0f, //3
+		 0.04f, -0.05f, 1.0f, 1.0f, 1.0f, 0.7f, 0.25f, //4
+		  0.1f, -0.05f, 1.0f, 1.0f, 1.0f, 1.0f, 0.25f, //5
+		 0.06f,   0.0f, 1.0f, 1.0f, 1.0f, 0.8f,  0.5f, //6
+		 0.08f,   0.1f, 1.0f, 1.0f, 1.0f, 0.9f,  1.0f, //7
+		  0.0f,  0.02f, 1.0f, 1.0f, 1.0f, 0.5f,  0.6f, //8
+		-0.08f,   0.1f, 1.0f, 1.0f, 1.0f, 0.1f,  1.0f  //9
+	} };
+	indices = { {
+		0,1,2,
+		1,3,4,
+		2,1,4,
+		4,5,6,
+		2,4,6,
+		6,7,8,
+		2,6,8,
+		2,8,9,
+	} };
+	names.push_back("star");
+	ranges.push_back(meshes.consume(vertices, indices));
+
+	for (size_t i = first; i < ranges.size(); ++i) {
+		ranges[i].materialId = static_cast<uint32_t>(i - first);
+	}
+}
+
+bool write_default_mesh_archive(const char* filename, const vkMesh::VertexLayout& layout, bool optimizeMeshes) {
+	VertexMenagerie meshes(layout, optimizeMeshes, true);
+	std::vector<std::string> names;
+	std::vector<MeshRange> ranges;
+	consume_default_meshes(meshes, names, ranges);
+
+	bool written = meshes.write_archive(filename, names, ranges);
+	if (written) {
+		std::cout << "Wrote " << names.size() << " meshes to " << filename << std::endl;
+	}
+	return written;
 }
\ No newline at end of file
@@ -1,27 +1,106 @@
 #pragma once
 #include "config.h"
 #include "memory.h"
+#include "transfer.h"
+#include "mesh_registry.h"
+#include "mapped_file.h"
+#include "vertex_layout.h"
+#include "meshlet.h"
 
 struct vertexBufferFinalizationChunk {
 	vk::Device logicalDevice;
 	vk::PhysicalDevice physicalDevice;
-	vk::CommandBuffer commandBuffer;
-	vk::Queue queue;
+	vkUtils::MemoryAllocator* allocator;
+	vkUtils::UploadBatch* uploadBatch;
 };
 
 class VertexMenagerie {
 public:
-	VertexMenagerie();
+	//meshes are consumed as a vec2 position, a vec3 color and a vec2 texture coordinate
+	static constexpr uint32_t floatsPerVertex = 7;
+
+	/*
+		\param layout what the vertices are quantized to as they're consumed
+		\param optimizeMeshes whether consume reorders meshes for the vertex cache, overdraw and vertex fetch
+		\param debug whether consume reports the levels of detail it builds
+	*/
+	VertexMenagerie(const vkMesh::VertexLayout& layout, bool optimizeMeshes, bool debug);
 	~VertexMenagerie();
-	void consume(meshTypes type, std::vector<float>& vertexData, std::vector<uint32_t>& indexData);
+	/*
+		Append a mesh to the lumps, quantized to the layout and optimized if asked to. Its indices go into the 16-bit lump
+		when they all fit, and are kept relative to the mesh's first vertex. The mesh is split into meshlets too,
+		and simplified into levels of detail whose indices follow its own.
+		\returns where the mesh will live in the finalized buffers, without a material
+	*/
+	MeshRange consume(std::vector<float>& vertexData, std::vector<uint32_t>& indexData);
+	/*
+		Map a mesh archive to be finalized in place of consumed meshes, nothing may have been consumed.
+		Archives written with another vertex layout are refused.
+		\param names receives the name of every mesh in the archive
+		\param ranges receives where each mesh will live in the finalized buffers, with its material id but no material
+		\returns whether the archive could be used, nothing is received if it couldn't
+	*/
+	bool load_archive(const char* filename, std::vector<std::string>& names, std::vector<MeshRange>& ranges);
+	/*
+		Write the consumed meshes out as a mesh archive.
+		\param names the name of each consumed mesh, in the order they were consumed
+		\param ranges what consume returned for each, with their material ids
+	*/
+	bool write_archive(const char* filename, const std::vector<std::string>& names, const std::vector<MeshRange>& ranges) const;
+	/*
+		Make device local buffers for the consumed data, or the archive's, adding their uploads to the batch.
+		An index buffer is only made if some mesh uses its index type, the meshlets go into a storage buffer.
+		The lumps and the archive are released once staged.
+	*/
 	void finalize(vertexBufferFinalizationChunk finalizationChunk);
-	Buffer vertexBuffer, indexBuffer;
-	std::unordered_map<meshTypes, int> firstIndices;
-	std::unordered_map<meshTypes, int> indexCounts;
+
+	/*
+		\returns the index buffer holding indices of the type
+	*/
+	const Buffer& index_buffer(vk::IndexType indexType) const;
+
+	Buffer vertexBuffer, index16Buffer, index32Buffer;
+	//every mesh's vkMesh::Meshlets, read by the culling shader
+	Buffer meshletBuffer;
+	vk::DeviceSize meshletBufferSize{ 0 };
 
 private:
 	int indexOffset;
+	vkMesh::VertexLayout layout;
+	bool optimizeMeshes;
+	bool debugMode;
+	//FIFO post-transform cache size optimized for, and reported against
+	static constexpr uint32_t vertexCacheSize = 16;
+	//levels of detail stop once they'd stray further than this from the full mesh, relative to its bounding radius
+	static constexpr float lodMaxError = 0.1f;
 	vk::Device logicDevice;
-	std::vector<float> vertexlump;
-	std::vector<uint32_t> indexLump;
-};
\ No newline at end of file
+	vkUtils::MemoryAllocator* allocator{ nullptr };
+	std::vector<uint8_t> vertexlump;
+	std::vector<uint16_t> index16Lump;
+	std::vector<uint32_t> index32Lump;
+	std::vector<vkMesh::Meshlet> meshletLump;
+
+	//the vertex and index blobs point into the archive while one is mapped
+	vkUtils::MappedFile archive;
+	const uint8_t* archiveVertices{ nullptr };
+	const uint8_t* archiveIndices16{ nullptr };
+	const uint8_t* archiveIndices32{ nullptr };
+	const uint8_t* archiveMeshlets{ nullptr };
+	vk::DeviceSize archiveVertexBytes{ 0 }, archiveIndex16Bytes{ 0 }, archiveIndex32Bytes{ 0 }, archiveMeshletBytes{ 0 };
+
+	Buffer make_index_buffer(vertexBufferFinalizationChunk& finalizationChunk, const void* indexData, vk::DeviceSize indexBytes);
+};
+
+/*
+	Consume the engine's built in meshes, materials are their places in the list.
+	\param names receives the name of each mesh
+	\param ranges receives what consume returned for each, with its material id
+*/
+void consume_default_meshes(VertexMenagerie& meshes, std::vector<std::string>& names, std::vector<MeshRange>& ranges);
+
+/*
+	Write the built in meshes out as a mesh archive, on the CPU only.
+	\param layout the vertex layout the engine will load it with
+	\param optimizeMeshes whether to optimize the meshes before writing them
+*/
+bool write_default_mesh_archive(const char* filename, const vkMesh::VertexLayout& layout, bool optimizeMeshes);
\ No newline at end of file
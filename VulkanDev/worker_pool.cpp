@@ -0,0 +1,103 @@
+#include "worker_pool.h"
+
+vkUtils::WorkerPool::WorkerPool(size_t workerCount) {
+	workers.reserve(workerCount);
+	for (size_t i = 0; i < workerCount; i++)
+	{
+		workers.emplace_back(&WorkerPool::worker_loop, this);
+	}
+}
+
+vkUtils::WorkerPool::~WorkerPool() {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	wake.notify_all();
+
+	for (std::thread& worker : workers) {
+		worker.join();
+	}
+}
+
+size_t vkUtils::WorkerPool::thread_count() const {
+	return workers.size() + 1;
+}
+
+void vkUtils::WorkerPool::parallel_for(size_t count, const std::function<void(size_t)>& task) {
+	if (count == 0) {
+		return;
+	}
+
+	//not worth waking anyone up for
+	if (count == 1 || workers.empty()) {
+		for (size_t i = 0; i < count; i++) {
+			task(i);
+		}
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		currentTask = &task;
+		taskCount = count;
+		nextTask = 0;
+		completedTasks = 0;
+		++generation;
+	}
+	wake.notify_all();
+
+	run_tasks(task, count);
+
+	//the job must be fully retired before the task goes out of scope
+	std::unique_lock<std::mutex> lock(mutex);
+	finished.wait(lock, [this, count]() { return completedTasks == count && activeWorkers == 0; });
+	currentTask = nullptr;
+	taskCount = 0;
+}
+
+void vkUtils::WorkerPool::worker_loop() {
+	uint64_t seenGeneration = 0;
+
+	while (true)
+	{
+		const std::function<void(size_t)>* task;
+		size_t count;
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			wake.wait(lock, [this, seenGeneration]() { return stopping || generation != seenGeneration; });
+			if (stopping) {
+				return;
+			}
+			seenGeneration = generation;
+
+			//woke up after the job already retired
+			if (!currentTask) {
+				continue;
+			}
+			task = currentTask;
+			count = taskCount;
+			++activeWorkers;
+		}
+
+		run_tasks(*task, count);
+
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			--activeWorkers;
+		}
+		finished.notify_all();
+	}
+}
+
+void vkUtils::WorkerPool::run_tasks(const std::function<void(size_t)>& task, size_t count) {
+	for (size_t i = nextTask++; i < count; i = nextTask++)
+	{
+		task(i);
+
+		if (++completedTasks == count) {
+			std::lock_guard<std::mutex> lock(mutex);
+			finished.notify_all();
+		}
+	}
+}
\ No newline at end of file
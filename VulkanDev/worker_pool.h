@@ -0,0 +1,53 @@
+#pragma once
+#include "config.h"
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+
+namespace vkUtils {
+
+	/**
+		A fixed set of worker threads for fork-join style jobs.
+		The calling thread takes part in every job, so a pool with no workers runs serially.
+	*/
+	class WorkerPool {
+	public:
+		/*
+			\param workerCount the number of threads to spawn in addition to the caller
+		*/
+		WorkerPool(size_t workerCount);
+		~WorkerPool();
+
+		/*
+			\returns the number of threads which run a job, including the caller
+		*/
+		size_t thread_count() const;
+
+		/*
+			Run task(i) for every i in [0, count) across the pool, returns once all tasks have finished.
+			Tasks may run in any order and on any thread.
+		*/
+		void parallel_for(size_t count, const std::function<void(size_t)>& task);
+
+	private:
+		std::vector<std::thread> workers;
+		std::mutex mutex;
+		std::condition_variable wake, finished;
+
+		//the current job, only changed while no worker is active
+		const std::function<void(size_t)>* currentTask{ nullptr };
+		size_t taskCount{ 0 };
+		std::atomic<size_t> nextTask{ 0 };
+		std::atomic<size_t> completedTasks{ 0 };
+
+		uint64_t generation{ 0 };
+		size_t activeWorkers{ 0 };
+		bool stopping{ false };
+
+		void worker_loop();
+
+		void run_tasks(const std::function<void(size_t)>& task, size_t count);
+	};
+}
\ No newline at end of file